@@ -0,0 +1,125 @@
+#include <mpi.h>
+#include <cstdio>
+#include <cstdlib>
+#include "benchmark.h"
+#include "block_cyclic_mat.h"
+#include "scalapack.h"
+#include "scalapack_traits.h"
+
+// Solves a batch of independent systems, split among groups of processes
+// that each have their own grid
+class batch_benchmark_t : public benchmark_routine_t
+{
+public:
+    batch_benchmark_t() : m_systems(16), m_groups(1), m_group(0)
+    {
+    }
+
+    std::string name()      const { return "batch_gesv"; }
+    std::string title()     const { return "BATCHED MATRIX SOLVE"; }
+    std::string sizes()     const { return "n"; }
+    std::string arguments() const { return "n systems groups"; }
+
+    std::vector<std::string> phases() const
+    {
+        return std::vector<std::string>(1, "PxGESV batch");
+    }
+
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {4096, 4096, 4096, 1, 0, 0, 0, 0};
+        return c;
+    }
+
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "systems" && atoi(value.c_str()) > 0)
+            m_systems = atoi(value.c_str());
+        else if (key == "groups" && atoi(value.c_str()) > 0)
+            m_groups = atoi(value.c_str());
+        else
+            return false;
+        return true;
+    }
+
+    // Every process receives the messages of the systems its grid solves.
+    // With several groups the grid is the calling process's own.
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        blas_idx_t nprows = m_grid ? m_grid->nprows() : c.nprows;
+        blas_idx_t npcols = m_grid ? m_grid->npcols() : c.npcols;
+        perf_count_t one  = gesv_count(c.n, 1, nprows, npcols);
+        perf_count_t all  = {m_systems * one.flops, ((m_systems + m_groups - 1) / m_groups) * one.bytes};
+        return all;
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool /*verify*/, benchmark_result_t& result)
+    {
+        // Split the processes into independent grids, each of which solves
+        // its own share of the systems. The grids are created once,
+        // outside the timed phase, and a single group uses the grid of the
+        // case so that grid shapes can be swept and tuned.
+        if (m_groups > 1)
+        {
+            if (!m_grid)
+                m_grid = blacs_grid_t::split(m_groups, m_group);
+            grid = m_grid;
+        }
+
+        blas_idx_t n_global = c.n;
+        blas_idx_t info     = 0;
+        double t1 = 0.0;
+
+        for (blas_idx_t s = m_group; s < m_systems && info == 0; s += m_groups)
+        {
+            auto a = block_cyclic_mat_t::random(grid, n_global, n_global);
+            auto x = block_cyclic_mat_t::constant(grid, n_global, 1, 42.0);
+
+            std::vector<blas_idx_t> ipiv(a->local_rows() + a->row_block_size());
+            blas_idx_t ia = 1, ja = 1, nrhs = 1;
+
+            double t0 = MPI_Wtime();
+            scalapack_traits<double>::gesv (n_global, nrhs,
+                a->local_data(), ia, ja, a->descriptor(),
+                ipiv.data(),
+                x->local_data(), ia, ja, x->descriptor(), info);
+            t1 += MPI_Wtime() - t0;
+            if (info != 0 && grid->iam() == 0)
+            {
+                printf("PxGESV failed on system %d with INFO = %d\n", s, info); fflush(stdout);
+            }
+        }
+        result.t.push_back(t1);
+
+        // The batch is done when the slowest grid is done. Every process
+        // takes part, even one whose grid has failed.
+        double t_glob;
+        MPI_Allreduce(&t1, &t_glob, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        result.metrics.push_back(std::make_pair(std::string("Systems/Second"), m_systems / t_glob));
+        return info == 0;
+    }
+
+private:
+    blas_idx_t                    m_systems;
+    blas_idx_t                    m_groups;
+    blas_idx_t                    m_group;
+    std::shared_ptr<blacs_grid_t> m_grid;
+};
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    // Arguments are N, the number of systems (DEFAULT 16), the number of
+    // groups of processes that solve them (DEFAULT 1) and the options of
+    // run_benchmark. The routine holds the grids of the groups, which must
+    // be freed before MPI_Finalize.
+    int status;
+    {
+        batch_benchmark_t routine;
+        status = run_benchmark(argc, argv, routine);
+    }
+
+    MPI_Finalize();
+    return status;
+}
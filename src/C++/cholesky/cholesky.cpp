@@ -1,81 +1,305 @@
 #include <mpi.h>
 #include <cstdio>
-#include <cassert>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "benchmark.h"
 #include "block_cyclic_mat.h"
-#include "scalapack.h"
+#include "factorization.h"
+#include "generators.h"
+#include "rhs_batcher.h"
+#include "scalapack_api.h"
+#include "tiled_cholesky.h"
 
-static std::shared_ptr<block_cyclic_mat_t> make_tridiagonal(std::shared_ptr<blacs_grid_t> grid, blas_idx_t n_global)
+// Factors the -1, 2, -1 tridiagonal matrix, or a dense SPD matrix of a
+// given condition number, with PxPOTRF and reuses the factor to solve for
+// NRHS right-hand sides. With -tiled the matrix is also factorized by the
+// task-based tiled_cholesky_t, so that the two can be compared. With
+// update=K the factor is updated for a random rank-K change to A before
+// the solve, which is compared with factorizing A again. With batch=COLUMNS
+// the NRHS right-hand sides are also solved one column at a time, and
+// through rhs_batcher_t in batches of up to COLUMNS, so that the two can
+// be compared.
+class potrf_benchmark_t : public benchmark_routine_t
 {
-    // First create a matrix with 2 on the diagonal
-    auto a = block_cyclic_mat_t::diagonal(grid, n_global, n_global, 2.0);
-    
-    // Then set the off-diagonal entries to -1
-    // See: http://icl.cs.utk.edu/lapack-forum/archives/scalapack/msg00055.html
-    char uplo        = 'L';
-    blas_idx_t n     = n_global - 1;
-    blas_idx_t ia    = 2;
-    blas_idx_t ja    = 1;
-    double zero      =  0.0;
-    double minus_one = -1.0;
-    pdlaset_(uplo, n, n, zero, minus_one, a -> local_data(), ia, ja, a -> descriptor());
-
-    uplo = 'U';
-    ia = 1;
-    ja = 2;
-    pdlaset_(uplo, n, n, zero, minus_one, a -> local_data(), ia, ja, a -> descriptor());
-
-    return a;
-}
+public:
+    potrf_benchmark_t() : m_cond(0.0), m_tiled(false), m_threads(0), m_lookahead(1), m_update(0), m_batch(0)
+    {
+    }
 
-static double potrf_flops(blas_idx_t N)
-{
-    // From: 
-    // https://icl.cs.utk.edu/svn/scalapack-dev/scalapack/trunk/TESTING/LIN/pdlltdriver.f
-    return (1.0/3.0 * N * N * N + 1.0/2.0 * N * N)/1024.0/1024.0/1024.0;
-}
+    std::string name()      const { return "potrf"; }
+    std::string title()     const { return "MATRIX CHOLESKY FACTORIZATION"; }
+    std::string sizes()     const { return "n nrhs"; }
+    std::string arguments() const { return "n"; }
 
-static void chol_driver(blas_idx_t n_global)
-{
-    auto grid = std::make_shared<blacs_grid_t>();    
-    auto a    = make_tridiagonal(grid, n_global);    
+    std::vector<std::string> phases() const
+    {
+        std::vector<std::string> names;
+        names.push_back("PxPOTRF");
+        if (m_tiled)
+            names.push_back("Tiled POTRF");
+        if (m_update > 0)
+            names.push_back("Rank-K update");
+        names.push_back("PxPOTRS");
+        if (m_batch > 0)
+        {
+            names.push_back("One-by-one PxPOTRS");
+            names.push_back("Batched PxPOTRS");
+        }
+        return names;
+    }
 
-    // Compute Cholesky factorization of A in-place
-    char       uplo     ='U';
-    blas_idx_t ia       = 1, ja = 1, info;
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {4096, 4096, 4096, 1, 0, 0, 0, 0};
+        return c;
+    }
 
-    MPI_Barrier (MPI_COMM_WORLD);
-    double t0 = MPI_Wtime();
-    pdpotrf_ (uplo, n_global, a->local_data(), ia, ja, a->descriptor(), info);
-    assert(info == 0);
+    // cond=VALUE selects the dense SPD matrix; -tiled, threads=COUNT and
+    // lookahead=PANELS set up the tiled factorization; update=K the rank
+    // of the update; batch=COLUMNS the batch size of the batched solves
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "cond" && atof(value.c_str()) >= 1.0)
+            m_cond = atof(value.c_str());
+        else if (key == "tiled")
+            m_tiled = true;
+        else if (key == "threads" && atoi(value.c_str()) > 0)
+            m_threads = atoi(value.c_str());
+        else if (key == "lookahead" && !value.empty() && atoi(value.c_str()) >= 0)
+            m_lookahead = atoi(value.c_str());
+        else if (key == "update" && atoi(value.c_str()) > 0)
+            m_update = atoi(value.c_str());
+        else if (key == "batch" && atoi(value.c_str()) > 0)
+            m_batch = atoi(value.c_str());
+        else
+            return false;
+        return true;
+    }
 
-    double t1 = MPI_Wtime() - t0;
-  
-    double t_glob;
-    MPI_Reduce(&t1, &t_glob, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    // The tiled factorization makes the same operations as PxPOTRF and
+    // sends each tile to a process at most once, which is no more than the
+    // broadcasts of PxPOTRF
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        perf_count_t count = potrf_count(c.n, c.nprows, c.npcols) + potrs_count(c.n, c.nrhs, c.nprows, c.npcols);
+        if (m_tiled)
+            count = count + potrf_count(c.n, c.nprows, c.npcols);
+        if (m_update > 0)
+            count = count + chol_update_count(c.n, m_update, c.nprows, c.npcols);
+        if (m_batch > 0)
+            count = count + potrs_count(c.n, c.nrhs, c.nprows, c.npcols) + potrs_count(c.n, c.nrhs, c.nprows, c.npcols);
+        return count;
+    }
 
-    if (grid->iam() == 0) 
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
     {
-        double gflops = potrf_flops(n_global)/t_glob/grid->nprocs();
-        printf("\n"
-            "MATRIX CHOLESKY FACTORIZATION BENCHMARK SUMMARY\n"
-            "===============================================\n"
-            "N = %d\tNP = %d\tNP_ROW = %d\tNP_COL = %d\n"
-            "Time for PxPOTRF = %10.7f seconds\tGflops/Proc = %10.7f\n",
-            n_global, grid->nprocs(), grid->nprows(), grid->npcols(), 
-            t_glob, gflops);fflush(stdout);
+        auto a = block_cyclic_mat_t::constant(grid, c.n, c.n);
+        if (m_cond > 0.0)
+            fill_spd(*a, m_cond);
+        else
+            fill_tridiagonal(*a);
+
+        // Compute Cholesky factorization of A and keep the factor for later solves
+        auto chol = std::make_shared<factorization_t>(a, factorization_t::CHOLESKY);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        blas_idx_t info = chol->factor();
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "Factorization", info))
+            return false;
+
+        if (m_tiled && !run_tiled(*a, *chol->factors(), result))
+            return false;
+        if (m_update > 0 && !run_update(*chol, result))
+            return false;
+
+        // Reuse the factor to solve for a right-hand side, which costs 
+        // O(N^2) instead of the O(N^3) of another factorization
+        auto x = block_cyclic_mat_t::constant(grid, c.n, c.nrhs, 1.0);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        info = chol->solve(x);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "Solve", info))
+            return false;
+
+        if (m_batch > 0 && !run_batched(chol, c.nrhs, result))
+            return false;
+
+        if (verify)
+        {
+            // ||AX - B||_oo / (N x ||A||_1), where A is intact
+            auto r = block_cyclic_mat_t::constant(grid, c.n, c.nrhs, 1.0);
+            gemm(*a, *x, *r, 1.0, -1.0);
+            double err = lange(*r, 'I')/c.n/lange(*a, '1');
+            result.metrics.push_back(std::make_pair(std::string("Error"), err));
+        }
+        return true;
     }
-}
+
+private:
+    double     m_cond;
+    bool       m_tiled;
+    blas_idx_t m_threads;
+    blas_idx_t m_lookahead;
+    blas_idx_t m_update;
+    blas_idx_t m_batch;
+
+    // Prints the INFO of a failed step on process 0 and returns true if the
+    // step failed
+    static bool failed(std::shared_ptr<blacs_grid_t> grid, const char* step, blas_idx_t info)
+    {
+        if (info != 0 && grid->iam() == 0)
+        {
+            printf("%s failed with INFO = %d\n", step, info); fflush(stdout);
+        }
+        return info != 0;
+    }
+
+    // Factorizes a copy of A with tiled_cholesky_t and compares its time
+    // and factor with those of PxPOTRF, whose factor is u. Returns false if
+    // the tiled factorization fails.
+    bool run_tiled(block_cyclic_mat_t& a, block_cyclic_mat_t& u, benchmark_result_t& result)
+    {
+        auto f = a.redistribute(a.row_block_size(), a.col_block_size());
+        tiled_cholesky_t tiled(f, 'U', m_threads, m_lookahead);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        blas_idx_t info = tiled.factor();
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(a.grid(), "Tiled factorization", info))
+            return false;
+
+        // The times are the maximum over the processes, as in the summary
+        double t[2] = {result.t[0], result.t[1]};
+        MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        // max |U_tiled - U| / max |U| over the upper triangle
+        double     diff[2] = {0.0, 0.0};
+        blas_idx_t lld     = u.descriptor()[LLD_];
+        for (blas_idx_t jl = 0; jl < u.local_cols(); jl ++)
+        {
+            blas_idx_t j = u.global_col(jl);
+            for (blas_idx_t il = 0; il < u.local_rows() && u.global_row(il) <= j; il ++)
+            {
+                double x = u.local_data()[il + jl * lld];
+                diff[0] = std::max(diff[0], std::fabs(f->local_data()[il + jl * lld] - x));
+                diff[1] = std::max(diff[1], std::fabs(x));
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, diff, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        const tiled_stats_t& stats = tiled.stats();
+        result.metrics.push_back(std::make_pair(std::string("Tiled speedup"), t[0] / t[1]));
+        result.metrics.push_back(std::make_pair(std::string("Tiled factor difference"), diff[0] / diff[1]));
+        result.metrics.push_back(std::make_pair(std::string("Tiled worker utilization"), stats.utilization()));
+        result.metrics.push_back(std::make_pair(std::string("Tiled steals per task"), stats.steals / std::max(stats.tasks, 1.0)));
+        return true;
+    }
+
+    // Adds X X^T to A for a random N x K matrix X, which keeps A positive
+    // definite, and updates the factor, whose time is compared with that
+    // of PxPOTRF. The solve that follows checks the factor against the
+    // updated A. Returns false if the update fails.
+    bool run_update(factorization_t& chol, benchmark_result_t& result)
+    {
+        auto a = chol.matrix();
+        auto x = block_cyclic_mat_t::random(a->grid(), a->global_rows(), m_update);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        blas_idx_t info = chol.update(x);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(a->grid(), "Update", info))
+            return false;
+
+        // The times are the maximum over the processes, as in the summary
+        double t[2] = {result.t[0], result.t.back()};
+        MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        result.metrics.push_back(std::make_pair(std::string("Update speedup"), t[0] / t[1]));
+        return true;
+    }
+
+    // Solves NRHS single-column right-hand sides one PxPOTRS call at a
+    // time, then again through rhs_batcher_t, which gathers up to m_batch
+    // of them per call, and compares the two times and solutions. Returns
+    // false if a solve fails.
+    bool run_batched(std::shared_ptr<factorization_t> chol, blas_idx_t nrhs, benchmark_result_t& result)
+    {
+        auto a = chol->matrix();
+        std::vector<std::shared_ptr<block_cyclic_mat_t> > single(nrhs), batched(nrhs);
+        for (blas_idx_t j = 0; j < nrhs; j ++)
+        {
+            single[j]  = block_cyclic_mat_t::constant(a->grid(), a->global_rows(), 1, double(j + 1));
+            batched[j] = block_cyclic_mat_t::constant(a->grid(), a->global_rows(), 1, double(j + 1));
+        }
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        blas_idx_t info = 0;
+        for (blas_idx_t j = 0; j < nrhs && info == 0; j ++)
+            info = chol->solve(single[j]);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(a->grid(), "One-by-one solve", info))
+            return false;
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        {
+            rhs_batcher_t batcher(chol, m_batch);
+            for (blas_idx_t j = 0; j < nrhs && info == 0; j ++)
+                info = batcher.submit(batched[j]);
+            if (info == 0)
+                info = batcher.flush();
+        }
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(a->grid(), "Batched solve", info))
+            return false;
+
+        // The times are the maximum over the processes, as in the summary
+        size_t last = result.t.size() - 1;
+        double t[2] = {result.t[last - 1], result.t[last]};
+        MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        // max |X_batched - X| / max |X|
+        double diff[2] = {0.0, 0.0};
+        for (blas_idx_t j = 0; j < nrhs; j ++)
+        {
+            for (blas_idx_t i = 0; i < single[j]->local_size(); i ++)
+            {
+                double x = single[j]->local_data()[i];
+                diff[0] = std::max(diff[0], std::fabs(batched[j]->local_data()[i] - x));
+                diff[1] = std::max(diff[1], std::fabs(x));
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, diff, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        result.metrics.push_back(std::make_pair(std::string("Batch speedup"), t[0] / t[1]));
+        result.metrics.push_back(std::make_pair(std::string("Batch solution difference"), diff[0] / diff[1]));
+        return true;
+    }
+};
 
 int main(int argc, char** argv)
 {
-  MPI_Init(&argc, &argv);
-  blas_idx_t n_global = 4096;
-  
-  if (argc > 1)
-  {
-    n_global = blas_idx_t(atol(argv[1]));
-  }
-
-  chol_driver(n_global);
+  // The tiled factorization makes MPI calls from the main thread only
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+  // Arguments are N and the options of run_benchmark, plus cond=VALUE
+  // for a dense SPD matrix with that condition number, and -tiled to
+  // compare PxPOTRF with the tiled factorization, run by threads=COUNT
+  // workers per process (DEFAULT one less than the OpenMP threads) with
+  // lookahead=PANELS (DEFAULT 1), update=K to update the factor for a
+  // rank-K change to A, and batch=COLUMNS to compare one-by-one solves of
+  // the right-hand sides with solves batched COLUMNS at a time
+  potrf_benchmark_t routine;
+  int status = run_benchmark(argc, argv, routine);
+
   MPI_Finalize();
+  return status;
 }
@@ -0,0 +1,620 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+
+#include <mpi.h>
+#include "benchmark.h"
+#include "block_cyclic_mat.h"
+#include "tuning.h"
+
+// The parsed command line
+struct options_t
+{
+    std::vector<blas_idx_t> m, n, k, nrhs;
+    std::vector<std::pair<blas_idx_t, blas_idx_t> > blocks;
+    std::vector<std::pair<blas_idx_t, blas_idx_t> > grids;
+    int         warmup;
+    int         trials;
+    bool        tune;
+    std::string csv;
+    std::string json;
+    std::string label;
+    double      peak;
+};
+
+// The timings of one case, with the total as the last phase, and the
+// minimum, average and maximum total over the processes in each trial
+struct record_t
+{
+    benchmark_case_t                 c;
+    std::vector<std::string>         phases;
+    std::vector<std::vector<double> > t;
+    std::vector<double>              rank_min, rank_avg, rank_max;
+    std::vector<std::pair<std::string, double> > metrics;
+    perf_count_t                     model;
+};
+
+// Parses a comma-separated list of positive integers
+static bool parse_list(const std::string& value, std::vector<blas_idx_t>& list)
+{
+    list.clear();
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        blas_idx_t x = blas_idx_t(atol(item.c_str()));
+        if (x <= 0)
+            return false;
+        list.push_back(x);
+    }
+    return !list.empty();
+}
+
+// Parses a comma-separated list of grid shapes such as 2x4
+static bool parse_grids(const std::string& value, std::vector<std::pair<blas_idx_t, blas_idx_t> >& grids)
+{
+    grids.clear();
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        size_t x = item.find('x');
+        if (x == std::string::npos)
+            return false;
+        blas_idx_t nprows = blas_idx_t(atol(item.substr(0, x).c_str()));
+        blas_idx_t npcols = blas_idx_t(atol(item.substr(x + 1).c_str()));
+        if (nprows <= 0 || npcols <= 0)
+            return false;
+        grids.push_back(std::make_pair(nprows, npcols));
+    }
+    return !grids.empty();
+}
+
+// Applies one key=value argument, returning false if it is not valid
+static bool apply(const std::string& key, const std::string& value, benchmark_routine_t& routine,
+    options_t& options, std::vector<blas_idx_t>& mb, std::vector<blas_idx_t>& nb)
+{
+    if (key == "m")      return parse_list(value, options.m);
+    if (key == "n")      return parse_list(value, options.n);
+    if (key == "k")      return parse_list(value, options.k);
+    if (key == "nrhs")   return parse_list(value, options.nrhs);
+    if (key == "mb")     return parse_list(value, mb);
+    if (key == "nb")     return parse_list(value, nb);
+    if (key == "grid")   return parse_grids(value, options.grids);
+    if (key == "csv")    { options.csv   = value; return !value.empty(); }
+    if (key == "json")   { options.json  = value; return !value.empty(); }
+    if (key == "label")  { options.label = value; return true; }
+    if (key == "warmup") { options.warmup = atoi(value.c_str()); return options.warmup >= 0; }
+    if (key == "trials") { options.trials = atoi(value.c_str()); return options.trials > 0; }
+    if (key == "peak")   { options.peak   = atof(value.c_str()); return options.peak > 0.0; }
+    return routine.set_option(key, value);
+}
+
+static bool parse_arguments(int argc, char** argv, benchmark_routine_t& routine, options_t& options,
+    std::string& bad)
+{
+    options.warmup = 1;
+    options.trials = 3;
+    options.tune   = false;
+    options.peak   = 0.0;
+
+    std::istringstream names(routine.arguments());
+    std::vector<blas_idx_t> mb, nb;
+    for (int i = 1; i < argc; i ++)
+    {
+        std::string arg = argv[i];
+        std::string key, value;
+        if (arg[0] == '-')
+        {
+            key = arg.substr(1);
+            if (key == "tune")
+            {
+                options.tune = true;
+                continue;
+            }
+        }
+        else if (arg.find('=') != std::string::npos)
+        {
+            key   = arg.substr(0, arg.find('='));
+            value = arg.substr(arg.find('=') + 1);
+        }
+        else if (!(names >> key))
+        {
+            bad = arg;
+            return false;
+        }
+        else
+        {
+            value = arg;
+        }
+
+        if (!apply(key, value, routine, options, mb, nb))
+        {
+            bad = arg;
+            return false;
+        }
+    }
+
+    // A single list of block sizes gives square blocks
+    if (mb.empty() && nb.empty())
+        options.blocks.push_back(std::make_pair(0, 0));
+    else if (nb.empty() || mb.empty())
+    {
+        const std::vector<blas_idx_t>& b = mb.empty() ? nb : mb;
+        for (size_t i = 0; i < b.size(); i ++)
+            options.blocks.push_back(std::make_pair(b[i], b[i]));
+    }
+    else
+    {
+        for (size_t i = 0; i < mb.size(); i ++)
+            for (size_t j = 0; j < nb.size(); j ++)
+                options.blocks.push_back(std::make_pair(mb[i], nb[j]));
+    }
+
+    if (options.grids.empty())
+        options.grids.push_back(std::make_pair(0, 0));
+
+    // Without N, M and K come from the routine's defaults too rather than
+    // from N, so that a rectangular default case stays rectangular
+    benchmark_case_t defaults = routine.defaults();
+    if (options.n.empty())
+    {
+        options.n.push_back(defaults.n);
+        if (options.m.empty())
+            options.m.push_back(defaults.m);
+        if (options.k.empty())
+            options.k.push_back(defaults.k);
+    }
+    if (options.nrhs.empty())
+        options.nrhs.push_back(defaults.nrhs);
+    return true;
+}
+
+// Activates the grid shape and block sizes of the case and returns its
+// grid, running the autotuner first if requested
+static std::shared_ptr<blacs_grid_t> configure(benchmark_routine_t& routine, const benchmark_case_t& c, bool tune)
+{
+    if (tune && c.nprows == 0 && c.mb == 0)
+    {
+        tuner_t::autotune(routine.name(), c.m, c.n,
+            [&](std::shared_ptr<blacs_grid_t> grid, blas_idx_t m, blas_idx_t n) -> double {
+                benchmark_case_t probe = c;
+                probe.m    = m;
+                probe.n    = n;
+                probe.k    = std::min(c.k, std::max(m, n));
+                probe.nrhs = std::min(c.nrhs, n);
+
+                benchmark_result_t result;
+                routine.run(grid, probe, false, result);
+                double t = 0.0;
+                for (size_t i = 0; i < result.t.size(); i ++)
+                    t += result.t[i];
+                return t;
+            });
+    }
+    tuner_t::select(routine.name(), c.m, c.n);
+
+    tuning_config_t config = {0, 0, block_cyclic_mat_t::default_block_size(), block_cyclic_mat_t::default_block_size(), 0.0};
+    if (tuner_t::active())
+        config = *tuner_t::active();
+    if (c.nprows)
+    {
+        config.nprows = c.nprows;
+        config.npcols = c.npcols;
+    }
+    if (c.mb)
+    {
+        config.mb = c.mb;
+        config.nb = c.nb;
+    }
+    tuner_t::activate(config);
+
+    return c.nprows ? std::make_shared<blacs_grid_t>(c.nprows, c.npcols) : std::make_shared<blacs_grid_t>();
+}
+
+static void statistics(std::vector<double> samples, double& tmin, double& tmedian, double& tmax)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    tmin    = samples.front();
+    tmax    = samples.back();
+    tmedian = n % 2 ? samples[n/2] : 0.5 * (samples[n/2 - 1] + samples[n/2]);
+}
+
+static double median(const std::vector<double>& samples)
+{
+    double tmin, tmedian, tmax;
+    statistics(samples, tmin, tmedian, tmax);
+    return tmedian;
+}
+
+// The figures derived from the median trial of a case and the model
+struct efficiency_t
+{
+    double gflops;      // Per process, in 10^9 operations per second
+    double percent;     // Of the peak
+    double rank_min;
+    double rank_avg;
+    double rank_max;
+    double imbalance;   // rank_max / rank_avg
+    double bytes;       // Received per process, from the model
+    double bandwidth;   // bytes / median total, in 10^9 bytes per second
+};
+
+static efficiency_t efficiency(const record_t& r, double peak, int nprocs)
+{
+    efficiency_t e;
+    double t    = median(r.t.back());
+    e.gflops    = r.model.flops/t/nprocs/1e9;
+    e.percent   = 100.0 * e.gflops/peak;
+    e.rank_min  = median(r.rank_min);
+    e.rank_avg  = median(r.rank_avg);
+    e.rank_max  = median(r.rank_max);
+    e.imbalance = e.rank_avg > 0.0 ? e.rank_max/e.rank_avg : 1.0;
+    e.bytes     = r.model.bytes;
+    e.bandwidth = r.model.bytes/t/1e9;
+    return e;
+}
+
+static void print_summary(benchmark_routine_t& routine, const record_t& r, double peak, int nprocs)
+{
+    std::string heading = routine.title() + " BENCHMARK SUMMARY";
+    printf("\n%s\n%s\n", heading.c_str(), std::string(heading.size(), '=').c_str());
+
+    std::istringstream sizes(routine.sizes());
+    std::string size;
+    while (sizes >> size)
+    {
+        blas_idx_t value = size == "m" ? r.c.m : size == "k" ? r.c.k : size == "nrhs" ? r.c.nrhs : r.c.n;
+        std::string upper(size);
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        printf("%s = %d\t", upper.c_str(), value);
+    }
+    printf("NP = %d\tNP_ROW = %d\tNP_COL = %d\tMB = %d\tNB = %d\n",
+        nprocs, r.c.nprows, r.c.npcols, r.c.mb, r.c.nb);
+
+    // Single phase routines have the same total as their only phase
+    size_t nlines = r.phases.size() == 2 ? 1 : r.phases.size();
+    for (size_t p = 0; p < nlines; p ++)
+    {
+        double tmin, tmedian, tmax;
+        statistics(r.t[p], tmin, tmedian, tmax);
+        printf("Time for %s = %10.7f / %10.7f / %10.7f seconds (min / median / max of %d)\n",
+            r.phases[p].c_str(), tmin, tmedian, tmax, int(r.t[p].size()));
+    }
+
+    efficiency_t e = efficiency(r, peak, nprocs);
+    printf("Rank time min / avg / max = %10.7f / %10.7f / %10.7f seconds\tImbalance = %5.3f\n",
+        e.rank_min, e.rank_avg, e.rank_max, e.imbalance);
+    printf("Received/Proc = %10.3f MB (model)\tGB/s/Proc = %10.7f\n", e.bytes/1e6, e.bandwidth);
+    printf("Gflops/Proc = %10.7f\tPeak = %10.7f\t%5.1f%% of peak", e.gflops, peak, e.percent);
+    for (size_t i = 0; i < r.metrics.size(); i ++)
+        printf(", %s = %e", r.metrics[i].first.c_str(), r.metrics[i].second);
+    printf("\n");
+    fflush(stdout);
+}
+
+// Returns the string quoted for JSON, or for CSV if csv is true
+static std::string quote(const std::string& s, bool csv = false)
+{
+    std::string q = "\"";
+    for (size_t i = 0; i < s.size(); i ++)
+    {
+        char ch = s[i];
+        if (csv)
+        {
+            q += ch == '"' ? "\"\"" : std::string(1, ch);
+        }
+        else if (ch == '"' || ch == '\\')
+        {
+            q += '\\';
+            q += ch;
+        }
+        else if ((unsigned char)ch < 0x20)
+        {
+            char escaped[8];
+            sprintf(escaped, "\\u%04x", ch);
+            q += escaped;
+        }
+        else
+        {
+            q += ch;
+        }
+    }
+    return q + "\"";
+}
+
+// Formats a number for JSON, which has no NaN or infinity
+static std::string number(double x)
+{
+    if (x != x || fabs(x) > 1e308)
+        return "null";
+    char text[32];
+    sprintf(text, "%.9g", x);
+    return text;
+}
+
+// The fields that identify where and when a record was taken
+struct context_t
+{
+    std::string routine;
+    std::string label;
+    std::string host;
+    std::string date;
+    int         nprocs;
+    int         warmup;
+    double      peak;       // Average DGEMM Gflops per process
+};
+
+static void write_csv(const std::string& filename, const context_t& context, const record_t& r)
+{
+    FILE* probe = fopen(filename.c_str(), "r");
+    bool is_new = probe == nullptr;
+    if (probe)
+        fclose(probe);
+
+    FILE* out = fopen(filename.c_str(), "a");
+    if (!out)
+    {
+        printf("Unable to write %s\n", filename.c_str());
+        return;
+    }
+
+    if (is_new)
+    {
+        fprintf(out, "routine,label,host,date,nprocs,nprows,npcols,mb,nb,m,n,k,nrhs,warmup,trials");
+        for (size_t p = 0; p < r.phases.size(); p ++)
+            fprintf(out, ",%s_min,%s_median,%s_max", r.phases[p].c_str(), r.phases[p].c_str(), r.phases[p].c_str());
+        fprintf(out, ",gflops_per_proc,peak_gflops_per_proc,percent_of_peak"
+            ",rank_min,rank_avg,rank_max,imbalance,bytes_per_proc,gbytes_per_second_per_proc");
+        for (size_t i = 0; i < r.metrics.size(); i ++)
+            fprintf(out, ",%s", r.metrics[i].first.c_str());
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "%s,%s,%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d",
+        context.routine.c_str(), quote(context.label, true).c_str(), quote(context.host, true).c_str(), context.date.c_str(),
+        context.nprocs, r.c.nprows, r.c.npcols, r.c.mb, r.c.nb, r.c.m, r.c.n, r.c.k, r.c.nrhs,
+        context.warmup, int(r.t.back().size()));
+    for (size_t p = 0; p < r.phases.size(); p ++)
+    {
+        double tmin, tmedian, tmax;
+        statistics(r.t[p], tmin, tmedian, tmax);
+        fprintf(out, ",%.9g,%.9g,%.9g", tmin, tmedian, tmax);
+    }
+    efficiency_t e = efficiency(r, context.peak, context.nprocs);
+    fprintf(out, ",%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g", e.gflops, context.peak, e.percent,
+        e.rank_min, e.rank_avg, e.rank_max, e.imbalance, e.bytes, e.bandwidth);
+    for (size_t i = 0; i < r.metrics.size(); i ++)
+        fprintf(out, ",%.9g", r.metrics[i].second);
+    fprintf(out, "\n");
+    fclose(out);
+}
+
+static void write_json(const std::string& filename, const context_t& context, const std::vector<record_t>& records)
+{
+    FILE* out = fopen(filename.c_str(), "w");
+    if (!out)
+    {
+        printf("Unable to write %s\n", filename.c_str());
+        return;
+    }
+
+    fprintf(out, "{\n  \"routine\": %s,\n  \"label\": %s,\n  \"host\": %s,\n  \"date\": %s,\n"
+        "  \"nprocs\": %d,\n  \"warmup\": %d,\n  \"peak_gflops_per_proc\": %s,\n  \"cases\": [",
+        quote(context.routine).c_str(), quote(context.label).c_str(), quote(context.host).c_str(),
+        quote(context.date).c_str(), context.nprocs, context.warmup, number(context.peak).c_str());
+    for (size_t i = 0; i < records.size(); i ++)
+    {
+        const record_t& r = records[i];
+        fprintf(out, "%s\n    {\"nprows\": %d, \"npcols\": %d, \"mb\": %d, \"nb\": %d, "
+            "\"m\": %d, \"n\": %d, \"k\": %d, \"nrhs\": %d,\n     \"phases\": {",
+            i ? "," : "", r.c.nprows, r.c.npcols, r.c.mb, r.c.nb, r.c.m, r.c.n, r.c.k, r.c.nrhs);
+        for (size_t p = 0; p < r.phases.size(); p ++)
+        {
+            double tmin, tmedian, tmax;
+            statistics(r.t[p], tmin, tmedian, tmax);
+            fprintf(out, "%s\n       %s: {\"min\": %s, \"median\": %s, \"max\": %s, \"trials\": [",
+                p ? "," : "", quote(r.phases[p]).c_str(),
+                number(tmin).c_str(), number(tmedian).c_str(), number(tmax).c_str());
+            for (size_t j = 0; j < r.t[p].size(); j ++)
+                fprintf(out, "%s%s", j ? ", " : "", number(r.t[p][j]).c_str());
+            fprintf(out, "]}");
+        }
+        efficiency_t e = efficiency(r, context.peak, context.nprocs);
+        fprintf(out, "},\n     \"gflops_per_proc\": %s, \"percent_of_peak\": %s, "
+            "\"rank_min\": %s, \"rank_avg\": %s, \"rank_max\": %s, \"imbalance\": %s,\n"
+            "     \"flops\": %s, \"bytes_per_proc\": %s, \"gbytes_per_second_per_proc\": %s, \"metrics\": {",
+            number(e.gflops).c_str(), number(e.percent).c_str(), number(e.rank_min).c_str(),
+            number(e.rank_avg).c_str(), number(e.rank_max).c_str(), number(e.imbalance).c_str(),
+            number(r.model.flops).c_str(), number(e.bytes).c_str(), number(e.bandwidth).c_str());
+        for (size_t j = 0; j < r.metrics.size(); j ++)
+        {
+            fprintf(out, "%s%s: %s", j ? ", " : "", quote(r.metrics[j].first).c_str(),
+                number(r.metrics[j].second).c_str());
+        }
+        fprintf(out, "}}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+}
+
+// Runs the warm-up and the trials of one case and collects the times
+// of the slowest process on process 0. Returns false if the routine
+// could not run the case.
+static bool run_case(benchmark_routine_t& routine, std::shared_ptr<blacs_grid_t> grid, const options_t& options,
+    record_t& record)
+{
+    const size_t nphases = record.phases.size() - 1;
+    record.t.assign(nphases + 1, std::vector<double>());
+    record.rank_min.clear();
+    record.rank_avg.clear();
+    record.rank_max.clear();
+
+    for (int trial = 0; trial < options.warmup + options.trials; trial ++)
+    {
+        bool verify = trial == options.warmup + options.trials - 1;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        benchmark_result_t result;
+        bool ok = routine.run(grid, record.c, verify, result);
+
+        // A routine may fail on some processes only, so every process
+        // must agree before any of them stops making collective calls
+        int status = ok ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (!status)
+            return false;
+        assert(result.t.size() == nphases);
+
+        if (trial < options.warmup)
+            continue;
+
+        // The total of each process is reduced too, so that the total is
+        // the time of the slowest process rather than a sum of maxima
+        std::vector<double> t(result.t);
+        double total = 0.0;
+        for (size_t p = 0; p < nphases; p ++)
+            total += t[p];
+        t.push_back(total);
+
+        std::vector<double> t_glob(nphases + 1);
+        MPI_Reduce(t.data(), t_glob.data(), int(nphases + 1), MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        for (size_t p = 0; p <= nphases; p ++)
+            record.t[p].push_back(t_glob[p]);
+
+        // The spread of the totals shows how evenly the work is divided
+        int    nprocs;
+        double t_min, t_sum;
+        MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+        MPI_Reduce(&total, &t_min, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&total, &t_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        record.rank_min.push_back(t_min);
+        record.rank_avg.push_back(t_sum/nprocs);
+        record.rank_max.push_back(t_glob[nphases]);
+
+        if (verify)
+            record.metrics = result.metrics;
+    }
+    return true;
+}
+
+int run_benchmark(int argc, char** argv, benchmark_routine_t& routine)
+{
+    int iam, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iam);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    options_t   options;
+    std::string bad;
+    if (!parse_arguments(argc, argv, routine, options, bad))
+    {
+        if (iam == 0)
+        {
+            printf("Invalid argument %s\n", bad.c_str()); fflush(stdout);
+        }
+        return 1;
+    }
+
+    context_t context;
+    context.routine = routine.name();
+    context.label   = options.label;
+    context.nprocs  = nprocs;
+    context.warmup  = options.warmup;
+    {
+        char name[MPI_MAX_PROCESSOR_NAME];
+        int  length = 0;
+        MPI_Get_processor_name(name, &length);
+        context.host = std::string(name, length);
+
+        char date[32];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+        context.date = date;
+    }
+
+    // Every process measures its own DGEMM rate at the same time
+    if (options.peak > 0.0)
+    {
+        context.peak = options.peak;
+    }
+    else
+    {
+        double peak = calibrate_peak()/1e9, sum;
+        MPI_Allreduce(&peak, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        context.peak = sum/nprocs;
+        if (iam == 0)
+        {
+            printf("Calibrated DGEMM peak = %10.7f Gflops/Proc\n", context.peak); fflush(stdout);
+        }
+    }
+
+    std::vector<std::string> phases = routine.phases();
+    phases.push_back("total");
+
+    std::vector<record_t> records;
+    int status = 0;
+    for (size_t g = 0; g < options.grids.size() && status == 0; g ++)
+    {
+        if (options.grids[g].first && options.grids[g].first * options.grids[g].second != nprocs)
+        {
+            if (iam == 0)
+            {
+                printf("Skipping the %d x %d grid, which does not use all %d processes\n",
+                    options.grids[g].first, options.grids[g].second, nprocs); fflush(stdout);
+            }
+            continue;
+        }
+
+        for (size_t b = 0; b < options.blocks.size() && status == 0; b ++)
+        for (size_t in = 0; in < options.n.size() && status == 0; in ++)
+        for (size_t im = 0; im < std::max(size_t(1), options.m.size()) && status == 0; im ++)
+        for (size_t ik = 0; ik < std::max(size_t(1), options.k.size()) && status == 0; ik ++)
+        for (size_t ir = 0; ir < options.nrhs.size() && status == 0; ir ++)
+        {
+            benchmark_case_t c;
+            c.n      = options.n[in];
+            c.m      = options.m.empty() ? c.n : options.m[im];
+            c.k      = options.k.empty() ? c.n : options.k[ik];
+            c.nrhs   = options.nrhs[ir];
+            c.mb     = options.blocks[b].first;
+            c.nb     = options.blocks[b].second;
+            c.nprows = options.grids[g].first;
+            c.npcols = options.grids[g].second;
+
+            auto grid = configure(routine, c, options.tune);
+
+            record_t record;
+            record.c        = c;
+            record.c.mb     = tuner_t::active()->mb;
+            record.c.nb     = tuner_t::active()->nb;
+            record.c.nprows = grid->nprows();
+            record.c.npcols = grid->npcols();
+            record.phases   = phases;
+            if (!run_case(routine, grid, options, record))
+            {
+                status = 1;
+                break;
+            }
+            record.model = routine.model(record.c);
+
+            if (iam == 0)
+            {
+                print_summary(routine, record, context.peak, nprocs);
+                if (!options.csv.empty())
+                    write_csv(options.csv, context, record);
+            }
+            records.push_back(record);
+        }
+    }
+    tuner_t::clear();
+
+    if (iam == 0 && !options.json.empty())
+        write_json(options.json, context, records);
+    return status;
+}
@@ -0,0 +1,163 @@
+// -*- mode: c++ -*-
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "blacs_grid.h"
+#include "perf_model.h"
+
+/// <summary>
+///   The problem sizes, block sizes and grid shape of one benchmark case.
+///   Each routine uses the sizes that apply to it and ignores the others.
+/// </summary>
+struct benchmark_case_t
+{
+    blas_idx_t m;
+    blas_idx_t n;
+    blas_idx_t k;
+    blas_idx_t nrhs;
+
+    /// <summary>
+    ///   The block sizes, or zero to use the tuned or default block size.
+    /// </summary>
+    blas_idx_t mb;
+    blas_idx_t nb;
+
+    /// <summary>
+    ///   The grid shape, or zero to use the tuned or default grid.
+    /// </summary>
+    blas_idx_t nprows;
+    blas_idx_t npcols;
+};
+
+/// <summary>
+///   The outcome of one run of a benchmarked routine on the calling process.
+/// </summary>
+struct benchmark_result_t
+{
+    /// <summary>
+    ///   The time taken by each phase, in the order of the routine's phases().
+    /// </summary>
+    std::vector<double> t;
+
+    /// <summary>
+    ///   Named verification results such as the residual, which are
+    ///   reported as they are computed by process 0.
+    /// </summary>
+    std::vector<std::pair<std::string, double> > metrics;
+};
+
+/// <summary>
+///   The interface a ScaLAPACK routine implements to be run by
+///   run_benchmark.
+/// </summary>
+class benchmark_routine_t
+{
+public:
+    virtual ~benchmark_routine_t() {}
+
+    /// <summary>
+    ///   Returns the short name of the routine, such as "gesv", under which
+    ///   tuning results and benchmark records are stored.
+    /// </summary>
+    virtual std::string name() const = 0;
+
+    /// <summary>
+    ///   Returns the heading of the printed summary, such as "MATRIX SOLVE".
+    /// </summary>
+    virtual std::string title() const = 0;
+
+    /// <summary>
+    ///   Returns the names of the separately timed phases, such as
+    ///   "PxGETRF" and "PxGETRI".
+    /// </summary>
+    virtual std::vector<std::string> phases() const = 0;
+
+    /// <summary>
+    ///   Returns the sizes the routine uses, separated by spaces, out of
+    ///   "m", "n", "k" and "nrhs". They are the ones printed in the summary.
+    /// </summary>
+    virtual std::string sizes() const = 0;
+
+    /// <summary>
+    ///   Returns the names of the positional command line arguments,
+    ///   separated by spaces. Names other than the sizes are passed to
+    ///   set_option, so that "n a_file" accepts "lu 4096 a.bin".
+    /// </summary>
+    virtual std::string arguments() const = 0;
+
+    /// <summary>
+    ///   Returns the case that is run when no sizes are given.
+    /// </summary>
+    virtual benchmark_case_t defaults() const = 0;
+
+    /// <summary>
+    ///   Handles a routine-specific argument, given either as key=value or
+    ///   as -key with an empty value, and returns false if it is unknown.
+    /// </summary>
+    virtual bool set_option(const std::string& /*key*/, const std::string& /*value*/)
+    {
+        return false;
+    }
+
+    /// <summary>
+    ///   Returns the floating point operations of the case and the bytes
+    ///   each process receives. The case holds the grid shape and block
+    ///   sizes it ran with, and it is called after the case has run.
+    /// </summary>
+    virtual perf_count_t model(const benchmark_case_t& c) const = 0;
+
+    /// <summary>
+    ///   Creates the matrices of the case on the given grid, runs the
+    ///   routine once and stores the time of each phase in result.t. The
+    ///   block sizes of the case are active, so the matrices should be
+    ///   created with the factory functions. If verify is true the
+    ///   solution is also checked and the outcome stored in result.metrics.
+    ///   Returns false if the case cannot be run. Every process must call
+    ///   this method.
+    /// </summary>
+    virtual bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify,
+        benchmark_result_t& result) = 0;
+};
+
+/// <summary>
+///   Runs a routine over every combination of the problem sizes, block
+///   sizes and grid shapes given on the command line and reports the
+///   minimum, median and maximum time of each phase over repeated trials.
+///   Returns the exit status for main. Every process must call this
+///   function, between MPI_Init and MPI_Finalize.
+/// </summary>
+/// <remark>
+///   Besides the routine's positional arguments, the command line takes
+///   any of the following, where each list is comma-separated:
+///     m=, n=, k=, nrhs=LIST: The problem sizes to sweep. M and K default
+///         to N, or to the routine's defaults when N is not given either.
+///     mb=, nb=LIST: The block sizes to sweep. If only one is given the
+///         blocks are square.
+///     grid=PxQ,...: The grid shapes to sweep, such as grid=2x4,4x2.
+///         Shapes that do not use every process are skipped.
+///     warmup=COUNT: Untimed runs before the trials (DEFAULT 1).
+///     trials=COUNT: Timed runs of every case (DEFAULT 3).
+///     csv=FILE: Appends one row per case to FILE, writing a header
+///         first if the file is new.
+///     json=FILE: Writes every case, with the time of each trial, to FILE.
+///     label=TEXT: A tag such as the library version or cluster partition
+///         stored with each record.
+///     peak=GFLOPS: The DGEMM rate of one process, instead of measuring
+///         it with calibrate_peak at startup.
+///     -tune: Runs the autotuner for each case without an explicit grid
+///         or block size before it is benchmarked.
+///   The time of a phase in a trial is the maximum over all processes,
+///   and only the last trial of each case verifies its result. Besides
+///   the times, each case reports Gflops per process (10^9 operations)
+///   as a percentage of the peak, the minimum, average and maximum total
+///   time over the processes with the imbalance ratio maximum / average,
+///   and the modelled bytes received per process and their rate, all
+///   taken as the median over the trials.
+/// </remark>
+int run_benchmark(int argc, char** argv, benchmark_routine_t& routine);
+
+#endif // _BENCHMARK_H_
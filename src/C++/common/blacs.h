@@ -42,7 +42,7 @@ extern "C"
     DLLIMPORT void blacs_pinfo_ (blas_idx_t &, blas_idx_t &);
     DLLIMPORT void blacs_setup_ (blas_idx_t &, blas_idx_t &);
     DLLIMPORT void blacs_gridinit_ (blas_idx_t &, const char *, blas_idx_t &, blas_idx_t &);
-    DLLIMPORT void blacs_gridmap_ (blas_idx_t &, blas_idx_t &, blas_idx_t &, blas_idx_t &, blas_idx_t &);
+    DLLIMPORT void blacs_gridmap_ (blas_idx_t &, blas_idx_t *, blas_idx_t &, blas_idx_t &, blas_idx_t &);
     DLLIMPORT void blacs_abort_ (blas_idx_t &, blas_idx_t &);
     DLLIMPORT void blacs_gridexit_ (blas_idx_t &);
     DLLIMPORT void blacs_barrier_ (blas_idx_t &, char *);
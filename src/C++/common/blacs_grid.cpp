@@ -1,40 +1,267 @@
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <string>
 
+#include <mpi.h>
 #include "blacs.h"
 #include "blacs_grid.h"
+#include "trace.h"
+#include "tuning.h"
 
 
 blacs_grid_t::blacs_grid_t()
 {    
-    blacs_pinfo_ (m_iam, m_nprocs);
+    {
+        trace_scope_t scope("blacs_pinfo", trace_t::BLACS);
+        blacs_pinfo_ (m_iam, m_nprocs);
+    }
 
-    blas_idx_t negone = -1, zero = 0, one = 1;    
-    blacs_get_ (negone, zero, m_ictxt);
+    const tuning_config_t* tuned = tuner_t::active();
+    if (tuned && tuned->nprows * tuned->npcols == m_nprocs)
+    {
+        init(tuned->nprows, tuned->npcols, ROW_MAJOR);
+        return;
+    }
     
-    m_nprows = blas_idx_t(sqrt(double(m_nprocs)));
+    blas_idx_t nprows = blas_idx_t(sqrt(double(m_nprocs)));
+
+    while(m_nprocs % nprows)
+        nprows --;
+
+    init(nprows, m_nprocs/nprows, ROW_MAJOR);
+}
+
+blacs_grid_t::blacs_grid_t(blas_idx_t nprows, blas_idx_t npcols, order_t order /*= ROW_MAJOR*/)
+{
+    {
+        trace_scope_t scope("blacs_pinfo", trace_t::BLACS);
+        blacs_pinfo_ (m_iam, m_nprocs);
+    }
+    init(nprows, npcols, order);
+}
+
+blacs_grid_t::blacs_grid_t(blas_idx_t nprows, blas_idx_t npcols, const std::vector<blas_idx_t>& usermap)
+{
+    {
+        trace_scope_t scope("blacs_pinfo", trace_t::BLACS);
+        blacs_pinfo_ (m_iam, m_nprocs);
+    }
+    init(nprows, npcols, usermap);
+}
+
+void blacs_grid_t::init(blas_idx_t nprows, blas_idx_t npcols, order_t order)
+{
+    if (order == TOPOLOGY_AWARE)
+    {
+        init(nprows, npcols, topology_map(nprows, npcols));
+        return;
+    }
+
+    m_nprows = nprows;
+    m_npcols = npcols;
+
+    assert(m_nprows * m_npcols <= m_nprocs);
+
+    blas_idx_t negone = -1, zero = 0;    
+    blacs_get_ (negone, zero, m_ictxt);
+
+    const char* ordering = (order == COLUMN_MAJOR) ? "Col" : "Row";    
+
+    {
+        trace_scope_t scope("blacs_gridinit", trace_t::BLACS);
+        blacs_gridinit_ (m_ictxt, ordering, m_nprows, m_npcols);
+    }
+    init_info(nprows, npcols);
+}
+
+void blacs_grid_t::init(blas_idx_t nprows, blas_idx_t npcols, std::vector<blas_idx_t> usermap)
+{
+    m_nprows = nprows;
+    m_npcols = npcols;
+
+    assert(m_nprows * m_npcols <= m_nprocs);
+    assert(blas_idx_t(usermap.size()) == m_nprows * m_npcols);
+
+    blas_idx_t negone = -1, zero = 0;    
+    blacs_get_ (negone, zero, m_ictxt);
+
+    blas_idx_t ldumap = m_nprows;
+    {
+        trace_scope_t scope("blacs_gridmap", trace_t::BLACS);
+        blacs_gridmap_ (m_ictxt, usermap.data(), ldumap, m_nprows, m_npcols);
+    }
+    init_info(nprows, npcols);
+}
+
+void blacs_grid_t::init_info(blas_idx_t nprows, blas_idx_t npcols)
+{
+    // BLACS hands processes outside the grid a context of -1
+    if (m_ictxt >= 0)
+    {
+        blacs_gridinfo_ (m_ictxt, m_nprows, m_npcols, m_myrow, m_mycol);
+    }
+    else
+    {
+        m_myrow = m_mycol = -1;
+    }
+
+    m_nprows = nprows;
+    m_npcols = npcols;
+    m_nprocs = nprows * npcols;
+
+    int color = member() ? 0 : MPI_UNDEFINED;
+    int key   = member() ? int(m_myrow * m_npcols + m_mycol) : 0;
+    MPI_Comm_split(MPI_COMM_WORLD, color, key, &m_comm);
+}
+
+std::shared_ptr<blacs_grid_t> blacs_grid_t::split(blas_idx_t ngroups, blas_idx_t& group)
+{
+    blas_idx_t iam, nprocs;
+    {
+        trace_scope_t scope("blacs_pinfo", trace_t::BLACS);
+        blacs_pinfo_ (iam, nprocs);
+    }
+    assert(ngroups >= 1 && ngroups <= nprocs);
+
+    std::shared_ptr<blacs_grid_t> mine;
+    for (blas_idx_t g = 0; g < ngroups; g ++)
+    {
+        blas_idx_t first = g * nprocs / ngroups;
+        blas_idx_t size  = (g + 1) * nprocs / ngroups - first;
+
+        blas_idx_t nprows = blas_idx_t(sqrt(double(size)));
+        while(size % nprows)
+            nprows --;
+        blas_idx_t npcols = size / nprows;
+
+        std::vector<blas_idx_t> usermap(size);
+        for (blas_idx_t k = 0; k < size; k ++)
+            usermap[(k / npcols) + (k % npcols) * nprows] = first + k;
+
+        // Every process takes part in creating every grid, but only
+        // keeps the one it belongs to
+        auto grid = std::make_shared<blacs_grid_t>(nprows, npcols, usermap);
+        if (grid->member())
+        {
+            mine  = grid;
+            group = g;
+        }
+    }
+    return mine;
+}
+
+bool blacs_grid_t::member() const
+{
+    return m_myrow >= 0 && m_mycol >= 0;
+}
+
+MPI_Comm blacs_grid_t::comm() const
+{
+    return m_comm;
+}
+
+std::vector<blas_idx_t> blacs_grid_t::topology_map(blas_idx_t nprows, blas_idx_t npcols)
+{
+    int nprocs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    // Gather the processor name of every process and number the nodes
+    // in the order in which they first appear
+    char name[MPI_MAX_PROCESSOR_NAME] = {0};
+    int  length;
+    MPI_Get_processor_name(name, &length);
+
+    std::vector<char> names(size_t(nprocs) * MPI_MAX_PROCESSOR_NAME);
+    MPI_Allgather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 
+        names.data(), MPI_MAX_PROCESSOR_NAME, MPI_CHAR, MPI_COMM_WORLD);
 
-    while(m_nprocs % m_nprows)
-        m_nprows --;
+    std::vector<std::string>              nodes;
+    std::vector<std::vector<blas_idx_t> > ranks_on_node;
+    for (int rank = 0; rank < nprocs; rank ++)
+    {
+        std::string node(&names[size_t(rank) * MPI_MAX_PROCESSOR_NAME]);
+        size_t index = std::find(nodes.begin(), nodes.end(), node) - nodes.begin();
+        if (index == nodes.size())
+        {
+            nodes.push_back(node);
+            ranks_on_node.push_back(std::vector<blas_idx_t>());
+        }
+        ranks_on_node[index].push_back(rank);
+    }
 
-    m_npcols = m_nprocs/m_nprows;
+    std::vector<blas_idx_t> usermap(size_t(nprows) * npcols);
 
-    assert(m_nprows * m_npcols == m_nprocs);
+    // If every node has the same number of processes and the grid is made 
+    // up of exactly these nodes, give each node a tile of the grid that is 
+    // as square as possible, so that both the row and the column broadcasts
+    // cross as few nodes as possible
+    blas_idx_t ppn = blas_idx_t(ranks_on_node[0].size());
+    bool uniform = blas_idx_t(nodes.size()) * ppn == nprows * npcols;
+    for (size_t i = 0; i < ranks_on_node.size(); i ++)
+        uniform = uniform && blas_idx_t(ranks_on_node[i].size()) == ppn;
 
-    const char* row_major = "Row";    
+    blas_idx_t tile_rows = 0, tile_cols = 0;
+    for (blas_idx_t r = blas_idx_t(sqrt(double(ppn))); uniform && r >= 1 && !tile_rows; r --)
+    {
+        if (ppn % r)
+            continue;
+        if (nprows % r == 0 && npcols % (ppn / r) == 0)
+        {
+            tile_rows = r;
+            tile_cols = ppn / r;
+        }
+        else if (nprows % (ppn / r) == 0 && npcols % r == 0)
+        {
+            tile_rows = ppn / r;
+            tile_cols = r;
+        }
+    }
 
-    blacs_gridinit_ (m_ictxt, row_major, m_nprows, m_npcols);    
-    blacs_gridinfo_ (m_ictxt, m_nprows, m_npcols, m_myrow, m_mycol);
+    if (tile_rows)
+    {
+        blas_idx_t tiles_per_row = npcols / tile_cols;
+        for (blas_idx_t t = 0; t < blas_idx_t(nodes.size()); t ++)
+        {
+            for (blas_idx_t k = 0; k < ppn; k ++)
+            {
+                blas_idx_t i = (t / tiles_per_row) * tile_rows + k / tile_cols;
+                blas_idx_t j = (t % tiles_per_row) * tile_cols + k % tile_cols;
+                usermap[i + j * nprows] = ranks_on_node[t][k];
+            }
+        }
+    }
+    else
+    {
+        // Otherwise fill the grid in row-major order, node by node, so
+        // that at least the row broadcasts stay within a node
+        blas_idx_t position = 0;
+        for (size_t t = 0; t < ranks_on_node.size(); t ++)
+        {
+            for (size_t k = 0; k < ranks_on_node[t].size() && position < nprows * npcols; k ++, position ++)
+            {
+                usermap[(position / npcols) + (position % npcols) * nprows] = ranks_on_node[t][k];
+            }
+        }
+    }
+    return usermap;
 }
 
-blas_idx_t blacs_grid_t::local_rows(blas_idx_t global_rows, blas_idx_t row_block_size, blas_idx_t row_offset /*= 0*/)
+blas_idx_t blacs_grid_t::local_rows(blas_idx_t global_rows, blas_idx_t row_block_size, blas_idx_t row_src /*= 0*/)
 {
-    return numroc_ (global_rows, row_block_size, m_myrow, row_offset, m_nprows);    
+    // Processes outside the grid own nothing, and NUMROC would count
+    // blocks for a process row of -1
+    if (!member())
+        return 0;
+    return numroc_ (global_rows, row_block_size, m_myrow, row_src, m_nprows);    
 }
 
-blas_idx_t blacs_grid_t::local_cols(blas_idx_t global_cols, blas_idx_t col_block_size, blas_idx_t col_offset /*= 0*/)
+blas_idx_t blacs_grid_t::local_cols(blas_idx_t global_cols, blas_idx_t col_block_size, blas_idx_t col_src /*= 0*/)
 {
-    return numroc_ (global_cols, col_block_size, m_mycol, col_offset, m_npcols); 
+    if (!member())
+        return 0;
+    return numroc_ (global_cols, col_block_size, m_mycol, col_src, m_npcols); 
 }
 
 blas_idx_t blacs_grid_t::nprows() const
@@ -59,7 +286,14 @@ blas_idx_t blacs_grid_t::mypcol() const
 
 blacs_grid_t::~blacs_grid_t()
 {
-    blacs_gridexit_(m_ictxt);
+    // Processes left out of the grid do not get a valid context
+    if (m_ictxt >= 0)
+    {
+        trace_scope_t scope("blacs_gridexit", trace_t::BLACS);
+        blacs_gridexit_(m_ictxt);
+    }
+    if (m_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&m_comm);
 }
 
 blas_idx_t blacs_grid_t::iam() const
@@ -1,5 +1,8 @@
 #ifndef _BLACS_GRID_H_
 #define _BLACS_GRID_H_
+#include <memory>
+#include <vector>
+#include <mpi.h>
 #include "index.h"
 
 /// <summary>
@@ -9,6 +12,16 @@
 class blacs_grid_t 
 {
 public:
+    /// <summary>
+    ///   How processes are assigned to positions in the grid.
+    ///     ROW_MAJOR: Processes are numbered along the process rows (DEFAULT).
+    ///     COLUMN_MAJOR: Processes are numbered down the process columns.
+    ///     TOPOLOGY_AWARE: Processes on the same node are placed next to 
+    ///         each other, as a rectangular tile of the grid where possible,
+    ///         so that row and column broadcasts stay within a node.
+    /// </summary>
+    enum order_t {ROW_MAJOR, COLUMN_MAJOR, TOPOLOGY_AWARE};
+
     /// <summary>
     ///   Creates a two-dimensional process grid such the
     ///   number of process rows is roughly equal to the 
@@ -19,9 +32,94 @@ public:
     ///   to create a two-dimensional process grid with processes
     ///   numbered in row-major order and then calls BLACS_GRIDINFO
     ///   to populate information such as the number of process rows
-    ///   and process columns
+    ///   and process columns. If a tuned configuration has been 
+    ///   selected with tuner_t::select, its grid shape is used instead.
     /// </remark>
     blacs_grid_t();
+
+    /// <summary>
+    ///   Creates a two-dimensional process grid with the given
+    ///   number of process rows and process columns.
+    /// </summary>
+    /// <param name="nprows">
+    ///   The number of process rows.
+    /// </param>
+    /// <param name="npcols">
+    ///   The number of process columns.
+    /// </param>
+    /// <param name="order">
+    ///   How processes are assigned to grid positions, defaults
+    ///   to ROW_MAJOR.
+    /// </param>
+    /// <remark>
+    ///   The product nprows x npcols must not exceed the number of
+    ///   processes. Processes left out of the grid have a process 
+    ///   row and column of -1. TOPOLOGY_AWARE finds the node of each
+    ///   process from MPI_Get_processor_name and creates the grid with 
+    ///   the BLACS_GRIDMAP subroutine; every process must call it.
+    /// </remark>
+    blacs_grid_t(blas_idx_t nprows, blas_idx_t npcols, order_t order = ROW_MAJOR);
+
+    /// <summary>
+    ///   Creates a two-dimensional process grid from an explicit
+    ///   map of process numbers to grid positions.
+    /// </summary>
+    /// <param name="nprows">
+    ///   The number of process rows.
+    /// </param>
+    /// <param name="npcols">
+    ///   The number of process columns.
+    /// </param>
+    /// <param name="usermap">
+    ///   An nprows x npcols array stored in column-major order, whose 
+    ///   entry (i, j) is the process placed at process row i and 
+    ///   process column j.
+    /// </param>
+    /// <remark>
+    ///   The constructor calls the BLACS_GRIDMAP subroutine, which
+    ///   every process must call.
+    /// </remark>
+    blacs_grid_t(blas_idx_t nprows, blas_idx_t npcols, const std::vector<blas_idx_t>& usermap);
+
+    /// <summary>
+    ///   Returns a map of process numbers to grid positions, in the
+    ///   format accepted by the constructor, that places processes on
+    ///   the same node next to each other. Every process must call 
+    ///   this method.
+    /// </summary>
+    static std::vector<blas_idx_t> topology_map(blas_idx_t nprows, blas_idx_t npcols);
+
+    /// <summary>
+    ///   Splits the processes into disjoint process grids, so that 
+    ///   independent problems can be solved concurrently, and returns
+    ///   the grid that the calling process belongs to.
+    /// </summary>
+    /// <param name="ngroups">
+    ///   The number of grids to create. Processes are assigned to grids
+    ///   in contiguous blocks of ranks of nearly equal size, and each
+    ///   grid is as square as possible.
+    /// </param>
+    /// <param name="group">
+    ///   On return, the index of the grid that the calling process 
+    ///   belongs to.
+    /// </param>
+    /// <remark>
+    ///   Every process must call this method, because BLACS_GRIDMAP is
+    ///   collective over all processes in the system.
+    /// </remark>
+    static std::shared_ptr<blacs_grid_t> split(blas_idx_t ngroups, blas_idx_t& group);
+
+    /// <summary>
+    ///   Returns true if the calling process is part of the grid.
+    /// </summary>
+    bool member() const;
+
+    /// <summary>
+    ///   Returns an MPI communicator over the processes in the grid, in 
+    ///   which the rank of each process is its row-major position in 
+    ///   the grid. It is MPI_COMM_NULL in processes outside the grid.
+    /// </summary>
+    MPI_Comm comm() const;
     
     /// <summary>
     ///   Returns the number of rows in the process grid.
@@ -41,7 +139,8 @@ public:
     blas_idx_t nprocs() const;
 
     /// <summary>
-    ///   Returns the rank of the calling process.
+    ///   Returns the rank of the calling process among all processes,
+    ///   which is the same for every grid.
     /// </summary>
     blas_idx_t iam() const;
 
@@ -71,15 +170,16 @@ public:
     ///   The blocking factor for the rows. This corresponds
     ///   to the factor MB in ScaLAPACK.
     /// </param>    
-    /// <param name="row_offset">
-    ///   The starting global row offset of the matrix. This
-    ///   corresponds to the factor IA in ScaLAPACK and defaults
-    ///   to zero.
+    /// <param name="row_src">
+    ///   The process row over which the first row of the matrix
+    ///   is distributed. This corresponds to the factor RSRC in
+    ///   ScaLAPACK and defaults to zero.
     /// </param>
     /// <remark>
-    ///   This method internally calls the NUMROC subroutine in BLACS.
+    ///   This method internally calls the NUMROC subroutine in BLACS, and
+    ///   returns zero in processes outside the grid.
     /// </remark>
-    blas_idx_t local_rows(blas_idx_t global_rows, blas_idx_t row_block_size, blas_idx_t row_offset = 0);
+    blas_idx_t local_rows(blas_idx_t global_rows, blas_idx_t row_block_size, blas_idx_t row_src = 0);
 
     /// <summary>
     ///   Given a global number of columns and a column block size
@@ -92,19 +192,24 @@ public:
     ///   The blocking factor for the columns. This corresponds
     ///   to the factor NB in ScaLAPACK.
     /// </param>    
-    /// <param name="col_offset">
-    ///   The starting global column offset of the matrix. This
-    ///   corresponds to the factor JA in ScaLAPACK and defaults
-    ///   to zero.
+    /// <param name="col_src">
+    ///   The process column over which the first column of the 
+    ///   matrix is distributed. This corresponds to the factor CSRC
+    ///   in ScaLAPACK and defaults to zero.
     /// </param>
     /// <remark>
-    ///   This method internally calls the NUMROC subroutine in BLACS.
+    ///   This method internally calls the NUMROC subroutine in BLACS, and
+    ///   returns zero in processes outside the grid.
     /// </remark>
-    blas_idx_t local_cols(blas_idx_t global_cols, blas_idx_t col_block_size, blas_idx_t col_offset = 0);
+    blas_idx_t local_cols(blas_idx_t global_cols, blas_idx_t col_block_size, blas_idx_t col_src = 0);
     
     virtual ~blacs_grid_t();
 
 private:
+    void init(blas_idx_t nprows, blas_idx_t npcols, order_t order);
+    void init(blas_idx_t nprows, blas_idx_t npcols, std::vector<blas_idx_t> usermap);
+    void init_info(blas_idx_t nprows, blas_idx_t npcols);
+
     blas_idx_t m_ictxt;
     blas_idx_t m_iam;
     blas_idx_t m_nprocs;
@@ -112,6 +217,7 @@ private:
     blas_idx_t m_npcols;
     blas_idx_t m_myrow;
     blas_idx_t m_mycol;
+    MPI_Comm   m_comm;
 
     // Mark this class as non-copyable
     blacs_grid_t(const blacs_grid_t&);
@@ -1,108 +1,537 @@
 #include <algorithm>
 #include <numeric>
-#include <random>
+#include <sstream>
+#include <vector>
 
+#include <mpi.h>
 #include "block_cyclic_mat.h"
-#include "scalapack.h"
+#include "counter_rng.h"
+#include "generators.h"
+#include "scalapack_traits.h"
+#include "tuning.h"
 
-block_cyclic_mat_t::block_cyclic_mat_t(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, blas_idx_t mb, blas_idx_t nb, fill_t fill /*= EMPTY*/, double alpha /*= 0.0*/) : m_grid(grid), m_global_rows(global_rows), m_global_cols(global_cols)
+static void print_element(int i, double v)
+{
+    printf("local[%d] = %lf\n", i, v);
+}
+
+template <typename R>
+static void print_element(int i, const std::complex<R>& v)
+{
+    printf("local[%d] = (%lf, %lf)\n", i, double(v.real()), double(v.imag()));
+}
+
+template <typename T>
+basic_block_cyclic_mat_t<T>::basic_block_cyclic_mat_t(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, blas_idx_t mb, blas_idx_t nb, fill_t fill /*= EMPTY*/, T alpha /*= T()*/, const storage_policy_t& storage /*= storage_policy_t::default_policy()*/, blas_idx_t row_src /*= 0*/, blas_idx_t col_src /*= 0*/)
+{
+    init(grid, global_rows, global_cols, mb, nb, fill, alpha, storage, row_src, col_src);
+}
+
+template <typename T>
+void basic_block_cyclic_mat_t<T>::init(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, blas_idx_t mb, blas_idx_t nb, fill_t fill, T alpha, const storage_policy_t& storage, blas_idx_t row_src, blas_idx_t col_src)
 {    
+    m_grid         = grid;
+    m_global_rows  = global_rows;
+    m_global_cols  = global_cols;
+    m_version      = 0;
     m_mb           = mb;
     m_nb           = nb;
-    m_local_rows   = m_grid -> local_rows(m_global_rows, mb);
-    m_local_cols   = m_grid -> local_cols(m_global_cols, nb);    
+    m_local_rows   = m_grid -> local_rows(m_global_rows, mb, row_src);
+    m_local_cols   = m_grid -> local_cols(m_global_cols, nb, col_src);    
     m_desc[DTYPE_] = 1;
     m_desc[CTXT_]  = m_grid->context();
     m_desc[M_]     = global_rows;
     m_desc[N_]     = global_cols;
     m_desc[MB_]    = mb;
     m_desc[NB_]    = nb;
-    m_desc[RSRC_]  = 0;
-    m_desc[CSRC_]  = 0;
-    m_desc[LLD_]   = m_local_rows;
+    m_desc[RSRC_]  = row_src;
+    m_desc[CSRC_]  = col_src;
+    // Processes outside the grid hold no elements and keep LLD_A = 1, as
+    // ScaLAPACK requires of any descriptor
+    m_desc[LLD_]   = std::max(blas_idx_t(1), m_local_rows);
 
     m_local_size = m_local_rows * m_local_cols;
-    m_local_data.resize(m_local_size);
+
+    storage_policy_t policy = storage;
+    if (policy.kind == storage_policy_t::MAPPED_FILE)
+    {
+        std::ostringstream filename;
+        filename << policy.filename << "." << m_grid->iam();
+        policy.filename = filename.str();
+    }
+    m_local_data.reset(new local_storage_t(m_local_size * sizeof(T), policy));
+
+    T* local_begin = local_data();
+    T* local_end   = local_begin + m_local_size;
 
     switch(fill)
     {
     case CONSTANT:
         {
-            std::fill(m_local_data.begin(), m_local_data.end(), alpha);
+            std::fill(local_begin, local_end, alpha);
             break;
         }        
     case DIAGONAL:
         {
+            if (!m_grid->member())
+                break;
             char uplo='A';
             blas_idx_t ia = 1, ja = 1;
-            double zero = 0.0;
-            pdlaset_(uplo, m_global_rows, m_global_cols, zero, alpha, m_local_data.data(), ia, ja, m_desc);
+            T zero = T();
+            scalapack_traits<T>::laset(uplo, m_global_rows, m_global_cols, zero, alpha, local_begin, ia, ja, m_desc);
             break;
         }        
     case RANDOM:
         {
-            std::mt19937_64 engine(1000*m_grid->iam());
-            std::uniform_real_distribution<double> rng;
-            std::generate(m_local_data.begin(), m_local_data.end(), [&]() {return rng(engine);});
+            randomize();
             break;
         }        
     }
 }
 
-void block_cyclic_mat_t::print() const
+// Builds the MPI datatype that selects the blocks owned by the calling
+// process out of a column-major file holding the global matrix. The
+// darray distribution always places the first block on process (0,0), so
+// the process coordinates are shifted by RSRC_A/CSRC_A before computing the
+// row-major rank that MPI_Type_create_darray expects.
+static MPI_Datatype make_file_view(const blas_idx_t* desc, const blacs_grid_t& grid, MPI_Datatype element)
+{
+    int nprows = int(grid.nprows());
+    int npcols = int(grid.npcols());
+    int prow   = int((grid.myprow() - desc[RSRC_] + nprows) % nprows);
+    int pcol   = int((grid.mypcol() - desc[CSRC_] + npcols) % npcols);
+
+    int gsizes[2]   = {int(desc[M_]), int(desc[N_])};
+    int distribs[2] = {MPI_DISTRIBUTE_CYCLIC, MPI_DISTRIBUTE_CYCLIC};
+    int dargs[2]    = {int(desc[MB_]), int(desc[NB_])};
+    int psizes[2]   = {nprows, npcols};
+
+    MPI_Datatype filetype;
+    MPI_Type_create_darray(nprows * npcols, prow * npcols + pcol, 2, 
+        gsizes, distribs, dargs, psizes, 
+        MPI_ORDER_FORTRAN, element, &filetype);
+    MPI_Type_commit(&filetype);
+    return filetype;
+}
+
+// Returns true on every process of the communicator if ok is true on all
+// of them, so that they all take the same branch afterwards
+static bool all_ranks(bool ok, MPI_Comm comm)
+{
+    int flag = ok ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &flag, 1, MPI_INT, MPI_MIN, comm);
+    return flag == 1;
+}
+
+// Reads or writes the local panel through the file view in chunks, since
+// MPI counts are ints, with every process making the same number of
+// collective calls. Returns false unless every element was transferred.
+template <typename T>
+static bool transfer_all(MPI_File fh, T* data, long long size, MPI_Datatype element, bool write, MPI_Comm comm)
+{
+    const long long chunk = 1LL << 30;
+    long long chunks = (size + chunk - 1) / chunk;
+    MPI_Allreduce(MPI_IN_PLACE, &chunks, 1, MPI_LONG_LONG, MPI_MAX, comm);
+
+    bool ok = true;
+    for (long long c = 0; c < chunks; c ++)
+    {
+        long long  first = std::min(c * chunk, size);
+        int        count = int(std::min(chunk, size - first));
+        MPI_Status status;
+        int rc = write ? MPI_File_write_all(fh, data + first, count, element, &status)
+                       : MPI_File_read_all(fh, data + first, count, element, &status);
+
+        int done = 0;
+        if (rc == MPI_SUCCESS)
+            MPI_Get_count(&status, element, &done);
+        ok = ok && rc == MPI_SUCCESS && done == count;
+    }
+    return ok;
+}
+
+template <typename T>
+bool basic_block_cyclic_mat_t<T>::load(const char* filename)
+{
+    MPI_Datatype element = scalapack_traits<T>::mpi_type();
+    MPI_Comm     comm    = m_grid->comm();
+    MPI_File     fh;
+    int rc = MPI_File_open(comm, const_cast<char*>(filename), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+    if (!all_ranks(rc == MPI_SUCCESS, comm))
+    {
+        if (rc == MPI_SUCCESS)
+            MPI_File_close(&fh);
+        return false;
+    }
+
+    MPI_Datatype filetype = make_file_view(m_desc, *m_grid, element);
+    rc = MPI_File_set_view(fh, 0, element, filetype, const_cast<char*>("native"), MPI_INFO_NULL);
+
+    // The local panel has LLD_A == LOCr(M_A), so the blocks selected by the
+    // file view land in the local buffer in exactly the order ScaLAPACK
+    // expects. A file shorter than the matrix is rejected up front, since
+    // not every implementation reports short collective reads.
+    MPI_Offset size = 0;
+    if (rc == MPI_SUCCESS)
+        rc = MPI_File_get_size(fh, &size);
+    bool ok = all_ranks(rc == MPI_SUCCESS && size >= MPI_Offset(m_global_rows) * m_global_cols * MPI_Offset(sizeof(T)), comm);
+    if (ok)
+        ok = transfer_all(fh, static_cast<T*>(m_local_data->data()), m_local_size, element, false, comm);
+
+    MPI_Type_free(&filetype);
+    MPI_File_close(&fh);
+    mark_modified();
+    return all_ranks(ok, comm);
+}
+
+template <typename T>
+bool basic_block_cyclic_mat_t<T>::save(const char* filename) const
+{
+    MPI_Datatype element = scalapack_traits<T>::mpi_type();
+    MPI_Comm     comm    = m_grid->comm();
+    MPI_File     fh;
+    int rc = MPI_File_open(comm, const_cast<char*>(filename), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh);
+    if (!all_ranks(rc == MPI_SUCCESS, comm))
+    {
+        if (rc == MPI_SUCCESS)
+            MPI_File_close(&fh);
+        return false;
+    }
+
+    MPI_Offset size = MPI_Offset(m_global_rows) * m_global_cols * sizeof(T);
+    rc = MPI_File_set_size(fh, size);
+
+    MPI_Datatype filetype = make_file_view(m_desc, *m_grid, element);
+    if (rc == MPI_SUCCESS)
+        rc = MPI_File_set_view(fh, 0, element, filetype, const_cast<char*>("native"), MPI_INFO_NULL);
+
+    bool ok = all_ranks(rc == MPI_SUCCESS, comm);
+    if (ok)
+        ok = transfer_all(fh, static_cast<T*>(const_cast<void*>(m_local_data->data())), m_local_size, element, true, comm);
+
+    MPI_Type_free(&filetype);
+    MPI_File_close(&fh);
+    return all_ranks(ok, comm);
+}
+
+// Returns true if a dimension distributed with block size b1 from source
+// process p1 keeps the same local order when distributed with b2 from p2
+// over nprocs processes: the layouts are the same, or every index is local
+static bool same_distribution(blas_idx_t b1, blas_idx_t p1, blas_idx_t b2, blas_idx_t p2, blas_idx_t nprocs)
+{
+    return nprocs == 1 || (b1 == b2 && p1 == p2);
+}
+
+// The process coordinate that owns global index i, from zero, of a
+// dimension distributed with block size b from process src over nprocs
+static blas_idx_t owner(blas_idx_t i, blas_idx_t b, blas_idx_t src, blas_idx_t nprocs)
+{
+    return (i / b + src) % nprocs;
+}
+
+// Copies A into B, which has the same grid and global size but other block
+// sizes or source processes. Each process sends every other process the
+// elements it owns in A and that process owns in B, with one
+// MPI_Alltoallv over the grid. Both sides list the elements a pair
+// exchanges in column-major global order, which is also the order of
+// their local panels, so no indices are sent.
+template <typename T>
+static void exchange_blocks(basic_block_cyclic_mat_t<T>& a, basic_block_cyclic_mat_t<T>& b)
+{
+    auto       grid   = a.grid();
+    blas_idx_t nprows = grid->nprows(), npcols = grid->npcols();
+    blas_idx_t nprocs = nprows * npcols;
+    blas_idx_t* da = a.descriptor();
+    blas_idx_t* db = b.descriptor();
+
+    // The rank in the row-major grid communicator of the other process
+    // for each local row and column, and the counts per rank
+    std::vector<blas_idx_t> send_row(a.local_rows()), send_col(a.local_cols());
+    std::vector<blas_idx_t> recv_row(b.local_rows()), recv_col(b.local_cols());
+    for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+        send_row[il] = owner(a.global_row(il), db[MB_], db[RSRC_], nprows) * npcols;
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+        send_col[jl] = owner(a.global_col(jl), db[NB_], db[CSRC_], npcols);
+    for (blas_idx_t il = 0; il < b.local_rows(); il ++)
+        recv_row[il] = owner(b.global_row(il), da[MB_], da[RSRC_], nprows) * npcols;
+    for (blas_idx_t jl = 0; jl < b.local_cols(); jl ++)
+        recv_col[jl] = owner(b.global_col(jl), da[NB_], da[CSRC_], npcols);
+
+    std::vector<int> send_counts(nprocs, 0), recv_counts(nprocs, 0);
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+        for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+            send_counts[send_row[il] + send_col[jl]] ++;
+    for (blas_idx_t jl = 0; jl < b.local_cols(); jl ++)
+        for (blas_idx_t il = 0; il < b.local_rows(); il ++)
+            recv_counts[recv_row[il] + recv_col[jl]] ++;
+
+    std::vector<int> send_displs(nprocs, 0), recv_displs(nprocs, 0);
+    for (blas_idx_t p = 1; p < nprocs; p ++)
+    {
+        send_displs[p] = send_displs[p - 1] + send_counts[p - 1];
+        recv_displs[p] = recv_displs[p - 1] + recv_counts[p - 1];
+    }
+
+    std::vector<T> send(size_t(a.local_size())), recv(size_t(b.local_size()));
+    std::vector<int> next(send_displs);
+    blas_idx_t lda = da[LLD_];
+    const T*   src = a.local_data();
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+        for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+            send[next[send_row[il] + send_col[jl]] ++] = src[il + jl * lda];
+
+    MPI_Datatype element = scalapack_traits<T>::mpi_type();
+    MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), element,
+        recv.data(), recv_counts.data(), recv_displs.data(), element, grid->comm());
+
+    next = recv_displs;
+    blas_idx_t ldb = db[LLD_];
+    T*         dst = b.local_data();
+    for (blas_idx_t jl = 0; jl < b.local_cols(); jl ++)
+        for (blas_idx_t il = 0; il < b.local_rows(); il ++)
+            dst[il + jl * ldb] = recv[next[recv_row[il] + recv_col[jl]] ++];
+    b.mark_modified();
+}
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::redistribute(std::shared_ptr<blacs_grid_t> grid, blas_idx_t mb, blas_idx_t nb, blas_idx_t row_src /*= 0*/, blas_idx_t col_src /*= 0*/)
 {
+    auto b = std::make_shared<basic_block_cyclic_mat_t>(grid, m_global_rows, m_global_cols, mb, nb, 
+        ZERO, T(), m_local_data->policy(), row_src, col_src);
+
+    // Processes outside both grids have a context of -1 in each, so the
+    // grids are compared by identity, which every process agrees on.
+    // Outside a shared grid there is nothing to copy.
+    bool same_grid = grid.get() == m_grid.get();
+    if (same_grid && !grid->member())
+        return b;
+    if (same_grid && 
+        same_distribution(m_mb, m_desc[RSRC_], mb, row_src, grid->nprows()) &&
+        same_distribution(m_nb, m_desc[CSRC_], nb, col_src, grid->npcols()))
+    {
+        std::copy_n(local_data(), m_local_size, b->local_data());
+        return b;
+    }
+
+    blas_idx_t ia = 1, ja = 1, ib = 1, jb = 1;
+    if (same_grid)
+    {
+        exchange_blocks(*this, *b);
+    }
+    else
+    {
+        // PxGEMR2D needs a context spanning the union of both grids, so
+        // use a 1 x P grid over every process in the system
+        blas_idx_t negone = -1, zero = 0, one = 1;
+        blas_idx_t ictxt, iam, nprocs;
+        blacs_pinfo_ (iam, nprocs);
+        blacs_get_ (negone, zero, ictxt);
+        const char* row_major = "Row";
+        blacs_gridinit_ (ictxt, row_major, one, nprocs);
+
+        scalapack_traits<T>::gemr2d(m_global_rows, m_global_cols, 
+            local_data(), ia, ja, m_desc, 
+            b->local_data(), ib, jb, b->descriptor(), 
+            ictxt);
+        blacs_gridexit_ (ictxt);
+    }
+    return b;
+}
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::redistribute(blas_idx_t mb, blas_idx_t nb)
+{
+    return redistribute(m_grid, mb, nb, m_desc[RSRC_], m_desc[CSRC_]);
+}
+
+template <typename T>
+void basic_block_cyclic_mat_t<T>::print() const
+{
+    const T* data = static_cast<const T*>(m_local_data->data());
     for(int i = 0; i < m_local_size; i ++) 
     {
-        printf("local[%d] = %lf\n", i, m_local_data[i]); fflush(stdout);
+        print_element(i, data[i]); fflush(stdout);
     }
 }
 
-blas_idx_t block_cyclic_mat_t::local_size() const
+template <typename T>
+void basic_block_cyclic_mat_t<T>::print_storage() const
+{
+    static const char* kinds[] = {"HEAP", "ANONYMOUS", "MAPPED_FILE"};
+    const storage_policy_t& policy = m_local_data->policy();
+
+    printf("rank %d: storage = %s, size = %llu bytes, alignment = %llu, huge pages = %d, "
+        "NUMA node requested = %d, placed = %d, allocation time = %10.7f seconds\n", 
+        m_grid->iam(), kinds[policy.kind], 
+        (unsigned long long)(m_local_size * sizeof(T)), (unsigned long long)(policy.alignment), 
+        int(policy.huge_pages), policy.numa_node, m_local_data->placement(), 
+        m_local_data->allocation_time()); fflush(stdout);
+}
+
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::local_size() const
 {
     return m_local_size;
 }
 
-blas_idx_t block_cyclic_mat_t::local_rows() const
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::local_rows() const
 {
     return m_local_rows;
 }
 
-blas_idx_t block_cyclic_mat_t::local_cols() const
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::local_cols() const
 {
     return m_local_cols;
 }
 
-blas_idx_t block_cyclic_mat_t::row_block_size() const
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::row_block_size() const
 {
     return m_mb;
 }
 
-blas_idx_t block_cyclic_mat_t::col_block_size() const
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::col_block_size() const
 {
     return m_nb;
 }
 
-double* block_cyclic_mat_t::local_data()
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::global_rows() const
+{
+    return m_global_rows;
+}
+
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::global_cols() const
+{
+    return m_global_cols;
+}
+
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::global_row(blas_idx_t local_row) const
+{
+    blas_idx_t nprows = m_grid->nprows();
+    blas_idx_t myprow = (m_grid->myprow() - m_desc[RSRC_] + nprows) % nprows;
+    return ((local_row / m_mb) * nprows + myprow) * m_mb + local_row % m_mb;
+}
+
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::global_col(blas_idx_t local_col) const
+{
+    blas_idx_t npcols = m_grid->npcols();
+    blas_idx_t mypcol = (m_grid->mypcol() - m_desc[CSRC_] + npcols) % npcols;
+    return ((local_col / m_nb) * npcols + mypcol) * m_nb + local_col % m_nb;
+}
+
+template <typename T>
+void basic_block_cyclic_mat_t<T>::randomize(uint64_t seed /*= 0*/)
 {
-    return m_local_data.data();
+    counter_rng_t rng(seed);
+    generate(*this, [&](blas_idx_t i, blas_idx_t j) {
+        return rng.uniform<T>(uint64_t(i), uint64_t(j));
+    });
 }
 
-blas_idx_t* block_cyclic_mat_t::descriptor()
+template <typename T>
+T* basic_block_cyclic_mat_t<T>::local_data()
+{
+    return static_cast<T*>(m_local_data->data());
+}
+
+template <typename T>
+unsigned long basic_block_cyclic_mat_t<T>::version() const
+{
+    return m_version;
+}
+
+template <typename T>
+void basic_block_cyclic_mat_t<T>::mark_modified()
+{
+    m_version ++;
+}
+
+template <typename T>
+const local_storage_t& basic_block_cyclic_mat_t<T>::storage() const
+{
+    return *m_local_data;
+}
+
+template <typename T>
+bool basic_block_cyclic_mat_t<T>::sync()
+{
+    return m_local_data->flush();
+}
+
+template <typename T>
+blas_idx_t* basic_block_cyclic_mat_t<T>::descriptor()
 {
     return m_desc;
 }
 
-std::shared_ptr<block_cyclic_mat_t> block_cyclic_mat_t::random(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols )
+template <typename T>
+std::shared_ptr<blacs_grid_t> basic_block_cyclic_mat_t<T>::grid()
 {
-    return std::make_shared<block_cyclic_mat_t>(grid, global_rows, global_cols, s_block_size, s_block_size, RANDOM);
+    return m_grid;
 }
 
-std::shared_ptr<block_cyclic_mat_t> block_cyclic_mat_t::constant(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, double alpha /* = 0.0 */)
+template <typename T>
+blas_idx_t basic_block_cyclic_mat_t<T>::default_block_size()
 {
-    return std::make_shared<block_cyclic_mat_t>(grid, global_rows, global_cols, s_block_size, s_block_size, CONSTANT, alpha);
+    return s_block_size;
 }
 
-std::shared_ptr<block_cyclic_mat_t> block_cyclic_mat_t::diagonal(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, double alpha /*= 1.0*/)
+// Returns the block sizes of the active tuned configuration, if any
+static void tuned_block_size(blas_idx_t& mb, blas_idx_t& nb)
 {
-    return std::make_shared<block_cyclic_mat_t>(grid, global_rows, global_cols, s_block_size, s_block_size, DIAGONAL, alpha);
+    const tuning_config_t* tuned = tuner_t::active();
+    if (tuned)
+    {
+        mb = tuned->mb;
+        nb = tuned->nb;
+    }
+}
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::random(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, uint64_t seed /*= 0*/)
+{
+    blas_idx_t mb = s_block_size, nb = s_block_size;
+    tuned_block_size(mb, nb);
+    auto a = std::make_shared<basic_block_cyclic_mat_t>(grid, global_rows, global_cols, mb, nb);
+    a->randomize(seed);
+    return a;
+}
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::constant(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, T alpha /* = T() */)
+{
+    blas_idx_t mb = s_block_size, nb = s_block_size;
+    tuned_block_size(mb, nb);
+    return std::make_shared<basic_block_cyclic_mat_t>(grid, global_rows, global_cols, mb, nb, CONSTANT, alpha);
 }
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::diagonal(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, T alpha /*= T(1)*/)
+{
+    blas_idx_t mb = s_block_size, nb = s_block_size;
+    tuned_block_size(mb, nb);
+    return std::make_shared<basic_block_cyclic_mat_t>(grid, global_rows, global_cols, mb, nb, DIAGONAL, alpha);
+}
+
+template <typename T>
+std::shared_ptr<basic_block_cyclic_mat_t<T> > basic_block_cyclic_mat_t<T>::from_file(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, const char* filename)
+{
+    blas_idx_t mb = s_block_size, nb = s_block_size;
+    tuned_block_size(mb, nb);
+    auto a = std::make_shared<basic_block_cyclic_mat_t>(grid, global_rows, global_cols, mb, nb);
+    if (!a->load(filename))
+        a.reset();
+    return a;
+}
+
+template class basic_block_cyclic_mat_t<float>;
+template class basic_block_cyclic_mat_t<double>;
+template class basic_block_cyclic_mat_t<std::complex<float> >;
+template class basic_block_cyclic_mat_t<std::complex<double> >;
@@ -2,18 +2,32 @@
 #ifndef _BLOCK_CYCLIC_MAT_H_
 #define _BLOCK_CYCLIC_MAT_H_
 
+#include <algorithm>
+#include <cassert>
+#include <complex>
 #include <memory>
 #include <vector>
 #include "blacs.h"
 #include "blacs_grid.h"
+#include "local_storage.h"
 
 /// <summary>
 ///   A class that represents a two-dimensional block-cyclically distributed 
 ///   matrix in ScaLAPACK
 /// </summary>
-class block_cyclic_mat_t 
+/// <remark>
+///   The element type T is one of float, double, std::complex&lt;float&gt; 
+///   and std::complex&lt;double&gt;, and scalapack_traits&lt;T&gt; selects the 
+///   matching ps*, pd*, pc* or pz* routines. The class is explicitly 
+///   instantiated for these four types in block_cyclic_mat.cpp, and the 
+///   typedefs at the end of this file name each instantiation.
+/// </remark>
+template <typename T>
+class basic_block_cyclic_mat_t 
 {
 public:
+    typedef T value_type;
+
     enum fill_t {ZERO, CONSTANT, DIAGONAL, RANDOM};
 
     /// <summary>
@@ -43,7 +57,9 @@ public:
     ///     CONSTANT: Fill the matrix with a constant value.
     ///     DIAGONAL: Set the diagonals of the matrix to a constant value.
     ///     RANDOM: Fill the matrix with random values in (0,1) drawn from 
-    ///         a uniform distribution.
+    ///         a uniform distribution. Complex matrices get random real 
+    ///         and imaginary parts. The values depend only on the global
+    ///         index of each element, see randomize().
     /// </param>
     /// <param name="alpha">
     ///   The constant value used for populating the elements or the diagonal
@@ -52,25 +68,117 @@ public:
     ///   of the matrix must be set to.
     ///   If fill is DIAGONAL, then alpha represents the diagonal value.
     /// </param>
-    block_cyclic_mat_t (std::shared_ptr<blacs_grid_t> grid, 
+    /// <param name="storage">
+    ///   Describes the memory backing the local part of the matrix, defaults 
+    ///   to storage_policy_t::default_policy(), which is a zero-initialised
+    ///   heap allocation unless changed by the application. With ANONYMOUS or MAPPED_FILE
+    ///   storage a ZERO fill leaves the memory untouched: anonymous pages are 
+    ///   zero on first use and a mapped file keeps its previous contents. 
+    ///   For MAPPED_FILE the rank of the calling process is appended to the 
+    ///   file name so that every process maps its own panel.
+    /// </param>
+    /// <param name="row_src">
+    ///   The process row holding the first row of the matrix, corresponds 
+    ///   to the parameter RSRC_A in ScaLAPACK and defaults to 0.
+    /// </param>
+    /// <param name="col_src">
+    ///   The process column holding the first column of the matrix, corresponds 
+    ///   to the parameter CSRC_A in ScaLAPACK and defaults to 0.
+    /// </param>
+    basic_block_cyclic_mat_t (std::shared_ptr<blacs_grid_t> grid, 
         blas_idx_t global_rows, blas_idx_t global_cols, 
         blas_idx_t row_block_size = s_block_size, blas_idx_t col_block_size = s_block_size,
-        fill_t fill = ZERO, double alpha = 0.0);
+        fill_t fill = ZERO, T alpha = T(), 
+        const storage_policy_t& storage = storage_policy_t::default_policy(),
+        blas_idx_t row_src = 0, blas_idx_t col_src = 0);
+
+    /// <summary>
+    ///   Constructs a copy of a matrix of the same or of another element
+    ///   type, for example a single precision copy of a double precision
+    ///   matrix.
+    /// </summary>
+    /// <remark>
+    ///   The copy has exactly the same distribution and descriptor as a, 
+    ///   so conversions in either direction are purely local. Converting 
+    ///   a complex matrix to a real one does not compile.
+    /// </remark>
+    template <typename U>
+    explicit basic_block_cyclic_mat_t(basic_block_cyclic_mat_t<U>& a)
+    {
+        init(a.m_grid, a.m_global_rows, a.m_global_cols, a.m_mb, a.m_nb, ZERO, T(), 
+            storage_policy_t::heap(), a.m_desc[RSRC_], a.m_desc[CSRC_]);
+        assign(a);
+    }
+
+    /// <summary>
+    ///   Overwrites the matrix with the converted values of a, which must 
+    ///   have the same distribution.
+    /// </summary>
+    template <typename U>
+    void assign(basic_block_cyclic_mat_t<U>& a)
+    {
+        assert(a.local_size() == local_size());
+        const U* src = a.local_data();
+        std::transform(src, src + a.local_size(), local_data(), [](const U& v) { return T(v); });
+        mark_modified();
+    }
+
+    /// <summary>
+    ///   Overwrites a, which must have the same distribution, with the 
+    ///   converted values of this matrix.
+    /// </summary>
+    template <typename U>
+    void copy_to(basic_block_cyclic_mat_t<U>& a) const
+    {
+        a.assign(const_cast<basic_block_cyclic_mat_t&>(*this));
+    }
+
+    /// <summary>
+    ///   Adds the converted values of this matrix to a, which must have the
+    ///   same distribution.
+    /// </summary>
+    template <typename U>
+    void add_to(basic_block_cyclic_mat_t<U>& a) const
+    {
+        assert(a.local_size() == local_size());
+        const T* src = static_cast<const T*>(m_local_data->data());
+        U*       dst = a.local_data();
+        for (blas_idx_t i = 0; i < m_local_size; i ++)
+            dst[i] += U(src[i]);
+        a.mark_modified();
+    }
     
+    /// <remark>
+    ///   The utility functions below use a block size of 64, or the block
+    ///   sizes of the configuration selected with tuner_t::select.
+    /// </remark>
+
     /// <summary>
     ///   Utility function for constructing a distributed matrix with random entries.
     /// </summary>
-    static std::shared_ptr<block_cyclic_mat_t>  random   (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols);
+    static std::shared_ptr<basic_block_cyclic_mat_t>  random   (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, uint64_t seed = 0);
 
     /// <summary>
     ///   Utility function for constructing a distributed matrix with a constant value.
     /// </summary>
-    static std::shared_ptr<block_cyclic_mat_t>  constant (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, double alpha = 0.0);
+    static std::shared_ptr<basic_block_cyclic_mat_t>  constant (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, T alpha = T());
     
     /// <summary>
     ///   Utility function for constructing a distributed matrix with a constant diagonal value.
     /// </summary>
-    static std::shared_ptr<block_cyclic_mat_t>  diagonal (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, double alpha = 1.0);
+    static std::shared_ptr<basic_block_cyclic_mat_t>  diagonal (std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, T alpha = T(1));
+
+    /// <summary>
+    ///   Utility function for constructing a distributed matrix from a binary file.
+    ///   Returns an empty pointer if the file could not be read.
+    /// </summary>
+    static std::shared_ptr<basic_block_cyclic_mat_t>  from_file(std::shared_ptr<blacs_grid_t> grid, blas_idx_t global_rows, blas_idx_t global_cols, const char* filename);
+
+    /// <summary>
+    ///   Returns the block size used by the utility functions when no tuned
+    ///   configuration is active.
+    /// </summary>
+    static blas_idx_t default_block_size();
     
     /// <summary>
     ///   Returns the total number of elements in the local part of the matrix
@@ -112,10 +220,33 @@ public:
     /// </summary>
     blas_idx_t global_cols() const;
 
+    /// <summary>
+    ///   Returns the global row, from 0, of a row of the local part of the
+    ///   matrix in the calling rank, INDXL2G in ScaLAPACK.
+    /// </summary>
+    blas_idx_t global_row(blas_idx_t local_row) const;
+
+    /// <summary>
+    ///   Returns the global column, from 0, of a column of the local part
+    ///   of the matrix in the calling rank.
+    /// </summary>
+    blas_idx_t global_col(blas_idx_t local_col) const;
+
     /// <summary>
     ///   Returns the local data for the matrix in the calling rank.
     /// </summary>
-    double* local_data();    
+    T* local_data();    
+
+    /// <summary>
+    ///   Returns the storage backing the local data for the matrix.
+    /// </summary>
+    const local_storage_t& storage() const;
+
+    /// <summary>
+    ///   Writes the local data back to its file for MAPPED_FILE storage,
+    ///   which makes a cheap per-rank checkpoint. Returns true on success.
+    /// </summary>
+    bool sync();
 
     /// <summary>
     ///   Returns the ScaLAPACK matrix descriptor, DESC_A.
@@ -127,13 +258,126 @@ public:
     /// </summary>
     std::shared_ptr<blacs_grid_t> grid();
 
+    /// <summary>
+    ///   Returns a copy of the matrix distributed with a new block size,
+    ///   a new source process and/or on another process grid.
+    /// </summary>
+    /// <param name="grid">
+    ///   The BLACS grid on which the copy must be distributed.
+    /// </param>
+    /// <param name="row_block_size">
+    ///   The row block size of the copy, MB_B.
+    /// </param>
+    /// <param name="col_block_size">
+    ///   The column block size of the copy, NB_B.
+    /// </param>
+    /// <param name="row_src">
+    ///   The process row holding the first row of the copy, RSRC_B.
+    /// </param>
+    /// <param name="col_src">
+    ///   The process column holding the first column of the copy, CSRC_B.
+    /// </param>
+    /// <remark>
+    ///   When the grid is unchanged and each process would end up owning 
+    ///   the same rows and columns (the layouts are identical, or a block 
+    ///   size changes along a grid dimension with a single process), the 
+    ///   copy is made locally without any communication. Other changes on
+    ///   the same grid, such as a smaller block size, pack the local
+    ///   elements per destination and exchange them with a single
+    ///   MPI_Alltoallv over the grid, which every process of the grid must
+    ///   call. Copies to another grid are moved with the PxGEMR2D
+    ///   subroutine, which every process in the system must call. Grids are the same
+    ///   only if they are the same object. The copy uses the storage
+    ///   policy of this matrix.
+    /// </remark>
+    std::shared_ptr<basic_block_cyclic_mat_t> redistribute(std::shared_ptr<blacs_grid_t> grid, 
+        blas_idx_t row_block_size, blas_idx_t col_block_size, 
+        blas_idx_t row_src = 0, blas_idx_t col_src = 0);
+
+    /// <summary>
+    ///   Returns a copy of the matrix with a new block size on the same grid.
+    /// </summary>
+    std::shared_ptr<basic_block_cyclic_mat_t> redistribute(blas_idx_t row_block_size, blas_idx_t col_block_size);
+
+    /// <summary>
+    ///   Returns a counter that changes every time the contents of the
+    ///   matrix are known to have changed.
+    /// </summary>
+    unsigned long version() const;
+
+    /// <summary>
+    ///   Records that the contents of the matrix have changed. Code that 
+    ///   writes to local_data() directly should call this method so that
+    ///   factorizations of the matrix know that they are stale.
+    /// </summary>
+    void mark_modified();
+
+    /// <summary>
+    ///   Fills the matrix with random values in (0,1) drawn from a uniform
+    ///   distribution, as the RANDOM fill does.
+    /// </summary>
+    /// <param name="seed">
+    ///   Selects one of the independent random matrices of a given size.
+    /// </param>
+    /// <remark>
+    ///   Element (i, j) is generated by counter_rng_t from the seed and
+    ///   (i, j) alone, so the global matrix is bit-identical for any grid
+    ///   shape, block size or source process, and results can be compared
+    ///   across configurations. Each process fills its local columns from
+    ///   the OpenMP worker threads without any communication.
+    /// </remark>
+    void randomize(uint64_t seed = 0);
+
     /// <summary>
     ///   Prints out the local portion of a distributed matrix.
     /// </summary>
     void print() const; 
 
+    /// <summary>
+    ///   Prints out the kind, alignment, NUMA placement and allocation time
+    ///   of the local storage in the calling rank.
+    /// </summary>
+    void print_storage() const;
+
+    /// <summary>
+    ///   Collectively reads the matrix from a binary file holding the 
+    ///   global matrix in column-major order.
+    /// </summary>
+    /// <param name="filename">
+    ///   The name of the file to read, which must contain at least
+    ///   M_A x N_A elements of type T in native byte order.
+    /// </param>
+    /// <remark>
+    ///   Every process in the grid must call this method, and the file is
+    ///   opened on the communicator of the grid. Each process 
+    ///   sets an MPI_Type_create_darray file view built from DESC_A and
+    ///   reads only its own blocks, so no process ever holds the whole
+    ///   matrix. Returns false on every process if the file could not be
+    ///   opened or is shorter than the matrix on any of them.
+    /// </remark>
+    bool load(const char* filename);
+
+    /// <summary>
+    ///   Collectively writes the matrix to a binary file in column-major 
+    ///   order, in the format expected by load().
+    /// </summary>
+    /// <remark>
+    ///   Every process in the grid must call this method. An existing file
+    ///   of the same name is overwritten. Returns false on every process
+    ///   if the file could not be opened or written on any of them.
+    /// </remark>
+    bool save(const char* filename) const;
+
 private:
-    std::vector<double> m_local_data;
+    template <typename U> friend class basic_block_cyclic_mat_t;
+
+    void init(std::shared_ptr<blacs_grid_t> grid, 
+        blas_idx_t global_rows, blas_idx_t global_cols, 
+        blas_idx_t row_block_size, blas_idx_t col_block_size,
+        fill_t fill, T alpha, const storage_policy_t& storage,
+        blas_idx_t row_src, blas_idx_t col_src);
+
+    std::unique_ptr<local_storage_t> m_local_data;
     blas_idx_t   m_local_size;
     blas_idx_t   m_local_rows;
     blas_idx_t   m_local_cols;
@@ -143,11 +387,17 @@ private:
     blas_idx_t   m_global_cols;
     blas_idx_t   m_desc[DLEN_];
     std::shared_ptr<blacs_grid_t> m_grid;    
+    unsigned long m_version;
 
-    block_cyclic_mat_t(const block_cyclic_mat_t&);
-    block_cyclic_mat_t operator=(const block_cyclic_mat_t&);
+    basic_block_cyclic_mat_t(const basic_block_cyclic_mat_t&);
+    basic_block_cyclic_mat_t operator=(const basic_block_cyclic_mat_t&);
 
     static const blas_idx_t s_block_size = 64;
 };
 
+typedef basic_block_cyclic_mat_t<double>               block_cyclic_mat_t;
+typedef basic_block_cyclic_mat_t<float>                block_cyclic_float_mat_t;
+typedef basic_block_cyclic_mat_t<std::complex<float> > block_cyclic_complex_mat_t;
+typedef basic_block_cyclic_mat_t<std::complex<double> > block_cyclic_double_complex_mat_t;
+
 #endif
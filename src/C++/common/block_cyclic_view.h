@@ -0,0 +1,175 @@
+// -*- mode: c++ -*-
+#ifndef _BLOCK_CYCLIC_VIEW_H_
+#define _BLOCK_CYCLIC_VIEW_H_
+
+#include <cassert>
+#include "block_cyclic_mat.h"
+
+/// <summary>
+///   A non-owning view of the submatrix A(IA:IA+M-1, JA:JA+N-1) of a
+///   block-cyclically distributed matrix, optionally transposed.
+/// </summary>
+/// <remark>
+///   A view is the IA/JA/DESC_A triplet that ScaLAPACK routines take for a
+///   submatrix, so slicing never copies any data. Indices are 1-based as
+///   in ScaLAPACK. A transposed view swaps its rows and columns and is
+///   passed to PxGEMM as the 'T' option rather than being formed
+///   explicitly. Views are cheap to copy and must not outlive the matrix.
+/// </remark>
+template <typename T>
+class basic_block_cyclic_view_t
+{
+public:
+    /// <summary>
+    ///   Constructs a view of the whole matrix. The conversion is implicit
+    ///   so that a matrix can be passed wherever a view is expected.
+    /// </summary>
+    basic_block_cyclic_view_t(basic_block_cyclic_mat_t<T>& a)
+        : m_matrix(&a), m_ia(1), m_ja(1), m_rows(a.global_rows()), m_cols(a.global_cols()), m_transposed(false)
+    {
+    }
+
+    /// <summary>
+    ///   Constructs a view of the M x N submatrix of a starting at (IA, JA).
+    /// </summary>
+    basic_block_cyclic_view_t(basic_block_cyclic_mat_t<T>& a,
+        blas_idx_t ia, blas_idx_t ja, blas_idx_t m, blas_idx_t n)
+        : m_matrix(&a), m_ia(ia), m_ja(ja), m_rows(m), m_cols(n), m_transposed(false)
+    {
+        assert(ia >= 1 && ja >= 1 && m >= 0 && n >= 0);
+        assert(ia + m - 1 <= a.global_rows() && ja + n - 1 <= a.global_cols());
+    }
+
+    /// <summary>
+    ///   Returns the m x n submatrix of this view starting at its row i and
+    ///   column j. For a transposed view, i and j refer to the transpose.
+    /// </summary>
+    basic_block_cyclic_view_t submatrix(blas_idx_t i, blas_idx_t j, blas_idx_t m, blas_idx_t n) const
+    {
+        assert(i >= 1 && j >= 1 && i + m - 1 <= rows() && j + n - 1 <= cols());
+        basic_block_cyclic_view_t v(*this);
+        if (m_transposed)
+        {
+            v.m_ia   = m_ia + j - 1;
+            v.m_ja   = m_ja + i - 1;
+            v.m_rows = n;
+            v.m_cols = m;
+        }
+        else
+        {
+            v.m_ia   = m_ia + i - 1;
+            v.m_ja   = m_ja + j - 1;
+            v.m_rows = m;
+            v.m_cols = n;
+        }
+        return v;
+    }
+
+    /// <summary>
+    ///   Returns the m rows of this view starting at row i.
+    /// </summary>
+    basic_block_cyclic_view_t row_slice(blas_idx_t i, blas_idx_t m) const
+    {
+        return submatrix(i, 1, m, cols());
+    }
+
+    /// <summary>
+    ///   Returns the n columns of this view starting at column j.
+    /// </summary>
+    basic_block_cyclic_view_t col_slice(blas_idx_t j, blas_idx_t n) const
+    {
+        return submatrix(1, j, rows(), n);
+    }
+
+    /// <summary>
+    ///   Returns the transpose of this view.
+    /// </summary>
+    basic_block_cyclic_view_t transpose() const
+    {
+        basic_block_cyclic_view_t v(*this);
+        v.m_transposed = !m_transposed;
+        return v;
+    }
+
+    /// <summary>
+    ///   Returns the number of rows of the view, after transposition.
+    /// </summary>
+    blas_idx_t rows() const
+    {
+        return m_transposed ? m_cols : m_rows;
+    }
+
+    /// <summary>
+    ///   Returns the number of columns of the view, after transposition.
+    /// </summary>
+    blas_idx_t cols() const
+    {
+        return m_transposed ? m_rows : m_cols;
+    }
+
+    /// <summary>
+    ///   Returns whether the view is transposed.
+    /// </summary>
+    bool transposed() const
+    {
+        return m_transposed;
+    }
+
+    /// <summary>
+    ///   Returns the TRANS argument for PxGEMM, 'N' or 'T'.
+    /// </summary>
+    char trans() const
+    {
+        return m_transposed ? 'T' : 'N';
+    }
+
+    /// <remark>
+    ///   The methods below describe the underlying submatrix, ignoring the
+    ///   transpose flag: M_SUB x N_SUB elements starting at (IA, JA).
+    /// </remark>
+
+    blas_idx_t m()  const { return m_rows; }
+    blas_idx_t n()  const { return m_cols; }
+    blas_idx_t ia() const { return m_ia; }
+    blas_idx_t ja() const { return m_ja; }
+
+    /// <summary>
+    ///   Returns the local data of the whole matrix, which is what ScaLAPACK
+    ///   expects together with IA and JA.
+    /// </summary>
+    T* data() const
+    {
+        return m_matrix->local_data();
+    }
+
+    /// <summary>
+    ///   Returns the descriptor of the whole matrix, DESC_A.
+    /// </summary>
+    blas_idx_t* descriptor() const
+    {
+        return m_matrix->descriptor();
+    }
+
+    /// <summary>
+    ///   Returns the matrix the view refers to.
+    /// </summary>
+    basic_block_cyclic_mat_t<T>& matrix() const
+    {
+        return *m_matrix;
+    }
+
+private:
+    basic_block_cyclic_mat_t<T>* m_matrix;
+    blas_idx_t                   m_ia;
+    blas_idx_t                   m_ja;
+    blas_idx_t                   m_rows;
+    blas_idx_t                   m_cols;
+    bool                         m_transposed;
+};
+
+typedef basic_block_cyclic_view_t<double>               block_cyclic_view_t;
+typedef basic_block_cyclic_view_t<float>                block_cyclic_float_view_t;
+typedef basic_block_cyclic_view_t<std::complex<float> > block_cyclic_complex_view_t;
+typedef basic_block_cyclic_view_t<std::complex<double> > block_cyclic_double_complex_view_t;
+
+#endif // _BLOCK_CYCLIC_VIEW_H_
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <mpi.h>
+
+#include "blacs.h"
+#include "butterfly.h"
+#include "counter_rng.h"
+#include "factorization.h"
+#include "scalapack.h"
+#include "scalapack_api.h"
+#include "trace.h"
+
+// Overwrites X and Y, two submatrices of the same shape, with X + Y and
+// X - Y, using PDGEADD twice so that no workspace is needed
+static void sum_difference(block_cyclic_view_t x, block_cyclic_view_t y)
+{
+    char       nein = 'N';
+    blas_idx_t m = x.m(), n = x.n();
+    blas_idx_t ix = x.ia(), jx = x.ja(), iy = y.ia(), jy = y.ja();
+    double     one = 1.0, two = -2.0;
+    trace_scope_t scope("pdgeadd");
+    pdgeadd_(nein, m, n, one, y.data(), iy, jy, y.descriptor(), one, x.data(), ix, jx, x.descriptor());
+    pdgeadd_(nein, m, n, one, x.data(), ix, jx, x.descriptor(), two, y.data(), iy, jy, y.descriptor());
+    x.matrix().mark_modified();
+}
+
+// Multiplies every row i of the local part of A by d[i], or every column
+// with columns set
+static void scale(block_cyclic_mat_t& a, const std::vector<double>& d, bool columns)
+{
+    blas_idx_t lld  = a.descriptor()[LLD_];
+    double*    data = a.local_data();
+    std::vector<double> rows(a.local_rows(), 1.0);
+    if (!columns)
+    {
+        for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+            rows[il] = d[a.global_row(il)];
+    }
+
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+    {
+        double c = columns ? d[a.global_col(jl)] : 1.0;
+        for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+            data[il + jl * lld] *= rows[il] * c;
+    }
+    a.mark_modified();
+}
+
+random_butterfly_t::random_butterfly_t(blas_idx_t n, blas_idx_t depth /*= 2*/, uint64_t seed /*= 0*/)
+    : m_n(n), m_depth(depth), m_seed(seed)
+{
+    assert(n >= 0 && depth >= 1);
+
+    // Each butterfly of order len pairs its first len / 2 rows with the
+    // next len / 2, and is split into two at the next level
+    level_t level(1, std::make_pair(blas_idx_t(0), n));
+    for (blas_idx_t l = 0; l < depth; l ++)
+    {
+        m_levels.push_back(level);
+
+        level_t next;
+        for (size_t s = 0; s < level.size(); s ++)
+        {
+            blas_idx_t first = level[s].first, len = level[s].second, h = len / 2;
+            next.push_back(std::make_pair(first, h));
+            next.push_back(std::make_pair(first + h, len - h));
+        }
+        level.swap(next);
+    }
+}
+
+blas_idx_t random_butterfly_t::depth() const
+{
+    return m_depth;
+}
+
+std::vector<double> random_butterfly_t::diagonal(int side, blas_idx_t level) const
+{
+    counter_rng_t rng(m_seed);
+    std::vector<double> d(m_n, 1.0);
+    const level_t& butterflies = m_levels[level];
+    for (size_t s = 0; s < butterflies.size(); s ++)
+    {
+        blas_idx_t first = butterflies[s].first, h = butterflies[s].second / 2;
+        for (blas_idx_t i = first; i < first + 2 * h; i ++)
+        {
+            double r = rng.uniform<double>(uint64_t(side) * m_depth + level, i) - 0.5;
+            d[i] = exp(r / 10.0) / sqrt(2.0);
+        }
+    }
+    return d;
+}
+
+void random_butterfly_t::transform(block_cyclic_mat_t& a) const
+{
+    assert(a.global_rows() == m_n && a.global_cols() == m_n);
+    trace_scope_t scope("butterfly");
+
+    // U^T A applies the transposed levels of U from the first, each as
+    // (R0 (T + B), R1 (T - B)) / sqrt(2) on the halves T and B of a
+    // butterfly, and A V applies the levels of V to the columns in the
+    // same way
+    transform_rhs(a);
+
+    block_cyclic_view_t av(a);
+    for (blas_idx_t l = 0; l < m_depth; l ++)
+    {
+        const level_t& butterflies = m_levels[l];
+        for (size_t s = 0; s < butterflies.size(); s ++)
+        {
+            blas_idx_t first = butterflies[s].first, h = butterflies[s].second / 2;
+            if (h > 0)
+                sum_difference(av.col_slice(first + 1, h), av.col_slice(first + h + 1, h));
+        }
+        scale(a, diagonal(1, l), true);
+    }
+}
+
+void random_butterfly_t::transform_rhs(block_cyclic_mat_t& b) const
+{
+    assert(b.global_rows() == m_n);
+
+    block_cyclic_view_t bv(b);
+    for (blas_idx_t l = 0; l < m_depth; l ++)
+    {
+        const level_t& butterflies = m_levels[l];
+        for (size_t s = 0; s < butterflies.size(); s ++)
+        {
+            blas_idx_t first = butterflies[s].first, h = butterflies[s].second / 2;
+            if (h > 0)
+                sum_difference(bv.row_slice(first + 1, h), bv.row_slice(first + h + 1, h));
+        }
+        scale(b, diagonal(0, l), false);
+    }
+}
+
+void random_butterfly_t::recover(block_cyclic_mat_t& y) const
+{
+    assert(y.global_rows() == m_n);
+
+    // V Y applies the levels of V from the last, each as
+    // (R0 T + R1 B, R0 T - R1 B) / sqrt(2)
+    block_cyclic_view_t yv(y);
+    for (blas_idx_t l = m_depth - 1; l >= 0; l --)
+    {
+        scale(y, diagonal(1, l), false);
+
+        const level_t& butterflies = m_levels[l];
+        for (size_t s = 0; s < butterflies.size(); s ++)
+        {
+            blas_idx_t first = butterflies[s].first, h = butterflies[s].second / 2;
+            if (h > 0)
+                sum_difference(yv.row_slice(first + 1, h), yv.row_slice(first + h + 1, h));
+        }
+    }
+}
+
+// Solves op(A) X = B for X, overwriting B, with PDTRSM
+static void trsm(char side, char uplo, char transa, char diag, block_cyclic_view_t a, block_cyclic_view_t b)
+{
+    blas_idx_t m = b.m(), n = b.n();
+    blas_idx_t ia = a.ia(), ja = a.ja(), ib = b.ia(), jb = b.ja();
+    double one = 1.0;
+    trace_scope_t scope("pdtrsm");
+    pdtrsm_(side, uplo, transa, diag, m, n, one, a.data(), ia, ja, a.descriptor(), b.data(), ib, jb, b.descriptor());
+    b.matrix().mark_modified();
+}
+
+// Factorizes the n x n block at a, of leading dimension lda, as L U
+// without pivoting. Returns the column, from 1, of the first zero pivot,
+// or zero.
+static blas_idx_t getf2_nopiv(blas_idx_t n, double* a, blas_idx_t lda)
+{
+    for (blas_idx_t j = 0; j < n; j ++)
+    {
+        double pivot = a[j + j * lda];
+        if (pivot == 0.0)
+            return j + 1;
+
+        for (blas_idx_t i = j + 1; i < n; i ++)
+            a[i + j * lda] /= pivot;
+        for (blas_idx_t k = j + 1; k < n; k ++)
+        {
+            double u = a[j + k * lda];
+            for (blas_idx_t i = j + 1; i < n; i ++)
+                a[i + k * lda] -= a[i + j * lda] * u;
+        }
+    }
+    return 0;
+}
+
+// Factorizes A = L U in place without pivoting, one block column at a
+// time, and returns INFO as PDGETRF would. The diagonal block is
+// factorized by the process that owns it, and the blocks below and to the
+// right of it and the trailing matrix are updated with PDTRSM and PDGEMM.
+static blas_idx_t getrf_nopiv(block_cyclic_mat_t& a)
+{
+    blas_idx_t n = a.global_rows(), nb = a.col_block_size();
+    assert(a.global_cols() == n && a.row_block_size() == nb);
+
+    auto        grid = a.grid();
+    blas_idx_t* desc = a.descriptor();
+    blas_idx_t  info = 0;
+    trace_scope_t scope("getrf_nopiv");
+
+    block_cyclic_view_t av(a);
+    for (blas_idx_t k = 0; k < n; k += nb)
+    {
+        blas_idx_t kb = std::min(nb, n - k), rest = n - k - kb, block = k / nb;
+        if ((block + desc[RSRC_]) % grid->nprows() == grid->myprow() &&
+            (block + desc[CSRC_]) % grid->npcols() == grid->mypcol())
+        {
+            blas_idx_t lld  = desc[LLD_];
+            double*    diag = a.local_data() + block / grid->nprows() * nb + block / grid->npcols() * nb * lld;
+            blas_idx_t zero = getf2_nopiv(kb, diag, lld);
+            if (zero > 0 && info == 0)
+                info = k + zero;
+        }
+        if (rest == 0)
+            break;
+
+        block_cyclic_view_t d = av.submatrix(k + 1, k + 1, kb, kb);
+        trsm('R', 'U', 'N', 'N', d, av.submatrix(k + kb + 1, k + 1, rest, kb));
+        trsm('L', 'L', 'N', 'U', d, av.submatrix(k + 1, k + kb + 1, kb, rest));
+        gemm(av.submatrix(k + kb + 1, k + 1, rest, kb), av.submatrix(k + 1, k + kb + 1, kb, rest),
+            av.submatrix(k + kb + 1, k + kb + 1, rest, rest), -1.0, 1.0);
+    }
+    a.mark_modified();
+
+    // The first zero pivot over all processes
+    double first = info > 0 ? double(info) : double(n + 1);
+    MPI_Allreduce(MPI_IN_PLACE, &first, 1, MPI_DOUBLE, MPI_MIN, grid->comm());
+    return first <= double(n) ? blas_idx_t(first) : 0;
+}
+
+// Overwrites B with the solution of AX = B, given the factors of U^T A V
+static void solve(const random_butterfly_t& butterfly, block_cyclic_mat_t& lu, block_cyclic_mat_t& b)
+{
+    butterfly.transform_rhs(b);
+    trsm('L', 'L', 'N', 'U', lu, b);
+    trsm('L', 'U', 'N', 'N', lu, b);
+    butterfly.recover(b);
+}
+
+refinement_result_t rbt_solve(std::shared_ptr<block_cyclic_mat_t> a,
+    std::shared_ptr<block_cyclic_mat_t> b,
+    std::shared_ptr<block_cyclic_mat_t> x,
+    blas_idx_t depth /*= 2*/, blas_idx_t max_iterations /*= 2*/, uint64_t seed /*= 0*/)
+{
+    assert(b->local_size() == x->local_size());
+
+    refinement_result_t result = {0, 0, 0.0, false};
+
+    blas_idx_t n    = a->global_rows();
+    blas_idx_t nrhs = b->global_cols();
+
+    auto r = std::make_shared<block_cyclic_mat_t>(b->grid(), n, nrhs, b->row_block_size(), b->col_block_size());
+
+    double norm_a    = lange(*a, 'I');
+    double norm_a1   = lange(*a, '1');
+    double eps       = std::numeric_limits<double>::epsilon() * 0.5;
+    double tol       = sqrt(double(n)) * norm_a * eps;
+    bool   converged = false;
+
+    // Factorize U^T A V without pivoting
+    random_butterfly_t butterfly(n, depth, seed);
+    auto f = std::make_shared<block_cyclic_mat_t>(*a);
+    butterfly.transform(*f);
+    result.info = getrf_nopiv(*f);
+
+    if (result.info == 0)
+    {
+        std::copy_n(b->local_data(), b->local_size(), x->local_data());
+        x->mark_modified();
+        solve(butterfly, *f, *x);
+
+        double norm_r_prev = std::numeric_limits<double>::max();
+        for (;;)
+        {
+            residual(*a, *b, *x, *r);
+            double norm_r = lange(*r, 'I');
+            double norm_x = lange(*x, 'I');
+
+            if (norm_r <= norm_x * tol)
+            {
+                converged = true;
+                break;
+            }
+
+            // Refinement has stalled if the residual no longer decreases
+            if (norm_r >= norm_r_prev || result.iterations == max_iterations)
+                break;
+            norm_r_prev = norm_r;
+
+            // Solve for the correction with the same factors and apply it
+            solve(butterfly, *f, *r);
+            r->add_to(*x);
+            result.iterations ++;
+        }
+    }
+    f.reset();
+
+    if (!converged)
+    {
+        std::copy_n(b->local_data(), b->local_size(), x->local_data());
+        x->mark_modified();
+        factorization_t lu(a, factorization_t::LU);
+        result.info      = lu.solve(x);
+        result.fell_back = true;
+    }
+
+    residual(*a, *b, *x, *r);
+    result.error = lange(*r, 'I') / n / norm_a1;
+    return result;
+}
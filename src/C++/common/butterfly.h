@@ -0,0 +1,119 @@
+// -*- mode: c++ -*-
+#ifndef _BUTTERFLY_H_
+#define _BUTTERFLY_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "block_cyclic_mat.h"
+#include "mixed_precision.h"
+
+/// <summary>
+///   A pair of recursive random butterfly transforms U and V of order N,
+///   after which U^T A V can be factorized by LU without pivoting with
+///   probability close to one (Parker, "Random butterfly transformations
+///   with applications in computational linear algebra", 1995; Baboulin et
+///   al., "Accelerating linear system solutions using randomization
+///   techniques", 2013).
+/// </summary>
+/// <remark>
+///   A butterfly of order n is
+///     B = 1/sqrt(2) [ R0  R1 ]
+///                   [ R0 -R1 ]
+///   where R0 and R1 are random diagonal matrices of order n / 2 whose
+///   entries are exp(r / 10) for r uniform in (-1/2, 1/2). A recursive
+///   butterfly of depth d is the product of d levels, level l being the
+///   block diagonal matrix of 2^l butterflies of order N / 2^l. When a
+///   butterfly has odd order, its last row is left as it is.
+///
+///   Applying a level to a distributed matrix adds and subtracts rows, or
+///   columns, N / 2^(l + 1) apart with PDGEADD, which exchanges them
+///   between pairs of processes, and scales them by the random entries,
+///   which every process generates for its own rows and columns from
+///   counter_rng_t without communicating. The transform costs O(d N^2)
+///   operations, and the result does not depend on the grid.
+/// </remark>
+class random_butterfly_t
+{
+public:
+    /// <summary>
+    ///   Creates the transforms of order n, of the given depth, whose random
+    ///   entries are drawn from seed.
+    /// </summary>
+    random_butterfly_t(blas_idx_t n, blas_idx_t depth = 2, uint64_t seed = 0);
+
+    /// <summary>
+    ///   Overwrites the N x N matrix A with U^T A V.
+    /// </summary>
+    void transform(block_cyclic_mat_t& a) const;
+
+    /// <summary>
+    ///   Overwrites the N x NRHS right-hand sides B with U^T B.
+    /// </summary>
+    void transform_rhs(block_cyclic_mat_t& b) const;
+
+    /// <summary>
+    ///   Overwrites the solutions Y of (U^T A V) Y = U^T B with those of
+    ///   AX = B, X = V Y.
+    /// </summary>
+    void recover(block_cyclic_mat_t& y) const;
+
+    blas_idx_t depth() const;
+
+private:
+    // The (first, order) of each butterfly, level by level
+    typedef std::vector<std::pair<blas_idx_t, blas_idx_t> > level_t;
+
+    blas_idx_t           m_n;
+    blas_idx_t           m_depth;
+    uint64_t             m_seed;
+    std::vector<level_t> m_levels;
+
+    // The entries of level l of U (side 0) or V (side 1), divided by
+    // sqrt(2), and one for the rows a butterfly leaves as they are
+    std::vector<double> diagonal(int side, blas_idx_t level) const;
+
+    // Mark this class as non-copyable
+    random_butterfly_t(const random_butterfly_t&);
+    const random_butterfly_t& operator=(const random_butterfly_t&);
+};
+
+/// <summary>
+///   Solves AX = B by transforming A with random butterflies, factorizing
+///   U^T A V by LU without pivoting and refining the solution with
+///   residuals computed from A.
+/// </summary>
+/// <param name="a">
+///   The N x N matrix A, which is left intact. It must have square blocks.
+/// </param>
+/// <param name="b">
+///   The N x NRHS right-hand sides B, which are left intact.
+/// </param>
+/// <param name="x">
+///   On return, the N x NRHS solution X. It must have the same
+///   distribution as b.
+/// </param>
+/// <param name="depth">
+///   The depth of the butterflies, defaults to 2, which is enough in
+///   practice.
+/// </param>
+/// <param name="max_iterations">
+///   The number of refinement steps after which refinement is considered
+///   to have stalled, defaults to 2.
+/// </param>
+/// <remark>
+///   The factorization makes no pivot searches or row interchanges: each
+///   diagonal block is factorized by the process that owns it, and the
+///   panels and the trailing matrix are updated with PDTRSM and PDGEMM.
+///   Growth from small pivots is left for refinement to correct, which
+///   stops on the criterion used by mixed_precision_solve. If a pivot is
+///   zero, or refinement does not converge, the system is solved again
+///   with a pivoted LU factorization. The result reports the refinement
+///   steps taken and the backward error, as for mixed_precision_solve.
+/// </remark>
+refinement_result_t rbt_solve(std::shared_ptr<block_cyclic_mat_t> a,
+    std::shared_ptr<block_cyclic_mat_t> b,
+    std::shared_ptr<block_cyclic_mat_t> x,
+    blas_idx_t depth = 2, blas_idx_t max_iterations = 2, uint64_t seed = 0);
+
+#endif // _BUTTERFLY_H_
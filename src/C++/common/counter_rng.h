@@ -0,0 +1,99 @@
+// -*- mode: c++ -*-
+#ifndef _COUNTER_RNG_H_
+#define _COUNTER_RNG_H_
+
+#include <complex>
+#include <cstdint>
+
+/// <summary>
+///   A counter-based random number generator, Philox4x32-10 (Salmon et al.,
+///   "Parallel random numbers: as easy as 1, 2, 3", SC11). The random
+///   values of an element are a pure function of the seed and its global
+///   (i, j) index, so a distributed matrix gets the same elements for any
+///   grid shape or block size, and they can be generated in any order and
+///   by any number of threads.
+/// </summary>
+class counter_rng_t
+{
+public:
+    explicit counter_rng_t(uint64_t seed = 0)
+    {
+        m_key[0] = uint32_t(seed);
+        m_key[1] = uint32_t(seed >> 32);
+    }
+
+    /// <summary>
+    ///   Returns the four random words of the element (i, j).
+    /// </summary>
+    void operator()(uint64_t i, uint64_t j, uint32_t r[4]) const
+    {
+        r[0] = uint32_t(i);
+        r[1] = uint32_t(i >> 32);
+        r[2] = uint32_t(j);
+        r[3] = uint32_t(j >> 32);
+
+        uint32_t k0 = m_key[0], k1 = m_key[1];
+        for (int round = 0; round < 10; round ++)
+        {
+            uint64_t p0 = uint64_t(0xD2511F53u) * r[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57u) * r[2];
+            uint32_t c1 = r[1], c3 = r[3];
+            r[0] = uint32_t(p1 >> 32) ^ c1 ^ k0;
+            r[1] = uint32_t(p1);
+            r[2] = uint32_t(p0 >> 32) ^ c3 ^ k1;
+            r[3] = uint32_t(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+    }
+
+    /// <summary>
+    ///   Returns a value of the element (i, j) drawn uniformly from (0,1).
+    ///   Complex types get independent real and imaginary parts.
+    /// </summary>
+    template <typename T>
+    T uniform(uint64_t i, uint64_t j) const
+    {
+        uint32_t r[4];
+        (*this)(i, j, r);
+        return uniform_value<T>::get(r);
+    }
+
+private:
+    uint32_t m_key[2];
+
+    // Maps the random words to the open interval (0,1): 53 bits for double
+    // and 23 for float, whose midpoints are never rounded to 0 or 1
+    template <typename T>
+    struct uniform_value;
+};
+
+template <>
+struct counter_rng_t::uniform_value<double>
+{
+    static double get(const uint32_t* r)
+    {
+        uint64_t bits = ((uint64_t(r[1]) << 32) | r[0]) >> 11;
+        return (double(bits) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+};
+
+template <>
+struct counter_rng_t::uniform_value<float>
+{
+    static float get(const uint32_t* r)
+    {
+        return (float(r[0] >> 9) + 0.5f) * (1.0f / 8388608.0f);
+    }
+};
+
+template <typename R>
+struct counter_rng_t::uniform_value<std::complex<R> >
+{
+    static std::complex<R> get(const uint32_t* r)
+    {
+        return std::complex<R>(uniform_value<R>::get(r), uniform_value<R>::get(r + 2));
+    }
+};
+
+#endif // _COUNTER_RNG_H_
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <mpi.h>
+
+#include "blacs.h"
+#include "factorization.h"
+#include "lapack.h"
+#include "scalapack.h"
+#include "scalapack_api.h"
+#include "scalapack_traits.h"
+
+// Returns every element of the M x N matrix A, by columns, on every
+// process of its grid
+static std::vector<double> replicate(block_cyclic_mat_t& a)
+{
+    blas_idx_t m = a.global_rows(), lld = a.descriptor()[LLD_];
+    std::vector<double> full(size_t(m) * a.global_cols(), 0.0);
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+    {
+        for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+            full[a.global_row(il) + size_t(a.global_col(jl)) * m] = a.local_data()[il + jl * lld];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, full.data(), int(full.size()), MPI_DOUBLE, MPI_SUM, a.grid()->comm());
+    return full;
+}
+
+// Returns the columns of A, if any, followed by those of B, with the row
+// block size of A and the column block size nb
+static std::shared_ptr<block_cyclic_mat_t> append_columns(std::shared_ptr<block_cyclic_mat_t> a,
+    block_cyclic_mat_t& b, blas_idx_t mb, blas_idx_t nb)
+{
+    blas_idx_t m = b.global_rows(), k = a ? a->global_cols() : 0, kb = b.global_cols();
+    auto c = std::make_shared<block_cyclic_mat_t>(b.grid(), m, k + kb, mb, nb);
+
+    // The columns of A have the same place in the local part of C
+    if (a)
+        std::copy_n(a->local_data(), a->local_size(), c->local_data());
+
+    blas_idx_t one = 1, jc = k + 1, ctxt = c->grid()->context();
+    scalapack_traits<double>::gemr2d(m, kb, b.local_data(), one, one, b.descriptor(),
+        c->local_data(), one, jc, c->descriptor(), ctxt);
+    c->mark_modified();
+    return c;
+}
+
+factorization_t::factorization_t(std::shared_ptr<block_cyclic_mat_t> a, kind_t kind /*= LU*/) 
+    : m_a(a), m_kind(kind), m_version(0), m_max_rank(a->col_block_size())
+{
+    assert(a->global_rows() == a->global_cols());
+}
+
+blas_idx_t factorization_t::factor()
+{
+    // Copying with an unchanged layout is purely local
+    m_factors = m_a->redistribute(m_a->row_block_size(), m_a->col_block_size());
+    m_version = m_a->version();
+    m_w.reset();
+    m_v.reset();
+
+    blas_idx_t n  = m_a->global_rows();
+    blas_idx_t ia = 1, ja = 1, info;
+
+    if (m_kind == LU)
+    {
+        m_ipiv.resize(m_factors->local_rows() + m_factors->row_block_size());
+        scalapack_traits<double>::getrf (n, n, 
+            m_factors->local_data(), ia, ja, m_factors->descriptor(), 
+            m_ipiv.data(), 
+            info);
+    }
+    else
+    {
+        char uplo = 'U';
+        scalapack_traits<double>::potrf (uplo, n, m_factors->local_data(), ia, ja, m_factors->descriptor(), info);
+    }
+
+    if (info != 0)
+        m_factors.reset();
+    return info;
+}
+
+blas_idx_t factorization_t::solve(std::shared_ptr<block_cyclic_mat_t> b)
+{
+    if (stale())
+    {
+        blas_idx_t info = factor();
+        if (info != 0)
+            return info;
+    }
+
+    blas_idx_t n    = m_a->global_rows();
+    blas_idx_t nrhs = b->global_cols();
+    blas_idx_t ia = 1, ja = 1, ib = 1, jb = 1, info;
+
+    if (m_kind == LU)
+    {
+        char trans = 'N';
+        scalapack_traits<double>::getrs (trans, n, nrhs, 
+            m_factors->local_data(), ia, ja, m_factors->descriptor(), 
+            m_ipiv.data(), 
+            b->local_data(), ib, jb, b->descriptor(), 
+            info);
+
+        // X = Y - W C^-1 V^T Y for the solution Y of the matrix factorized
+        if (info == 0 && m_w)
+        {
+            blas_idx_t k = m_w->global_cols(), ldc = k;
+            auto z = std::make_shared<block_cyclic_mat_t>(b->grid(), k, nrhs, b->row_block_size(), b->col_block_size());
+            gemm(block_cyclic_view_t(*m_v).transpose(), *b, *z);
+
+            std::vector<double> t = replicate(*z);
+            dgetrs_ (trans, k, nrhs, m_capacitance.data(), ldc, m_cpiv.data(), t.data(), ldc, info);
+
+            blas_idx_t lld = z->descriptor()[LLD_];
+            for (blas_idx_t jl = 0; jl < z->local_cols(); jl ++)
+            {
+                for (blas_idx_t il = 0; il < z->local_rows(); il ++)
+                    z->local_data()[il + jl * lld] = t[z->global_row(il) + size_t(z->global_col(jl)) * k];
+            }
+            z->mark_modified();
+            gemm(*m_w, *z, *b, -1.0, 1.0);
+        }
+    }
+    else
+    {
+        char uplo = 'U';
+        scalapack_traits<double>::potrs (uplo, n, nrhs, 
+            m_factors->local_data(), ia, ja, m_factors->descriptor(), 
+            b->local_data(), ib, jb, b->descriptor(), 
+            info);
+    }
+
+    b->mark_modified();
+    return info;
+}
+
+blas_idx_t factorization_t::update(std::shared_ptr<block_cyclic_mat_t> x)
+{
+    assert(m_kind == CHOLESKY);
+    return rotate(*x, 1.0);
+}
+
+blas_idx_t factorization_t::downdate(std::shared_ptr<block_cyclic_mat_t> x)
+{
+    assert(m_kind == CHOLESKY);
+    return rotate(*x, -1.0);
+}
+
+// Applies A = A + sign X X^T to the matrix and to its factor A = U^T U.
+// Row r of U and the columns of X are rotated for each column v of X by
+//   U(r, r) = sqrt(U(r, r)^2 + sign X(r, v)^2),
+//   c = U(r, r)' / U(r, r), s = X(r, v) / U(r, r),
+//   U(r, j) = (U(r, j) + sign s X(j, v)) / c, X(j, v) = c X(j, v) - s U(r, j)
+// for j > r, which makes every row of U final once it has been rotated.
+blas_idx_t factorization_t::rotate(block_cyclic_mat_t& x, double sign)
+{
+    blas_idx_t n = m_a->global_rows(), k = x.global_cols();
+    assert(x.global_rows() == n);
+
+    bool current = !stale();
+    gemm(x, block_cyclic_view_t(x).transpose(), *m_a, sign, 1.0);
+    if (!current)
+        return 0;
+    m_version = m_a->version();
+
+    auto        grid = m_a->grid();
+    blas_idx_t* desc = m_factors->descriptor();
+    blas_idx_t  nb   = desc[NB_], lld = desc[LLD_];
+    blas_idx_t  nprows = grid->nprows(), npcols = grid->npcols();
+    blas_idx_t  myrow  = grid->myprow(), mycol  = grid->mypcol();
+    blas_idx_t  cols   = m_factors->local_cols();
+    double*     u      = m_factors->local_data();
+    assert(desc[MB_] == nb);
+
+    // The columns of X for the local columns of U, by rows of K values
+    std::vector<double> full = replicate(x);
+    std::vector<double> xl(size_t(cols) * k);
+    for (blas_idx_t jl = 0; jl < cols; jl ++)
+    {
+        for (blas_idx_t v = 0; v < k; v ++)
+            xl[jl * k + v] = full[m_factors->global_col(jl) + size_t(v) * n];
+    }
+    full.clear();
+
+    MPI_Comm row_comm, col_comm;
+    MPI_Comm_split(grid->comm(), int(myrow), int(mycol), &row_comm);
+    MPI_Comm_split(grid->comm(), int(mycol), int(myrow), &col_comm);
+
+    blas_idx_t          info = 0;
+    std::vector<double> rot(2 * size_t(nb) * k);
+    blas_idx_t          blocks = (n + nb - 1) / nb;
+    for (blas_idx_t block = 0; block < blocks; block ++)
+    {
+        blas_idx_t r0   = block * nb, rb = std::min(nb, n - r0);
+        blas_idx_t prow = (block + desc[RSRC_]) % nprows;
+        blas_idx_t pcol = (block + desc[CSRC_]) % npcols;
+        blas_idx_t lr0  = block / nprows * nb;
+
+        // The first local column to the right of the diagonal block
+        blas_idx_t trailing = 0;
+        while (trailing < cols && m_factors->global_col(trailing) < r0 + rb)
+            trailing ++;
+
+        if (myrow == prow)
+        {
+            // The owner of the diagonal block computes the rotations of its
+            // rows and applies them within the block
+            if (mycol == pcol)
+            {
+                blas_idx_t lc0 = block / npcols * nb;
+                for (blas_idx_t r = 0; r < rb; r ++)
+                {
+                    for (blas_idx_t v = 0; v < k; v ++)
+                    {
+                        double& d  = u[lr0 + r + (lc0 + r) * lld];
+                        double  xr = xl[(lc0 + r) * k + v];
+                        double  dd = d * d + sign * xr * xr;
+                        double  c = 1.0, s = 0.0;
+                        if (info == 0 && (dd <= 0.0 || d == 0.0))
+                            info = r0 + r + 1;
+                        if (info == 0)
+                        {
+                            double dn = sqrt(dd);
+                            c = dn / d;
+                            s = xr / d;
+                            d = dn;
+                        }
+                        rot[2 * (r * k + v)]     = c;
+                        rot[2 * (r * k + v) + 1] = s;
+
+                        for (blas_idx_t j = r + 1; j < rb; j ++)
+                        {
+                            double& urj = u[lr0 + r + (lc0 + j) * lld];
+                            double& xj  = xl[(lc0 + j) * k + v];
+                            urj = (urj + sign * s * xj) / c;
+                            xj  = c * xj - s * urj;
+                        }
+                    }
+                }
+            }
+            if (npcols > 1)
+                MPI_Bcast(rot.data(), int(2 * rb * k), MPI_DOUBLE, int(pcol), row_comm);
+
+            for (blas_idx_t jl = trailing; jl < cols; jl ++)
+            {
+                for (blas_idx_t r = 0; r < rb; r ++)
+                {
+                    double& urj = u[lr0 + r + jl * lld];
+                    for (blas_idx_t v = 0; v < k; v ++)
+                    {
+                        double  c  = rot[2 * (r * k + v)], s = rot[2 * (r * k + v) + 1];
+                        double& xj = xl[jl * k + v];
+                        urj = (urj + sign * s * xj) / c;
+                        xj  = c * xj - s * urj;
+                    }
+                }
+            }
+        }
+
+        // Only the process row of the next block row needs the rotated X
+        blas_idx_t next = (block + 1 + desc[RSRC_]) % nprows;
+        int        count = int((cols - trailing) * k);
+        if (block + 1 < blocks && next != prow && count > 0)
+        {
+            if (myrow == prow)
+                MPI_Send(&xl[trailing * k], count, MPI_DOUBLE, int(next), 0, col_comm);
+            else if (myrow == next)
+                MPI_Recv(&xl[trailing * k], count, MPI_DOUBLE, int(prow), 0, col_comm, MPI_STATUS_IGNORE);
+        }
+    }
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    m_factors->mark_modified();
+
+    // The first failure over all processes
+    double first = info > 0 ? double(info) : double(n + 1);
+    MPI_Allreduce(MPI_IN_PLACE, &first, 1, MPI_DOUBLE, MPI_MIN, grid->comm());
+    info = first <= double(n) ? blas_idx_t(first) : 0;
+    if (info != 0)
+        m_factors.reset();
+    return info;
+}
+
+blas_idx_t factorization_t::update(std::shared_ptr<block_cyclic_mat_t> u, std::shared_ptr<block_cyclic_mat_t> v)
+{
+    assert(m_kind == LU);
+    blas_idx_t n = m_a->global_rows(), k = u->global_cols();
+    assert(u->global_rows() == n && v->global_rows() == n && v->global_cols() == k);
+
+    bool current = !stale();
+    gemm(*u, block_cyclic_view_t(*v).transpose(), *m_a, 1.0, 1.0);
+    if (!current)
+        return 0;
+    if (rank() + k > m_max_rank)
+        return factor();
+
+    // W = A0^-1 U with the factors of A0, in the distribution PxGETRS
+    // expects
+    blas_idx_t mb = m_factors->row_block_size(), nb = m_factors->col_block_size();
+    auto w = std::make_shared<block_cyclic_mat_t>(m_a->grid(), n, k, mb, nb);
+    blas_idx_t one = 1, ctxt = w->grid()->context(), info;
+    scalapack_traits<double>::gemr2d(n, k, u->local_data(), one, one, u->descriptor(),
+        w->local_data(), one, one, w->descriptor(), ctxt);
+
+    char trans = 'N';
+    scalapack_traits<double>::getrs (trans, n, k, 
+        m_factors->local_data(), one, one, m_factors->descriptor(), 
+        m_ipiv.data(), 
+        w->local_data(), one, one, w->descriptor(), 
+        info);
+
+    m_w = append_columns(m_w, *w, mb, nb);
+    m_v = append_columns(m_v, *v, mb, nb);
+    m_version = m_a->version();
+
+    // A + U V^T is singular exactly when C is
+    if (smw_factor() != 0)
+        return factor();
+    return 0;
+}
+
+// Forms C = I + V^T W on every process and factorizes it with DGETRF
+blas_idx_t factorization_t::smw_factor()
+{
+    blas_idx_t k = m_w->global_cols(), ldc = k, info;
+    auto c = std::make_shared<block_cyclic_mat_t>(m_w->grid(), k, k, m_w->col_block_size(), m_w->col_block_size());
+    gemm(block_cyclic_view_t(*m_v).transpose(), *m_w, *c);
+
+    m_capacitance = replicate(*c);
+    for (blas_idx_t i = 0; i < k; i ++)
+        m_capacitance[i + size_t(i) * k] += 1.0;
+
+    m_cpiv.resize(k);
+    dgetrf_ (k, k, m_capacitance.data(), ldc, m_cpiv.data(), info);
+    return info;
+}
+
+blas_idx_t factorization_t::rank() const
+{
+    return m_w ? m_w->global_cols() : 0;
+}
+
+blas_idx_t factorization_t::max_rank() const
+{
+    return m_max_rank;
+}
+
+void factorization_t::set_max_rank(blas_idx_t max_rank)
+{
+    m_max_rank = max_rank;
+}
+
+bool factorization_t::stale() const
+{
+    return !m_factors || m_version != m_a->version();
+}
+
+factorization_t::kind_t factorization_t::kind() const
+{
+    return m_kind;
+}
+
+std::shared_ptr<block_cyclic_mat_t> factorization_t::matrix()
+{
+    return m_a;
+}
+
+std::shared_ptr<block_cyclic_mat_t> factorization_t::factors()
+{
+    return m_factors;
+}
+
+const std::vector<blas_idx_t>& factorization_t::pivots() const
+{
+    return m_ipiv;
+}
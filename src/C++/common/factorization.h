@@ -0,0 +1,172 @@
+// -*- mode: c++ -*-
+#ifndef _FACTORIZATION_H_
+#define _FACTORIZATION_H_
+
+#include <memory>
+#include <vector>
+#include "block_cyclic_mat.h"
+
+/// <summary>
+///   A class that keeps the LU or Cholesky factors of a distributed 
+///   matrix so that right-hand sides arriving over time can be solved
+///   without refactoring the matrix.
+/// </summary>
+/// <remark>
+///   The factors are computed on a copy, so the original matrix is left
+///   intact. The factorization remembers the version of the matrix it was
+///   computed from and is stale once the matrix is marked as modified.
+///
+///   A low-rank change to the matrix made through update() or downdate()
+///   keeps the factorization current in O(k N^2) operations instead of
+///   the O(N^3) of factorizing it again. A Cholesky factor is updated in
+///   place, and an LU factorization keeps the factors of the matrix it was
+///   computed from and solves with the Sherman-Morrison-Woodbury formula
+///   until the accumulated rank of the changes exceeds max_rank().
+/// </remark>
+class factorization_t
+{
+public:
+    /// <summary>
+    ///   The kind of factorization.
+    ///     LU: PA = LU with partial pivoting, computed with PxGETRF (DEFAULT).
+    ///     CHOLESKY: A = U^T U for symmetric positive definite matrices,
+    ///         computed with PxPOTRF.
+    /// </summary>
+    enum kind_t {LU, CHOLESKY};
+
+    /// <summary>
+    ///   Creates a factorization of the given square matrix. No work is
+    ///   done until factor() or solve() is called.
+    /// </summary>
+    factorization_t(std::shared_ptr<block_cyclic_mat_t> a, kind_t kind = LU);
+
+    /// <summary>
+    ///   Factorizes the current contents of the matrix and returns the INFO
+    ///   value of the ScaLAPACK subroutine, which is zero on success.
+    /// </summary>
+    blas_idx_t factor();
+
+    /// <summary>
+    ///   Overwrites b with the solution of AX = B using PxGETRS or PxPOTRS, 
+    ///   and returns the INFO value of the ScaLAPACK subroutine. If the 
+    ///   factors are stale the matrix is factorized again first.
+    /// </summary>
+    /// <param name="b">
+    ///   The right-hand sides, which must have as many rows as A and be
+    ///   distributed on the same grid with the same row block size.
+    /// </param>
+    blas_idx_t solve(std::shared_ptr<block_cyclic_mat_t> b);
+
+    /// <summary>
+    ///   Adds X X^T to a symmetric positive definite matrix factorized by
+    ///   Cholesky, updating the factor in place, and returns zero.
+    /// </summary>
+    /// <param name="x">
+    ///   The N x K matrix X, on the grid of A.
+    /// </param>
+    /// <remark>
+    ///   The factor U is updated as by K rank-one updates, each a sweep of
+    ///   Givens rotations down the rows of U as in LINPACK DCHUD. A block
+    ///   row of U is rotated by the process row that owns it: the owner of
+    ///   the diagonal block computes the rotations, which are broadcast
+    ///   along the process row, and the rotated columns of X are passed
+    ///   to the process row that owns the next block row. The matrix is
+    ///   updated with PDGEMM. If the factorization is stale, only the
+    ///   matrix is updated.
+    /// </remark>
+    blas_idx_t update(std::shared_ptr<block_cyclic_mat_t> x);
+
+    /// <summary>
+    ///   Subtracts X X^T from a matrix factorized by Cholesky, as update()
+    ///   adds it, and returns zero, or J if the leading minor of order J of
+    ///   the result is not positive definite, in which case the factors are
+    ///   discarded as after a failed factor().
+    /// </summary>
+    blas_idx_t downdate(std::shared_ptr<block_cyclic_mat_t> x);
+
+    /// <summary>
+    ///   Adds U V^T to a matrix factorized by LU and returns zero, or the
+    ///   INFO value of PxGETRF if the matrix is factorized again.
+    /// </summary>
+    /// <param name="u">
+    ///   The N x K matrices U and V, on the grid of A.
+    /// </param>
+    /// <remark>
+    ///   The factors of the matrix A0 last factorized are kept, together
+    ///   with W = A0^-1 U and V accumulated over the updates, and the
+    ///   K x K matrix C = I + V^T W, which every process factorizes with
+    ///   DGETRF. solve() then computes X = Y - W C^-1 V^T Y from the
+    ///   solution Y = A0^-1 B, which costs O(K N) more per right-hand side
+    ///   than PxGETRS. Once the accumulated rank would exceed max_rank(),
+    ///   or if C is singular, the updated matrix is factorized again
+    ///   instead. If the factorization is stale, only the matrix is
+    ///   updated.
+    /// </remark>
+    blas_idx_t update(std::shared_ptr<block_cyclic_mat_t> u, std::shared_ptr<block_cyclic_mat_t> v);
+
+    /// <summary>
+    ///   Returns the rank of the changes that solve() applies with the
+    ///   Sherman-Morrison-Woodbury formula, which is zero after factor().
+    /// </summary>
+    blas_idx_t rank() const;
+
+    /// <summary>
+    ///   Returns or sets the accumulated rank beyond which an LU update
+    ///   factorizes the matrix again. It defaults to the column block size
+    ///   of the matrix.
+    /// </summary>
+    blas_idx_t max_rank() const;
+    void set_max_rank(blas_idx_t max_rank);
+
+    /// <summary>
+    ///   Returns true if the matrix has not been factorized yet or has been 
+    ///   modified since it was last factorized.
+    /// </summary>
+    bool stale() const;
+
+    /// <summary>
+    ///   Returns the kind of factorization.
+    /// </summary>
+    kind_t kind() const;
+
+    /// <summary>
+    ///   Returns the matrix being factorized.
+    /// </summary>
+    std::shared_ptr<block_cyclic_mat_t> matrix();
+
+    /// <summary>
+    ///   Returns the distributed factors in ScaLAPACK format, or an empty
+    ///   pointer before the first factorization.
+    /// </summary>
+    std::shared_ptr<block_cyclic_mat_t> factors();
+
+    /// <summary>
+    ///   Returns the local pivot indices computed by PxGETRF. This is
+    ///   empty for a Cholesky factorization.
+    /// </summary>
+    const std::vector<blas_idx_t>& pivots() const;
+
+private:
+    std::shared_ptr<block_cyclic_mat_t> m_a;
+    std::shared_ptr<block_cyclic_mat_t> m_factors;
+    std::vector<blas_idx_t>             m_ipiv;
+    kind_t                              m_kind;
+    unsigned long                       m_version;
+
+    // The Sherman-Morrison-Woodbury terms of the LU updates: W, V and the
+    // LU factors of C with their pivots, replicated on every process
+    std::shared_ptr<block_cyclic_mat_t> m_w;
+    std::shared_ptr<block_cyclic_mat_t> m_v;
+    std::vector<double>                 m_capacitance;
+    std::vector<blas_idx_t>             m_cpiv;
+    blas_idx_t                          m_max_rank;
+
+    blas_idx_t rotate(block_cyclic_mat_t& x, double sign);
+    blas_idx_t smw_factor();
+
+    // Mark this class as non-copyable
+    factorization_t(const factorization_t&);
+    const factorization_t& operator=(const factorization_t&);
+};
+
+#endif // _FACTORIZATION_H_
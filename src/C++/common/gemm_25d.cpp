@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <mpi.h>
+
+#include "blacs.h"
+#include "gemm_25d.h"
+#include "local_storage.h"
+#include "scalapack_traits.h"
+#include "trace.h"
+
+// The free memory of the node shared by the processes on it, as the
+// minimum over every process in the system
+static double memory_per_process()
+{
+    int iam, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iam);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    char name[MPI_MAX_PROCESSOR_NAME] = {0};
+    int  length;
+    MPI_Get_processor_name(name, &length);
+    std::vector<char> names(size_t(nprocs) * MPI_MAX_PROCESSOR_NAME);
+    MPI_Allgather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
+        names.data(), MPI_MAX_PROCESSOR_NAME, MPI_CHAR, MPI_COMM_WORLD);
+
+    int local = 0;
+    for (int p = 0; p < nprocs; p ++)
+    {
+        if (strncmp(name, &names[size_t(p) * MPI_MAX_PROCESSOR_NAME], MPI_MAX_PROCESSOR_NAME) == 0)
+            local ++;
+    }
+
+    double memory = double(local_storage_t::available_memory()) / local;
+    MPI_Allreduce(MPI_IN_PLACE, &memory, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+    return memory;
+}
+
+blas_idx_t gemm_25d_layers(blas_idx_t m, blas_idx_t n, blas_idx_t k, size_t element_size)
+{
+    int nprocs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    double budget = 0.5 * memory_per_process();
+
+    // The slices of A and B, the partial product and the sum copied back
+    // to the grid of C
+    double M = m, N = n, K = k, P = nprocs;
+    blas_idx_t layers = 1;
+    for (blas_idx_t c = 2; double(c) * c * c <= P; c ++)
+    {
+        double bytes = (M * K + K * N + (c + 1) * M * N) / P * element_size;
+        if (nprocs % c == 0 && bytes <= budget)
+            layers = c;
+    }
+    return layers;
+}
+
+// The descriptor a process passes to PxGEMR2D for a matrix on a grid it
+// is not part of
+static void outside_descriptor(blas_idx_t m, blas_idx_t n, blas_idx_t mb, blas_idx_t nb, blas_idx_t* desc)
+{
+    desc[DTYPE_] = 1;
+    desc[CTXT_]  = -1;
+    desc[M_]     = m;
+    desc[N_]     = n;
+    desc[MB_]    = mb;
+    desc[NB_]    = nb;
+    desc[RSRC_]  = 0;
+    desc[CSRC_]  = 0;
+    desc[LLD_]   = 1;
+}
+
+// The first of the columns 0 to n - 1 that part l of c starts at, rounded
+// to a multiple of the block size nb
+static blas_idx_t split_point(blas_idx_t n, blas_idx_t nb, blas_idx_t l, blas_idx_t c)
+{
+    blas_idx_t blocks = (n + nb - 1) / nb;
+    return std::min(n, l * blocks / c * nb);
+}
+
+gemm_25d_plan_t::gemm_25d_plan_t(blas_idx_t layers)
+    : m_layers(layers), m_layer(0), m_context(-1), m_fiber(MPI_COMM_NULL)
+{
+    blas_idx_t iam, nprocs;
+    {
+        trace_scope_t blacs("blacs_pinfo", trace_t::BLACS);
+        blacs_pinfo_ (iam, nprocs);
+    }
+    assert(layers >= 1 && nprocs % layers == 0);
+    if (layers == 1)
+        return;
+
+    // PxGEMR2D between a layer and the full grid needs a context over
+    // every process, as in redistribute
+    blas_idx_t negone = -1, zero = 0, one = 1;
+    blacs_get_ (negone, zero, m_context);
+    const char* row_major = "Row";
+    {
+        trace_scope_t blacs("blacs_gridinit", trace_t::BLACS);
+        blacs_gridinit_ (m_context, row_major, one, nprocs);
+    }
+
+    m_grid = blacs_grid_t::split(layers, m_layer);
+
+    // Processes in the same position of every layer hold the same part of
+    // their partial products
+    int position;
+    MPI_Comm_rank(m_grid->comm(), &position);
+    MPI_Comm_split(MPI_COMM_WORLD, position, int(m_layer), &m_fiber);
+}
+
+gemm_25d_plan_t::~gemm_25d_plan_t()
+{
+    if (m_fiber != MPI_COMM_NULL)
+        MPI_Comm_free(&m_fiber);
+    m_grid.reset();
+    if (m_context >= 0)
+    {
+        trace_scope_t blacs("blacs_gridexit", trace_t::BLACS);
+        blacs_gridexit_ (m_context);
+    }
+}
+
+blas_idx_t gemm_25d_plan_t::layers() const
+{
+    return m_layers;
+}
+
+blas_idx_t gemm_25d_plan_t::layer() const
+{
+    return m_layer;
+}
+
+blas_idx_t gemm_25d_plan_t::context() const
+{
+    return m_context;
+}
+
+std::shared_ptr<blacs_grid_t> gemm_25d_plan_t::grid() const
+{
+    return m_grid;
+}
+
+MPI_Comm gemm_25d_plan_t::fiber() const
+{
+    return m_fiber;
+}
+
+template <typename T>
+static blas_idx_t gemm_25d_impl(const gemm_25d_plan_t& plan, basic_block_cyclic_mat_t<T>& a,
+    basic_block_cyclic_mat_t<T>& b, basic_block_cyclic_mat_t<T>& c, T alpha, T beta)
+{
+    typedef basic_block_cyclic_mat_t<T> mat_t;
+    typedef scalapack_traits<T>         traits;
+
+    blas_idx_t m = c.global_rows(), n = c.global_cols(), k = a.global_cols();
+    assert(a.global_rows() == m && b.global_rows() == k && b.global_cols() == n);
+    assert(a.grid()->context() == c.grid()->context() && b.grid()->context() == c.grid()->context());
+
+    blas_idx_t layers = plan.layers();
+    assert(layers == 1 || c.grid()->nprocs() == plan.grid()->nprocs() * layers);
+
+    char       trans = 'N';
+    blas_idx_t one = 1;
+    if (layers == 1)
+    {
+        traits::gemm(trans, trans, m, n, k, alpha,
+            a.local_data(), one, one, a.descriptor(),
+            b.local_data(), one, one, b.descriptor(),
+            beta,
+            c.local_data(), one, one, c.descriptor());
+        c.mark_modified();
+        return 1;
+    }
+
+    trace_scope_t scope("gemm_25d");
+
+    blas_idx_t ictxt = plan.context();
+    blas_idx_t layer = plan.layer();
+    auto       grid  = plan.grid();
+
+    // Every process takes part in the copy of every slice, receiving only
+    // the one of its own layer
+    std::shared_ptr<mat_t> al, bl;
+    blas_idx_t kl = 0, outside[DLEN_];
+    T          dummy = T();
+    for (blas_idx_t l = 0; l < layers; l ++)
+    {
+        blas_idx_t k0 = split_point(k, a.col_block_size(), l, layers);
+        blas_idx_t kn = split_point(k, a.col_block_size(), l + 1, layers) - k0;
+        if (kn == 0)
+            continue;
+
+        blas_idx_t ja = k0 + 1, ib = k0 + 1;
+        if (l == layer)
+        {
+            kl = kn;
+            al = std::make_shared<mat_t>(grid, m, kn, a.row_block_size(), a.col_block_size());
+            bl = std::make_shared<mat_t>(grid, kn, n, b.row_block_size(), b.col_block_size());
+            traits::gemr2d(m, kn, a.local_data(), one, ja, a.descriptor(), al->local_data(), one, one, al->descriptor(), ictxt);
+            traits::gemr2d(kn, n, b.local_data(), ib, one, b.descriptor(), bl->local_data(), one, one, bl->descriptor(), ictxt);
+        }
+        else
+        {
+            outside_descriptor(m, kn, a.row_block_size(), a.col_block_size(), outside);
+            traits::gemr2d(m, kn, a.local_data(), one, ja, a.descriptor(), &dummy, one, one, outside, ictxt);
+            outside_descriptor(kn, n, b.row_block_size(), b.col_block_size(), outside);
+            traits::gemr2d(kn, n, b.local_data(), ib, one, b.descriptor(), &dummy, one, one, outside, ictxt);
+        }
+    }
+
+    // The partial product of the layer, which is zero if K has fewer
+    // blocks than there are layers
+    auto cl = std::make_shared<mat_t>(grid, m, n, c.row_block_size(), c.col_block_size());
+    if (kl > 0)
+    {
+        T nought = T();
+        traits::gemm(trans, trans, m, n, kl, alpha,
+            al->local_data(), one, one, al->descriptor(),
+            bl->local_data(), one, one, bl->descriptor(),
+            nought,
+            cl->local_data(), one, one, cl->descriptor());
+    }
+    al.reset();
+    bl.reset();
+
+    // Layer l sums the columns of C from split point l onwards across the
+    // processes in the same position of every layer
+    MPI_Comm fiber = plan.fiber();
+    blas_idx_t nb = c.col_block_size(), rows = cl->local_rows(), lld = cl->descriptor()[LLD_];
+    for (blas_idx_t l = 0; l < layers; l ++)
+    {
+        blas_idx_t first = grid->local_cols(split_point(n, nb, l, layers), nb);
+        blas_idx_t last  = grid->local_cols(split_point(n, nb, l + 1, layers), nb);
+        int        count = rows > 0 ? int((last - first) * lld) : 0;
+        T*         part  = cl->local_data() + first * lld;
+        if (count == 0)
+            continue;
+
+        if (l == layer)
+            MPI_Reduce(MPI_IN_PLACE, part, count, traits::mpi_type(), MPI_SUM, int(l), fiber);
+        else
+            MPI_Reduce(part, NULL, count, traits::mpi_type(), MPI_SUM, int(l), fiber);
+    }
+
+    // Copy the sums back to the distribution of C
+    auto sum = std::make_shared<mat_t>(c.grid(), m, n, c.row_block_size(), c.col_block_size(),
+        mat_t::ZERO, T(), storage_policy_t::default_policy(), c.descriptor()[RSRC_], c.descriptor()[CSRC_]);
+    for (blas_idx_t l = 0; l < layers; l ++)
+    {
+        blas_idx_t n0 = split_point(n, nb, l, layers);
+        blas_idx_t nn = split_point(n, nb, l + 1, layers) - n0;
+        if (nn == 0)
+            continue;
+
+        blas_idx_t jc = n0 + 1;
+        if (l == layer)
+        {
+            traits::gemr2d(m, nn, cl->local_data(), one, jc, cl->descriptor(), sum->local_data(), one, jc, sum->descriptor(), ictxt);
+        }
+        else
+        {
+            outside_descriptor(m, n, c.row_block_size(), c.col_block_size(), outside);
+            traits::gemr2d(m, nn, &dummy, one, jc, outside, sum->local_data(), one, jc, sum->descriptor(), ictxt);
+        }
+    }
+
+    // C = alpha A B + beta C, ignoring C when beta is zero as PxGEMM does
+    T*       dst = c.local_data();
+    const T* src = sum->local_data();
+    for (blas_idx_t i = 0; i < c.local_size(); i ++)
+        dst[i] = beta == T() ? src[i] : beta * dst[i] + src[i];
+    c.mark_modified();
+    return layers;
+}
+
+#define DEFINE_GEMM_25D(T) \
+    blas_idx_t gemm_25d(const gemm_25d_plan_t& plan, basic_block_cyclic_mat_t<T>& a, \
+        basic_block_cyclic_mat_t<T>& b, basic_block_cyclic_mat_t<T>& c, T alpha, T beta) \
+    { \
+        return gemm_25d_impl(plan, a, b, c, alpha, beta); \
+    } \
+    blas_idx_t gemm_25d(basic_block_cyclic_mat_t<T>& a, basic_block_cyclic_mat_t<T>& b, \
+        basic_block_cyclic_mat_t<T>& c, T alpha, T beta, blas_idx_t layers) \
+    { \
+        if (layers == 0) \
+            layers = gemm_25d_layers(c.global_rows(), c.global_cols(), a.global_cols(), sizeof(T)); \
+        gemm_25d_plan_t plan(layers); \
+        return gemm_25d_impl(plan, a, b, c, alpha, beta); \
+    }
+
+DEFINE_GEMM_25D(float)
+DEFINE_GEMM_25D(double)
+DEFINE_GEMM_25D(std::complex<float>)
+DEFINE_GEMM_25D(std::complex<double>)
@@ -0,0 +1,112 @@
+// -*- mode: c++ -*-
+#ifndef _GEMM_25D_H_
+#define _GEMM_25D_H_
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <mpi.h>
+#include "block_cyclic_mat.h"
+
+/// <remark>
+///   A communication-avoiding matrix multiply for grids too large for
+///   PxGEMM to keep its rate, trading memory for communication as in the
+///   2.5D algorithm of Solomonik and Demmel.
+///
+///   The P processes are split into c layers of P / c processes each, with
+///   blacs_grid_t::split. Layer l receives the l-th of c slices of the K
+///   dimension, A(:, K_l) and B(K_l, :), multiplies them with PxGEMM on its
+///   own grid and holds a partial M x N product. The partial products are
+///   summed across the layers, each layer collecting the c-th of the
+///   columns of C it is responsible for, and copied back to the grid of C.
+///
+///   On square grids, a process receives about (M + N) K / sqrt(P c)
+///   elements in the PxGEMM of its layer, instead of the (M + N) K /
+///   sqrt(P) of PxGEMM on all P processes, which is the sqrt(c) saving of
+///   2.5D. The price is O((M K + K N + c M N) / P) elements moved
+///   to and from the layers, and a partial product c times the size of
+///   its share of C held on every process. Slicing A and B rather than
+///   replicating them, as the original 2.5D algorithm does, keeps their
+///   copies the size of the originals.
+///
+///   The functions below are overloaded for the four element types.
+///
+///   blas_idx_t gemm_25d(A, B, C, T alpha, T beta, blas_idx_t layers = 0)
+///     C = alpha A B + beta C for an M x K matrix A and a K x N matrix B,
+///     returning the number of layers used. A, B and C are ordinary
+///     distributed matrices on one grid of every process in the system,
+///     which is where the result is left, with any block sizes. layers
+///     must divide the number of processes, and zero chooses it with
+///     gemm_25d_layers. With one layer this is PxGEMM. Every process in
+///     the system must call it. It sets up a gemm_25d_plan_t for the call,
+///     so repeated multiplies should make one plan and pass it instead.
+///
+///   blas_idx_t gemm_25d(plan, A, B, C, T alpha, T beta)
+///     As above with the layers, grids and communicators of the plan.
+///
+///   blas_idx_t gemm_25d_layers(M, N, K, size_t element_size)
+///     Returns the number of layers c that gemm_25d uses by default: the
+///     largest divisor of the number of processes P, no larger than
+///     P^(1/3), for which the copies of the slices of A and B and the
+///     partial product fit in half of the free memory of every process.
+///     More than P^(1/3) layers would make the reduction cost more than
+///     the multiply saves. The free memory of a node is shared equally by
+///     its processes. Every process in the system must call it.
+/// </remark>
+
+blas_idx_t gemm_25d_layers(blas_idx_t m, blas_idx_t n, blas_idx_t k, size_t element_size);
+
+/// <summary>
+///   The BLACS context over every process, the grid of the layer of the
+///   calling process and the communicator between the processes in the
+///   same position of every layer that gemm_25d needs for a number of
+///   layers, which are costly to create and can be reused by any multiply
+///   with that number of layers.
+/// </summary>
+/// <remark>
+///   Creating and destroying a plan is collective over every process in
+///   the system. With one layer no grids are created.
+/// </remark>
+class gemm_25d_plan_t
+{
+public:
+    /// <summary>
+    ///   Creates the grids for the given number of layers, which must
+    ///   divide the number of processes.
+    /// </summary>
+    explicit gemm_25d_plan_t(blas_idx_t layers);
+
+    ~gemm_25d_plan_t();
+
+    blas_idx_t                    layers()  const;
+    blas_idx_t                    layer()   const;
+    blas_idx_t                    context() const;
+    std::shared_ptr<blacs_grid_t> grid()    const;
+    MPI_Comm                      fiber()   const;
+
+private:
+    blas_idx_t                    m_layers;
+    blas_idx_t                    m_layer;
+    blas_idx_t                    m_context;
+    std::shared_ptr<blacs_grid_t> m_grid;
+    MPI_Comm                      m_fiber;
+
+    // Mark this class as non-copyable
+    gemm_25d_plan_t(const gemm_25d_plan_t&);
+    const gemm_25d_plan_t& operator=(const gemm_25d_plan_t&);
+};
+
+#define DECLARE_GEMM_25D(T) \
+    blas_idx_t gemm_25d(basic_block_cyclic_mat_t<T>& a, basic_block_cyclic_mat_t<T>& b, \
+        basic_block_cyclic_mat_t<T>& c, T alpha, T beta, blas_idx_t layers = 0); \
+    blas_idx_t gemm_25d(const gemm_25d_plan_t& plan, basic_block_cyclic_mat_t<T>& a, \
+        basic_block_cyclic_mat_t<T>& b, basic_block_cyclic_mat_t<T>& c, T alpha, T beta);
+
+DECLARE_GEMM_25D(float)
+DECLARE_GEMM_25D(double)
+DECLARE_GEMM_25D(std::complex<float>)
+DECLARE_GEMM_25D(std::complex<double>)
+
+#undef DECLARE_GEMM_25D
+
+#endif // _GEMM_25D_H_
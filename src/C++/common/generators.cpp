@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+
+#include "counter_rng.h"
+#include "generators.h"
+
+// The generators are implemented once as templates and exposed through the
+// overloads declared in generators.h
+
+static float  conjugate(float x)  { return x; }
+static double conjugate(double x) { return x; }
+
+template <typename R>
+static std::complex<R> conjugate(const std::complex<R>& x) { return std::conj(x); }
+
+static float  real_part(float x)  { return x; }
+static double real_part(double x) { return x; }
+
+template <typename R>
+static R real_part(const std::complex<R>& x) { return x.real(); }
+
+template <typename T>
+static void toeplitz_impl(basic_block_cyclic_mat_t<T>& a, const std::vector<T>& col, const std::vector<T>& row)
+{
+    blas_idx_t ncol = blas_idx_t(col.size()), nrow = blas_idx_t(row.size());
+    generate(a, [&](blas_idx_t i, blas_idx_t j) -> T {
+        if (i >= j)
+            return i - j < ncol ? col[i - j] : T();
+        return j - i < nrow ? row[j - i] : T();
+    });
+}
+
+template <typename T>
+static void tridiagonal_impl(basic_block_cyclic_mat_t<T>& a)
+{
+    std::vector<T> band(2);
+    band[0] = T( 2);
+    band[1] = T(-1);
+    toeplitz_impl(a, band, band);
+}
+
+// Fills the band with uniform random values in (0,1) and adds shift to the
+// diagonal, which makes the rows and columns strictly diagonally dominant
+// when the shift is at least twice the number of diagonals in the band
+template <typename T>
+static void random_band(basic_block_cyclic_mat_t<T>& a, blas_idx_t kl, blas_idx_t ku, T shift, uint64_t seed)
+{
+    counter_rng_t rng(seed);
+    generate(a, [&](blas_idx_t i, blas_idx_t j) -> T {
+        if (i - j > kl || j - i > ku)
+            return T();
+        T value = rng.uniform<T>(uint64_t(i), uint64_t(j));
+        return i == j ? value + shift : value;
+    });
+}
+
+template <typename T>
+static void diagonally_dominant_impl(basic_block_cyclic_mat_t<T>& a, uint64_t seed)
+{
+    blas_idx_t n = std::max(a.global_rows(), a.global_cols());
+    random_band(a, n, n, T(2 * n), seed);
+}
+
+template <typename T>
+static void banded_impl(basic_block_cyclic_mat_t<T>& a, blas_idx_t kl, blas_idx_t ku, uint64_t seed)
+{
+    assert(kl >= 0 && ku >= 0);
+    random_band(a, kl, ku, T(2 * (kl + ku + 1)), seed);
+}
+
+// Builds A = H D H element by element, where H = I - 2 v v^H / s with
+// s = v^H v, which expands to
+//   A(i, j) = d_i [i == j] + v_i conj(v_j) (4 w / s^2 - 2 (d_i + d_j) / s)
+// with w = v^H D v
+template <typename T, typename R>
+static void spd_impl(basic_block_cyclic_mat_t<T>& a, R cond, uint64_t seed)
+{
+    assert(a.global_rows() == a.global_cols() && cond >= R(1));
+
+    // The reflector is the difference of a row and a column of the
+    // generator that no matrix element uses, so it is centred on zero
+    blas_idx_t n = a.global_rows();
+    counter_rng_t rng(seed);
+    std::vector<T> v(n);
+    std::vector<R> d(n);
+    R s = R(0), w = R(0);
+    for (blas_idx_t i = 0; i < n; i ++)
+    {
+        v[i] = rng.uniform<T>(uint64_t(i), ~uint64_t(0)) - rng.uniform<T>(~uint64_t(0), uint64_t(i));
+        d[i] = n > 1 ? std::pow(cond, -R(i) / R(n - 1)) : R(1);
+        R vv = real_part(conjugate(v[i]) * v[i]);
+        s += vv;
+        w += d[i] * vv;
+    }
+
+    R c = R(4) * w / (s * s);
+    generate(a, [&](blas_idx_t i, blas_idx_t j) -> T {
+        T value = v[i] * conjugate(v[j]) * (c - R(2) * (d[i] + d[j]) / s);
+        return i == j ? value + d[i] : value;
+    });
+}
+
+#define DEFINE_GENERATORS(T, R) \
+    void fill_toeplitz(basic_block_cyclic_mat_t<T>& a, const std::vector<T>& col, const std::vector<T>& row) \
+    { \
+        toeplitz_impl(a, col, row); \
+    } \
+    void fill_tridiagonal(basic_block_cyclic_mat_t<T>& a) \
+    { \
+        tridiagonal_impl(a); \
+    } \
+    void fill_diagonally_dominant(basic_block_cyclic_mat_t<T>& a, uint64_t seed) \
+    { \
+        diagonally_dominant_impl(a, seed); \
+    } \
+    void fill_banded(basic_block_cyclic_mat_t<T>& a, blas_idx_t kl, blas_idx_t ku, uint64_t seed) \
+    { \
+        banded_impl(a, kl, ku, seed); \
+    } \
+    void fill_spd(basic_block_cyclic_mat_t<T>& a, R cond, uint64_t seed) \
+    { \
+        spd_impl(a, cond, seed); \
+    }
+
+DEFINE_GENERATORS(float,                float)
+DEFINE_GENERATORS(double,               double)
+DEFINE_GENERATORS(std::complex<float>,  float)
+DEFINE_GENERATORS(std::complex<double>, double)
@@ -0,0 +1,98 @@
+// -*- mode: c++ -*-
+#ifndef _GENERATORS_H_
+#define _GENERATORS_H_
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+#include "block_cyclic_mat.h"
+
+/// <remark>
+///   Test matrix generators. Each of them evaluates every element of the
+///   local part of a distributed matrix from its global (i, j) index in a
+///   single pass over the local columns, spread over the OpenMP worker
+///   threads, without any communication. The global matrix is therefore
+///   the same for any grid shape or block size. Random values come from
+///   counter_rng_t, as with basic_block_cyclic_mat_t::randomize, and the
+///   seed selects one of the independent matrices of a given size.
+/// </remark>
+
+/// <summary>
+///   Sets every element A(i, j) of the matrix to f(i, j), where i and j
+///   are the global row and column from 0. f is called concurrently from
+///   several threads, so it must not modify shared state.
+/// </summary>
+template <typename T, typename F>
+void generate(basic_block_cyclic_mat_t<T>& a, F f)
+{
+    std::vector<blas_idx_t> rows(a.local_rows());
+    for (blas_idx_t il = 0; il < a.local_rows(); il ++)
+        rows[il] = a.global_row(il);
+
+    T*              local = a.local_data();
+    blas_idx_t      lld   = a.descriptor()[LLD_];
+    blas_idx_t      m     = a.local_rows();
+    const ptrdiff_t ncols = ptrdiff_t(a.local_cols());
+#pragma omp parallel for schedule(static)
+    for (ptrdiff_t jl = 0; jl < ncols; jl ++)
+    {
+        blas_idx_t j   = a.global_col(blas_idx_t(jl));
+        T*         col = local + jl * lld;
+        for (blas_idx_t il = 0; il < m; il ++)
+            col[il] = f(rows[il], j);
+    }
+    a.mark_modified();
+}
+
+/// <remark>
+///   The generators are overloaded for the four element types. For
+///   element type T with real type R they are:
+///
+///   void fill_toeplitz(A, const std::vector&lt;T&gt;&amp; col, const std::vector&lt;T&gt;&amp; row)
+///     Sets A(i, j) to col[i - j] on and below the diagonal and to
+///     row[j - i] above it, so col[0] is the diagonal and row[0] is not
+///     used. Diagonals beyond the end of the vectors are zero, so that
+///     col = row = {2, -1} gives the -1, 2, -1 tridiagonal matrix.
+///
+///   void fill_tridiagonal(A)
+///     Fills A with the -1, 2, -1 tridiagonal matrix, which is symmetric
+///     positive definite with eigenvalues 2 - 2 cos(k pi / (N + 1)) for
+///     k = 1, ..., N when A is square.
+///
+///   void fill_diagonally_dominant(A, uint64_t seed = 0)
+///     Fills A with uniform random values in (0,1), as randomize does, and
+///     adds 2 max(M_A, N_A) to the diagonal. The rows and columns are then
+///     strictly diagonally dominant, so a square A is well conditioned and
+///     needs no pivoting, unlike a random matrix which gets close to
+///     singular as N grows.
+///
+///   void fill_banded(A, blas_idx_t kl, blas_idx_t ku, uint64_t seed = 0)
+///     The diagonally dominant matrix restricted to KL subdiagonals and KU
+///     superdiagonals, with 2 (KL + KU + 1) added to the diagonal and
+///     zeros outside the band.
+///
+///   void fill_spd(A, R cond, uint64_t seed = 0)
+///     Fills the square A with a symmetric (Hermitian for complex types)
+///     positive definite matrix whose 2-norm condition number is cond.
+///     A = H D H, where D holds the eigenvalues cond^(-i / (N - 1)) spread
+///     geometrically from 1 down to 1 / cond, and H = I - 2 v v^H / v^H v
+///     is a random Householder reflector. This is the approach of LAPACK's
+///     xLATMS with a single reflector; each process computes the O(N)
+///     sums the elements depend on by itself, so no communication is
+///     needed.
+/// </remark>
+#define DECLARE_GENERATORS(T, R) \
+    void fill_toeplitz(basic_block_cyclic_mat_t<T>& a, const std::vector<T>& col, const std::vector<T>& row); \
+    void fill_tridiagonal(basic_block_cyclic_mat_t<T>& a); \
+    void fill_diagonally_dominant(basic_block_cyclic_mat_t<T>& a, uint64_t seed = 0); \
+    void fill_banded(basic_block_cyclic_mat_t<T>& a, blas_idx_t kl, blas_idx_t ku, uint64_t seed = 0); \
+    void fill_spd(basic_block_cyclic_mat_t<T>& a, R cond, uint64_t seed = 0);
+
+DECLARE_GENERATORS(float,                float)
+DECLARE_GENERATORS(double,               double)
+DECLARE_GENERATORS(std::complex<float>,  float)
+DECLARE_GENERATORS(std::complex<double>, double)
+
+#undef DECLARE_GENERATORS
+
+#endif // _GENERATORS_H_
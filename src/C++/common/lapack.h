@@ -0,0 +1,75 @@
+#pragma once
+#include "index.h"
+#include "import.h"
+
+// Serial BLAS and LAPACK routines used on the local part of a distributed
+// matrix. They come from the same library as ScaLAPACK (e.g. Intel MKL).
+
+#ifdef _WIN32
+#define dgemm_  DGEMM
+#define dgeqrf_ DGEQRF
+#define dormqr_ DORMQR
+#define dtrtrs_ DTRTRS
+#define dpotrf_ DPOTRF
+#define dtrsm_  DTRSM
+#define dsyrk_  DSYRK
+#define dgetrf_ DGETRF
+#define dgetrs_ DGETRS
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+    void dgemm_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &);
+
+    void dgeqrf_ (blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        double *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void dormqr_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        double *, 
+        double *, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void dtrtrs_ (char &, char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void dpotrf_ (char &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void dtrsm_ (char &, char &, char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &, 
+        double *, blas_idx_t &);
+
+    void dsyrk_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &);
+
+    void dgetrf_ (blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        blas_idx_t *, blas_idx_t &);
+
+    void dgetrs_ (char &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, 
+        blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &);
+#ifdef __cplusplus
+};
+#endif
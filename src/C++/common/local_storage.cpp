@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <omp.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+#include "local_storage.h"
+
+storage_policy_t storage_policy_t::heap()
+{
+    return storage_policy_t();
+}
+
+storage_policy_t storage_policy_t::anonymous(bool huge_pages /*= true*/)
+{
+    storage_policy_t policy;
+    policy.kind       = ANONYMOUS;
+    policy.huge_pages = huge_pages;
+    return policy;
+}
+
+storage_policy_t storage_policy_t::mapped_file(const std::string& filename)
+{
+    storage_policy_t policy;
+    policy.kind     = MAPPED_FILE;
+    policy.filename = filename;
+    return policy;
+}
+
+storage_policy_t storage_policy_t::aligned(size_t alignment, int numa_node /*= ANY_NODE*/, bool first_touch /*= true*/)
+{
+    storage_policy_t policy;
+    policy.alignment   = alignment;
+    policy.numa_node   = numa_node;
+    policy.first_touch = first_touch;
+    return policy;
+}
+
+static storage_policy_t s_default_policy;
+
+const storage_policy_t& storage_policy_t::default_policy()
+{
+    return s_default_policy;
+}
+
+void storage_policy_t::set_default_policy(const storage_policy_t& policy)
+{
+    s_default_policy = policy;
+}
+
+#ifdef _WIN32
+
+static size_t page_size()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+static int current_node()
+{
+    UCHAR node;
+    return GetNumaProcessorNode(UCHAR(GetCurrentProcessorNumber()), &node) ? int(node) : -1;
+}
+
+static void* map_anonymous(size_t& bytes, bool& huge_pages, int node)
+{
+    void* p = nullptr;
+    SIZE_T large_page = GetLargePageMinimum();
+    DWORD  flags      = MEM_RESERVE | MEM_COMMIT;
+    DWORD  numa_node  = node < 0 ? NUMA_NO_PREFERRED_NODE : DWORD(node);
+
+    // Large pages need the SeLockMemoryPrivilege and a size that is a
+    // multiple of the large page size, so fall back to normal pages
+    if (huge_pages && large_page)
+    {
+        SIZE_T rounded = (bytes + large_page - 1) / large_page * large_page;
+        p = VirtualAllocExNuma(GetCurrentProcess(), NULL, rounded, flags | MEM_LARGE_PAGES, PAGE_READWRITE, numa_node);
+        if (p)
+            bytes = rounded;
+    }
+
+    huge_pages = (p != nullptr);
+    if (!p)
+        p = VirtualAllocExNuma(GetCurrentProcess(), NULL, bytes, flags, PAGE_READWRITE, numa_node);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static int query_node(const void* p)
+{
+    PSAPI_WORKING_SET_EX_INFORMATION info;
+    info.VirtualAddress = const_cast<void*>(p);
+    if (!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)) || !info.VirtualAttributes.Valid)
+        return -1;
+    return int(info.VirtualAttributes.Node);
+}
+
+static void* map_file(const std::string& filename, size_t bytes, void*& file, void*& mapping)
+{
+    HANDLE h = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("unable to open " + filename);
+
+    // CreateFileMapping grows the file if it is smaller than the mapping
+    LARGE_INTEGER size;
+    size.QuadPart = LONGLONG(bytes);
+    HANDLE m = CreateFileMappingA(h, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+    void* p = m ? MapViewOfFile(m, FILE_MAP_ALL_ACCESS, 0, 0, bytes) : nullptr;
+    if (!p)
+    {
+        if (m) CloseHandle(m);
+        CloseHandle(h);
+        throw std::runtime_error("unable to map " + filename);
+    }
+
+    file    = h;
+    mapping = m;
+    return p;
+}
+
+static void unmap(void* p, size_t /*bytes*/, bool is_file, void* file, void* mapping)
+{
+    if (!is_file)
+    {
+        VirtualFree(p, 0, MEM_RELEASE);
+    }
+    else
+    {
+        UnmapViewOfFile(p);
+        CloseHandle(mapping);
+        CloseHandle(file);
+    }
+}
+
+static bool flush_file(void* p, size_t bytes, void* file)
+{
+    return FlushViewOfFile(p, bytes) && FlushFileBuffers(file);
+}
+
+static size_t free_physical_memory()
+{
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? size_t(status.ullAvailPhys) : 0;
+}
+
+#else
+
+// Not every system has numaif.h installed, so call the NUMA system calls
+// directly with the constants from the kernel ABI
+#ifdef SYS_mbind
+static const int s_mpol_bind   = 2;
+static const int s_mpol_f_node = 1 << 0;
+static const int s_mpol_f_addr = 1 << 1;
+#endif
+
+static size_t page_size()
+{
+    return size_t(sysconf(_SC_PAGESIZE));
+}
+
+static int current_node()
+{
+#ifdef SYS_getcpu
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return int(node);
+#endif
+    return -1;
+}
+
+static void bind_node(void* p, size_t bytes, int node)
+{
+#ifdef SYS_mbind
+    const size_t bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(node / bits + 1);
+    mask[node / bits] = 1UL << (node % bits);
+    syscall(SYS_mbind, p, bytes, s_mpol_bind, mask.data(), mask.size() * bits + 1, 0);
+#endif
+}
+
+static void* map_anonymous(size_t& bytes, bool& huge_pages, int node)
+{
+    void* p = MAP_FAILED;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only succeed if the administrator has reserved
+    // them, so fall back to transparent huge pages otherwise. MAP_NORESERVE
+    // must not be used here or a missing reservation shows up as SIGBUS
+    // on first touch instead of a failed mmap.
+    if (huge_pages)
+    {
+        const size_t huge_page = size_t(2) << 20;
+        size_t rounded = (bytes + huge_page - 1) / huge_page * huge_page;
+        p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            bytes = rounded;
+    }
+#endif
+
+    if (p == MAP_FAILED)
+    {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+        huge_pages = huge_pages && madvise(p, bytes, MADV_HUGEPAGE) == 0;
+#else
+        huge_pages = false;
+#endif
+    }
+
+    // No page has been touched yet, so the binding applies to all of them
+    if (node >= 0)
+        bind_node(p, bytes, node);
+    return p;
+}
+
+static int query_node(const void* p)
+{
+#ifdef SYS_get_mempolicy
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, p, s_mpol_f_node | s_mpol_f_addr) == 0)
+        return node;
+#endif
+    return -1;
+}
+
+static void* map_file(const std::string& filename, size_t bytes, void*& file, void*& /*mapping*/)
+{
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw std::runtime_error("unable to open " + filename);
+
+    struct stat st;
+    bool sized = fstat(fd, &st) == 0 &&
+        (size_t(st.st_size) >= bytes || ftruncate(fd, off_t(bytes)) == 0);
+    void* p = sized ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (p == MAP_FAILED)
+    {
+        close(fd);
+        throw std::runtime_error("unable to map " + filename);
+    }
+
+    file = reinterpret_cast<void*>(intptr_t(fd));
+    return p;
+}
+
+static void unmap(void* p, size_t bytes, bool is_file, void* file, void* /*mapping*/)
+{
+    munmap(p, bytes);
+    if (is_file)
+        close(int(reinterpret_cast<intptr_t>(file)));
+}
+
+static bool flush_file(void* p, size_t bytes, void* /*file*/)
+{
+    return msync(p, bytes, MS_SYNC) == 0;
+}
+
+static size_t free_physical_memory()
+{
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    return pages > 0 ? size_t(pages) * page_size() : 0;
+}
+
+#endif
+
+static void* align_up(void* p, size_t alignment)
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<void*>((address + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+// Writes zeros to the storage from the OpenMP worker threads with a static
+// schedule, so that each page is placed on the node of the thread that
+// will most likely work on it
+static void touch(void* p, size_t bytes)
+{
+    char*           c    = static_cast<char*>(p);
+    const size_t    page = page_size();
+    const ptrdiff_t n    = ptrdiff_t((bytes + page - 1) / page);
+#pragma omp parallel for schedule(static)
+    for (ptrdiff_t i = 0; i < n; i ++)
+    {
+        size_t offset = size_t(i) * page;
+        std::memset(c + offset, 0, std::min(page, bytes - offset));
+    }
+}
+
+local_storage_t::local_storage_t(size_t bytes, const storage_policy_t& policy)
+    : m_data(nullptr), m_bytes(bytes), m_base(nullptr), m_base_bytes(0), m_source(VECTOR),
+      m_policy(policy), m_alloc_time(0.0), m_file(nullptr), m_mapping(nullptr)
+{
+    double t0 = omp_get_wtime();
+
+    size_t alignment = std::max(m_policy.alignment, sizeof(double));
+    assert((alignment & (alignment - 1)) == 0);
+
+    if (m_policy.numa_node == storage_policy_t::CURRENT_NODE)
+        m_policy.numa_node = current_node();
+
+    // Empty panels are common on ranks that own no blocks, and a
+    // zero-length mapping is an error, so keep them on the heap
+    bool plain_heap = m_policy.alignment == 0 && m_policy.numa_node < 0 && !m_policy.first_touch;
+    if (bytes == 0)
+    {
+        m_policy.kind = storage_policy_t::HEAP;
+        plain_heap    = true;
+    }
+
+    switch(m_policy.kind)
+    {
+    case storage_policy_t::HEAP:
+        {
+            m_policy.huge_pages = false;
+            if (plain_heap)
+            {
+                // Doubles keep the vector aligned for every element type
+                m_heap.resize((bytes + sizeof(double) - 1) / sizeof(double));
+                m_data = m_heap.data();
+            }
+            else if (m_policy.numa_node < 0)
+            {
+                m_source     = MALLOC;
+                m_base_bytes = bytes + alignment;
+                m_base       = std::malloc(m_base_bytes);
+                if (!m_base)
+                    throw std::bad_alloc();
+                m_data = align_up(m_base, alignment);
+                if (m_policy.first_touch)
+                    touch(m_data, m_bytes);
+                else
+                    std::memset(m_data, 0, m_bytes);
+            }
+            else
+            {
+                // Binding must not leak onto unrelated heap allocations, so
+                // NUMA-bound panels get pages of their own, which the system
+                // hands out zeroed
+                m_source     = MAPPING;
+                m_base_bytes = bytes + (alignment > page_size() ? alignment : 0);
+                m_base       = map_anonymous(m_base_bytes, m_policy.huge_pages, m_policy.numa_node);
+                m_data       = align_up(m_base, alignment);
+                if (m_policy.first_touch)
+                    touch(m_data, m_bytes);
+            }
+            break;
+        }
+    case storage_policy_t::ANONYMOUS:
+        {
+            m_source     = MAPPING;
+            m_base_bytes = bytes + (alignment > page_size() ? alignment : 0);
+            m_base       = map_anonymous(m_base_bytes, m_policy.huge_pages, m_policy.numa_node);
+            m_data       = align_up(m_base, alignment);
+            if (m_policy.first_touch)
+                touch(m_data, m_bytes);
+            break;
+        }
+    case storage_policy_t::MAPPED_FILE:
+        {
+            // File mappings are always page aligned, and their pages live
+            // in the page cache, so neither alignment nor binding applies
+            m_source            = FILE_MAPPING;
+            m_base_bytes        = bytes;
+            m_base              = map_file(m_policy.filename, m_base_bytes, m_file, m_mapping);
+            m_data              = m_base;
+            m_policy.huge_pages = false;
+            m_policy.numa_node  = storage_policy_t::ANY_NODE;
+            break;
+        }
+    }
+
+    m_alloc_time = omp_get_wtime() - t0;
+}
+
+local_storage_t::~local_storage_t()
+{
+    if (m_source == MALLOC)
+        std::free(m_base);
+    else if (m_source != VECTOR)
+        unmap(m_base, m_base_bytes, m_source == FILE_MAPPING, m_file, m_mapping);
+}
+
+void* local_storage_t::data()
+{
+    return m_data;
+}
+
+const void* local_storage_t::data() const
+{
+    return m_data;
+}
+
+size_t local_storage_t::bytes() const
+{
+    return m_bytes;
+}
+
+const storage_policy_t& local_storage_t::policy() const
+{
+    return m_policy;
+}
+
+double local_storage_t::allocation_time() const
+{
+    return m_alloc_time;
+}
+
+int local_storage_t::placement() const
+{
+    return m_bytes ? query_node(m_data) : -1;
+}
+
+bool local_storage_t::flush()
+{
+    if (m_source != FILE_MAPPING)
+        return true;
+    return flush_file(m_base, m_base_bytes, m_file);
+}
+
+size_t local_storage_t::available_memory()
+{
+    return free_physical_memory();
+}
@@ -0,0 +1,174 @@
+// -*- mode: c++ -*-
+#ifndef _LOCAL_STORAGE_H_
+#define _LOCAL_STORAGE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// <summary>
+///   Describes how the memory backing the local part of a distributed
+///   matrix is obtained.
+/// </summary>
+struct storage_policy_t
+{
+    enum kind_t
+    {
+        /// The panel is zero-initialised heap memory (DEFAULT).
+        HEAP,
+        /// The panel is anonymous virtual memory that is neither touched
+        /// nor copied at allocation time. Huge pages are used when
+        /// available and requested.
+        ANONYMOUS,
+        /// The panel is a shared mapping of a file, so that it can be
+        /// larger than physical memory and can be written back with flush().
+        MAPPED_FILE
+    };
+
+    enum
+    {
+        /// Leave page placement to the operating system (DEFAULT).
+        ANY_NODE     = -1,
+        /// Bind to the NUMA node of the processor the calling thread
+        /// is running on when the storage is allocated.
+        CURRENT_NODE = -2
+    };
+
+    kind_t      kind;
+    bool        huge_pages;
+    std::string filename;
+
+    /// The alignment in bytes of the first element, which must be a power
+    /// of two. Zero keeps the natural alignment of the allocator. Typical
+    /// values are 64 (a cache line) and 2 MB (a huge page).
+    size_t      alignment;
+
+    /// The NUMA node to bind the pages to, a node number, ANY_NODE or
+    /// CURRENT_NODE. Ignored for MAPPED_FILE storage.
+    int         numa_node;
+
+    /// Whether the pages are touched by the OpenMP worker threads right
+    /// after allocation, so that first-touch placement puts them next to
+    /// the threads that later run the threaded BLAS.
+    bool        first_touch;
+
+    storage_policy_t() : kind(HEAP), huge_pages(false), alignment(0), numa_node(ANY_NODE), first_touch(false) {}
+
+    /// <summary>
+    ///   Returns a policy for a zero-initialised heap allocation.
+    /// </summary>
+    static storage_policy_t heap();
+
+    /// <summary>
+    ///   Returns a policy for uninitialised anonymous memory, optionally
+    ///   backed by huge pages.
+    /// </summary>
+    static storage_policy_t anonymous(bool huge_pages = true);
+
+    /// <summary>
+    ///   Returns a policy for a file-backed mapping. The file is created
+    ///   if needed; existing contents are preserved.
+    /// </summary>
+    static storage_policy_t mapped_file(const std::string& filename);
+
+    /// <summary>
+    ///   Returns a heap policy with the given alignment, NUMA binding and
+    ///   first-touch behaviour.
+    /// </summary>
+    static storage_policy_t aligned(size_t alignment, int numa_node = ANY_NODE, bool first_touch = true);
+
+    /// <summary>
+    ///   Returns the process-wide default policy, which is used by matrices
+    ///   that are not given an explicit policy.
+    /// </summary>
+    static const storage_policy_t& default_policy();
+
+    /// <summary>
+    ///   Sets the process-wide default policy.
+    /// </summary>
+    static void set_default_policy(const storage_policy_t& policy);
+};
+
+/// <summary>
+///   A class that owns the memory backing the local part of a
+///   distributed matrix, allocated according to a storage_policy_t.
+/// </summary>
+class local_storage_t
+{
+public:
+    /// <summary>
+    ///   Allocates the given number of bytes according to the policy. The
+    ///   storage is aligned to at least sizeof(double), which suits every
+    ///   element type of a distributed matrix.
+    /// </summary>
+    /// <remark>
+    ///   For MAPPED_FILE, the file named by the policy is grown to hold
+    ///   that many bytes but never shrunk, so a checkpoint written by a
+    ///   previous run can be mapped back in place.
+    /// </remark>
+    local_storage_t(size_t bytes, const storage_policy_t& policy);
+
+    /// <summary>
+    ///   Returns the first byte of the storage.
+    /// </summary>
+    void* data();
+    const void* data() const;
+
+    /// <summary>
+    ///   Returns the size of the storage in bytes.
+    /// </summary>
+    size_t bytes() const;
+
+    /// <summary>
+    ///   Returns the policy used to allocate the storage. The huge_pages
+    ///   flag reflects whether huge pages were actually obtained and
+    ///   numa_node is the node that was requested from the system.
+    /// </summary>
+    const storage_policy_t& policy() const;
+
+    /// <summary>
+    ///   Returns the wall clock time in seconds spent allocating, binding
+    ///   and touching the storage.
+    /// </summary>
+    double allocation_time() const;
+
+    /// <summary>
+    ///   Returns the NUMA node on which the first page of the storage
+    ///   currently resides, or -1 if it is unknown.
+    /// </summary>
+    int placement() const;
+
+    /// <summary>
+    ///   Writes modified pages of a MAPPED_FILE storage back to the file
+    ///   and returns true on success. This is a no-op for other kinds.
+    /// </summary>
+    bool flush();
+
+    /// <summary>
+    ///   Returns the physical memory in bytes that is currently free on the
+    ///   node, which every process on the node shares.
+    /// </summary>
+    static size_t available_memory();
+
+    ~local_storage_t();
+
+private:
+    enum source_t {VECTOR, MALLOC, MAPPING, FILE_MAPPING};
+
+    std::vector<double> m_heap;
+    void*               m_data;
+    size_t              m_bytes;
+    void*               m_base;
+    size_t              m_base_bytes;
+    source_t            m_source;
+    storage_policy_t    m_policy;
+    double              m_alloc_time;
+    void*               m_file;
+    void*               m_mapping;
+
+    // Mark this class as non-copyable
+    local_storage_t(const local_storage_t&);
+    const local_storage_t& operator=(const local_storage_t&);
+};
+
+#endif // _LOCAL_STORAGE_H_
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "block_cyclic_mat.h"
+#include "factorization.h"
+#include "mixed_precision.h"
+#include "scalapack_api.h"
+#include "scalapack.h"
+#include "scalapack_traits.h"
+
+void residual(block_cyclic_mat_t& a, block_cyclic_mat_t& b, block_cyclic_mat_t& x, block_cyclic_mat_t& r)
+{
+    std::copy_n(b.local_data(), b.local_size(), r.local_data());
+
+    char nein = 'N';
+    double alpha = -1.0, beta = 1.0;
+    blas_idx_t ia = 1, ja = 1;
+    blas_idx_t n = a.global_rows(), nrhs = b.global_cols();
+    scalapack_traits<double>::gemm(nein, nein, n, nrhs, n, 
+        alpha, 
+        a.local_data(), ia, ja, a.descriptor(), 
+        x.local_data(), ia, ja, x.descriptor(), 
+        beta, 
+        r.local_data(), ia, ja, r.descriptor());
+    r.mark_modified();
+}
+
+refinement_result_t mixed_precision_solve(std::shared_ptr<block_cyclic_mat_t> a, 
+    std::shared_ptr<block_cyclic_mat_t> b, 
+    std::shared_ptr<block_cyclic_mat_t> x, 
+    blas_idx_t max_iterations /*= 30*/)
+{
+    assert(b->local_size() == x->local_size());
+
+    refinement_result_t result = {0, 0, 0.0, false};
+
+    blas_idx_t n    = a->global_rows();
+    blas_idx_t nrhs = b->global_cols();
+    blas_idx_t ia = 1, ja = 1;
+    char nein = 'N';
+
+    auto r = std::make_shared<block_cyclic_mat_t>(b->grid(), n, nrhs, b->row_block_size(), b->col_block_size());
+
+    double norm_a   = lange(*a, 'I');
+    double norm_a1  = lange(*a, '1');
+    double eps      = std::numeric_limits<double>::epsilon() * 0.5;
+    double tol      = sqrt(double(n)) * norm_a * eps;
+    bool   converged = false;
+
+    // Factorize A in single precision
+    block_cyclic_float_mat_t as(*a);
+    std::vector<blas_idx_t> ipiv(a->local_rows() + a->row_block_size());
+    scalapack_traits<float>::getrf(n, n, as.local_data(), ia, ja, as.descriptor(), ipiv.data(), result.info);
+
+    if (result.info == 0)
+    {
+        // Initial solution X = A^{-1} B in single precision
+        block_cyclic_float_mat_t xs(*b);
+        scalapack_traits<float>::getrs(nein, n, nrhs, 
+            as.local_data(), ia, ja, as.descriptor(), 
+            ipiv.data(), 
+            xs.local_data(), ia, ja, xs.descriptor(), 
+            result.info);
+        xs.copy_to(*x);
+
+        double norm_r_prev = std::numeric_limits<double>::max();
+        while (result.info == 0)
+        {
+            residual(*a, *b, *x, *r);
+            double norm_r = lange(*r, 'I');
+            double norm_x = lange(*x, 'I');
+
+            if (norm_r <= norm_x * tol)
+            {
+                converged = true;
+                break;
+            }
+
+            // Refinement has stalled if the residual no longer decreases
+            if (norm_r >= norm_r_prev || result.iterations == max_iterations)
+                break;
+            norm_r_prev = norm_r;
+
+            // Solve for the correction in single precision and apply it
+            xs.assign(*r);
+            scalapack_traits<float>::getrs(nein, n, nrhs, 
+                as.local_data(), ia, ja, as.descriptor(), 
+                ipiv.data(), 
+                xs.local_data(), ia, ja, xs.descriptor(), 
+                result.info);
+            xs.add_to(*x);
+            result.iterations ++;
+        }
+    }
+
+    if (!converged)
+    {
+        std::copy_n(b->local_data(), b->local_size(), x->local_data());
+        x->mark_modified();
+        factorization_t lu(a, factorization_t::LU);
+        result.info      = lu.solve(x);
+        result.fell_back = true;
+    }
+
+    residual(*a, *b, *x, *r);
+    result.error = lange(*r, 'I') / n / norm_a1;
+    return result;
+}
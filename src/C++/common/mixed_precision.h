@@ -0,0 +1,64 @@
+// -*- mode: c++ -*-
+#ifndef _MIXED_PRECISION_H_
+#define _MIXED_PRECISION_H_
+
+#include <memory>
+#include "block_cyclic_mat.h"
+
+/// <summary>
+///   The outcome of a mixed precision solve.
+/// </summary>
+struct refinement_result_t
+{
+    /// The INFO value of the last ScaLAPACK factorization or solve.
+    blas_idx_t info;
+
+    /// The number of refinement steps taken in single precision.
+    blas_idx_t iterations;
+
+    /// The backward error ||B - AX||_oo / (N x ||A||_1) of the solution.
+    double     error;
+
+    /// Whether the solution was obtained by falling back to a double 
+    /// precision factorization because refinement stalled.
+    bool       fell_back;
+};
+
+/// <summary>
+///   Computes the residual R = B - AX of the N x N matrix A with PDGEMM.
+///   R must have the same distribution as B.
+/// </summary>
+void residual(block_cyclic_mat_t& a, block_cyclic_mat_t& b, block_cyclic_mat_t& x, block_cyclic_mat_t& r);
+
+/// <summary>
+///   Solves AX = B by factorizing A in single precision with PSGETRF and 
+///   refining the solution with double precision residuals.
+/// </summary>
+/// <param name="a">
+///   The N x N matrix A, which is left intact.
+/// </param>
+/// <param name="b">
+///   The N x NRHS right-hand sides B, which are left intact.
+/// </param>
+/// <param name="x">
+///   On return, the N x NRHS solution X. It must have the same 
+///   distribution as b.
+/// </param>
+/// <param name="max_iterations">
+///   The number of refinement steps after which refinement is considered
+///   to have stalled, defaults to 30.
+/// </param>
+/// <remark>
+///   Each step computes R = B - AX with PDGEMM, solves for the correction
+///   with PSGETRS and adds it to X. Refinement stops once 
+///   ||R||_oo <= sqrt(N) x ||X||_oo x ||A||_oo x eps, the criterion used by 
+///   DSGESV in LAPACK. If the single precision factorization fails, the
+///   residual stops decreasing or max_iterations is reached, the system 
+///   is solved again with a double precision LU factorization.
+/// </remark>
+refinement_result_t mixed_precision_solve(std::shared_ptr<block_cyclic_mat_t> a, 
+    std::shared_ptr<block_cyclic_mat_t> b, 
+    std::shared_ptr<block_cyclic_mat_t> x, 
+    blas_idx_t max_iterations = 30);
+
+#endif // _MIXED_PRECISION_H_
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <sstream>
+
+#include "out_of_core.h"
+#include "scalapack.h"
+#include "scalapack_api.h"
+#include "trace.h"
+#include "tuning.h"
+
+double ooc_stats_t::overlap() const
+{
+    if (write_rate <= 0.0)
+        return 0.0;
+    double io = (bytes_read + bytes_written) / write_rate;
+    return io > 0.0 ? std::max(0.0, 1.0 - io_wait / io) : 0.0;
+}
+
+// Solves op(A) X = B for X, overwriting B, with PxTRSM
+static void trsm(char side, char uplo, char transa, char diag, block_cyclic_view_t a, block_cyclic_view_t b)
+{
+    blas_idx_t m = b.m(), n = b.n();
+    blas_idx_t ia = a.ia(), ja = a.ja(), ib = b.ia(), jb = b.ja();
+    double one = 1.0;
+    trace_scope_t scope("pdtrsm");
+    pdtrsm_(side, uplo, transa, diag, m, n, one, a.data(), ia, ja, a.descriptor(), b.data(), ib, jb, b.descriptor());
+    b.matrix().mark_modified();
+}
+
+// Applies the row interchanges of rows k1 to k2 recorded by PxGETRF in
+// ipiv to the columns of the view, with PxLASWP
+static void laswp(block_cyclic_view_t a, blas_idx_t k1, blas_idx_t k2, std::vector<blas_idx_t>& ipiv)
+{
+    char direc = 'F', rowcol = 'R';
+    blas_idx_t n = a.n(), ia = a.ia(), ja = a.ja();
+    trace_scope_t scope("pdlaswp");
+    pdlaswp_(direc, rowcol, n, a.data(), ia, ja, a.descriptor(), k1, k2, ipiv.data());
+    a.matrix().mark_modified();
+}
+
+ooc_matrix_t::ooc_matrix_t(std::shared_ptr<blacs_grid_t> grid, blas_idx_t n, blas_idx_t panel_cols,
+    const std::string& path, blas_idx_t block_size /*= 0*/)
+    : m_grid(grid), m_n(n), m_file(MPI_FILE_NULL), m_valid(false)
+{
+    if (block_size <= 0)
+    {
+        const tuning_config_t* tuned = tuner_t::active();
+        block_size = tuned ? tuned->nb : block_cyclic_mat_t::default_block_size();
+    }
+    m_block_size = block_size;
+    m_panel_cols = panel_cols > 0 ? std::max(block_size, panel_cols / block_size * block_size) : 8 * block_size;
+    m_local_size = grid->local_rows(n, block_size, 0) * grid->local_cols(m_panel_cols, block_size, 0);
+
+    std::ostringstream filename;
+    filename << path << "." << grid->iam();
+    int rc = MPI_File_open(MPI_COMM_SELF, const_cast<char*>(filename.str().c_str()),
+        MPI_MODE_CREATE | MPI_MODE_RDWR | MPI_MODE_DELETE_ON_CLOSE, MPI_INFO_NULL, &m_file);
+
+    int ok = rc == MPI_SUCCESS ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, grid->comm());
+    m_valid = ok == 1;
+}
+
+ooc_matrix_t::~ooc_matrix_t()
+{
+    if (m_file != MPI_FILE_NULL)
+        MPI_File_close(&m_file);
+}
+
+bool ooc_matrix_t::valid() const
+{
+    return m_valid;
+}
+
+blas_idx_t ooc_matrix_t::n() const
+{
+    return m_n;
+}
+
+blas_idx_t ooc_matrix_t::panel_cols() const
+{
+    return m_panel_cols;
+}
+
+blas_idx_t ooc_matrix_t::block_size() const
+{
+    return m_block_size;
+}
+
+blas_idx_t ooc_matrix_t::panels() const
+{
+    return (m_n + m_panel_cols - 1) / m_panel_cols;
+}
+
+blas_idx_t ooc_matrix_t::cols(blas_idx_t p) const
+{
+    return std::min(m_panel_cols, m_n - p * m_panel_cols);
+}
+
+std::shared_ptr<blacs_grid_t> ooc_matrix_t::grid()
+{
+    return m_grid;
+}
+
+std::shared_ptr<block_cyclic_mat_t> ooc_matrix_t::make_panel()
+{
+    return std::make_shared<block_cyclic_mat_t>(m_grid, m_n, m_panel_cols, m_block_size, m_block_size);
+}
+
+MPI_Request ooc_matrix_t::begin_read(blas_idx_t p, block_cyclic_mat_t& panel)
+{
+    assert(m_valid && panel.local_size() == m_local_size);
+    MPI_Offset  offset  = MPI_Offset(p) * m_local_size * sizeof(double);
+    MPI_Request request = MPI_REQUEST_NULL;
+
+    // A library without background I/O does the transfer here
+    double t0 = MPI_Wtime();
+    MPI_File_iread_at(m_file, offset, panel.local_data(), int(m_local_size), MPI_DOUBLE, &request);
+    m_stats.io_wait    += MPI_Wtime() - t0;
+    m_stats.bytes_read += double(m_local_size) * sizeof(double);
+    panel.mark_modified();
+    return request;
+}
+
+MPI_Request ooc_matrix_t::begin_write(blas_idx_t p, block_cyclic_mat_t& panel)
+{
+    assert(m_valid && panel.local_size() == m_local_size);
+    MPI_Offset  offset  = MPI_Offset(p) * m_local_size * sizeof(double);
+    MPI_Request request = MPI_REQUEST_NULL;
+
+    double t0 = MPI_Wtime();
+    MPI_File_iwrite_at(m_file, offset, panel.local_data(), int(m_local_size), MPI_DOUBLE, &request);
+    m_stats.io_wait       += MPI_Wtime() - t0;
+    m_stats.bytes_written += double(m_local_size) * sizeof(double);
+    return request;
+}
+
+void ooc_matrix_t::wait(MPI_Request& request)
+{
+    if (request == MPI_REQUEST_NULL)
+        return;
+
+    double t0 = MPI_Wtime();
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    m_stats.io_wait += MPI_Wtime() - t0;
+}
+
+ooc_stats_t& ooc_matrix_t::stats()
+{
+    return m_stats;
+}
+
+ooc_factorization_t::ooc_factorization_t(std::shared_ptr<ooc_matrix_t> a, kind_t kind /*= LU*/)
+    : m_a(a), m_kind(kind), m_factored(false)
+{
+    for (int i = 0; i < 2; i ++)
+    {
+        m_current[i] = a->make_panel();
+        m_stream[i]  = a->make_panel();
+        m_write[i]   = MPI_REQUEST_NULL;
+        m_written[i] = -1;
+    }
+}
+
+// Reading a panel while it is still being written is undefined, so the
+// write is finished first
+MPI_Request ooc_factorization_t::begin_read(blas_idx_t p, block_cyclic_mat_t& panel)
+{
+    for (int i = 0; i < 2; i ++)
+    {
+        if (m_written[i] == p)
+        {
+            m_a->wait(m_write[i]);
+            m_written[i] = -1;
+        }
+    }
+    return m_a->begin_read(p, panel);
+}
+
+// Reads the given panels into the two stream buffers in turn, one panel
+// ahead, and calls update on each of them
+void ooc_factorization_t::stream(const std::vector<blas_idx_t>& order,
+    const std::function<void (blas_idx_t, block_cyclic_mat_t&)>& update)
+{
+    if (order.empty())
+        return;
+
+    MPI_Request pending[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    pending[0] = begin_read(order[0], *m_stream[0]);
+    for (size_t i = 0; i < order.size(); i ++)
+    {
+        if (i + 1 < order.size())
+            pending[(i + 1) % 2] = begin_read(order[i + 1], *m_stream[(i + 1) % 2]);
+        m_a->wait(pending[i % 2]);
+
+        double t0 = MPI_Wtime();
+        update(order[i], *m_stream[i % 2]);
+        m_a->stats().compute += MPI_Wtime() - t0;
+    }
+}
+
+// Applies the factored panel j, held in l, to panel k, held in a
+void ooc_factorization_t::update(blas_idx_t k, block_cyclic_mat_t& a, blas_idx_t j, block_cyclic_mat_t& l)
+{
+    blas_idx_t n  = m_a->n();
+    blas_idx_t k0 = k * m_a->panel_cols(), wk = m_a->cols(k);
+    blas_idx_t j0 = j * m_a->panel_cols(), wj = m_a->cols(j);
+    block_cyclic_view_t av(a), lv(l);
+
+    if (m_kind == CHOLESKY)
+    {
+        // A(k0:, k) -= L(k0:, j) L(k0:k0 + wk, j)^T
+        block_cyclic_view_t lk = lv.submatrix(k0 + 1, 1, n - k0, wj);
+        gemm(lk, lk.row_slice(1, wk).transpose(), av.submatrix(k0 + 1, 1, n - k0, wk), -1.0, 1.0);
+        return;
+    }
+
+    // Bring the rows of panel k into the order panel j was factorized in,
+    // then compute its block of U and update the rows below
+    blas_idx_t rest = n - j0 - wj;
+    laswp(av.col_slice(1, wk), j0 + 1, j0 + wj, m_ipiv[j]);
+    trsm('L', 'L', 'N', 'U', lv.submatrix(j0 + 1, 1, wj, wj), av.submatrix(j0 + 1, 1, wj, wk));
+    if (rest > 0)
+    {
+        gemm(lv.submatrix(j0 + wj + 1, 1, rest, wj), av.submatrix(j0 + 1, 1, wj, wk),
+            av.submatrix(j0 + wj + 1, 1, rest, wk), -1.0, 1.0);
+    }
+}
+
+// Factorizes the updated panel k in memory and returns INFO for the whole
+// matrix
+blas_idx_t ooc_factorization_t::factor_panel(blas_idx_t k, block_cyclic_mat_t& a)
+{
+    blas_idx_t n  = m_a->n();
+    blas_idx_t k0 = k * m_a->panel_cols(), wk = m_a->cols(k);
+    blas_idx_t rest = n - k0 - wk, info = 0;
+    block_cyclic_view_t av(a);
+
+    if (m_kind == LU)
+    {
+        m_ipiv[k] = getrf(av.submatrix(k0 + 1, 1, n - k0, wk), info);
+        return info > 0 ? k0 + info : info;
+    }
+
+    info = potrf(av.submatrix(k0 + 1, 1, wk, wk), 'L');
+    if (info != 0)
+        return info > 0 ? k0 + info : info;
+    if (rest > 0)
+        trsm('R', 'L', 'T', 'N', av.submatrix(k0 + 1, 1, wk, wk), av.submatrix(k0 + wk + 1, 1, rest, wk));
+    return 0;
+}
+
+blas_idx_t ooc_factorization_t::factor()
+{
+    blas_idx_t np = m_a->panels(), info = 0;
+    m_ipiv.assign(m_kind == LU ? np : 0, std::vector<blas_idx_t>());
+
+    MPI_Request next = begin_read(0, *m_current[0]);
+    for (blas_idx_t k = 0; k < np; k ++)
+    {
+        block_cyclic_mat_t& a = *m_current[k % 2];
+        m_a->wait(next);
+
+        std::vector<blas_idx_t> order(k);
+        std::iota(order.begin(), order.end(), blas_idx_t(0));
+        stream(order, [&](blas_idx_t j, block_cyclic_mat_t& l) {
+            update(k, a, j, l);
+        });
+
+        // Fetch the next panel while this one is factorized, once the
+        // buffer it goes to has been written out
+        if (k + 1 < np)
+        {
+            int other = int((k + 1) % 2);
+            m_a->wait(m_write[other]);
+            m_written[other] = -1;
+            next = begin_read(k + 1, *m_current[other]);
+        }
+
+        double t0 = MPI_Wtime();
+        blas_idx_t panel_info = factor_panel(k, a);
+        m_a->stats().compute += MPI_Wtime() - t0;
+        if (info == 0)
+            info = panel_info;
+
+        m_write[k % 2]   = m_a->begin_write(k, a);
+        m_written[k % 2] = k;
+
+        // A matrix that is not positive definite cannot be factorized
+        // any further
+        if (m_kind == CHOLESKY && info != 0)
+            break;
+    }
+
+    m_a->wait(next);
+    for (int i = 0; i < 2; i ++)
+    {
+        m_a->wait(m_write[i]);
+        m_written[i] = -1;
+    }
+    m_factored = info == 0;
+    return info;
+}
+
+blas_idx_t ooc_factorization_t::solve(std::shared_ptr<block_cyclic_mat_t> b)
+{
+    if (!m_factored)
+        return -1;
+    assert(b->global_rows() == m_a->n() && b->row_block_size() == m_a->block_size());
+
+    blas_idx_t n = m_a->n(), w = m_a->panel_cols();
+    block_cyclic_view_t bv(*b);
+    std::vector<blas_idx_t> order(m_a->panels());
+    std::iota(order.begin(), order.end(), blas_idx_t(0));
+
+    // Forward substitution with L, applying the row interchanges of each
+    // panel before it is used, as they were made during the factorization
+    stream(order, [&](blas_idx_t j, block_cyclic_mat_t& l) {
+        blas_idx_t j0 = j * w, wj = m_a->cols(j), rest = n - j0 - wj;
+        block_cyclic_view_t lv(l);
+        if (m_kind == LU)
+            laswp(bv, j0 + 1, j0 + wj, m_ipiv[j]);
+        trsm('L', 'L', 'N', m_kind == LU ? 'U' : 'N', lv.submatrix(j0 + 1, 1, wj, wj), bv.row_slice(j0 + 1, wj));
+        if (rest > 0)
+            gemm(lv.submatrix(j0 + wj + 1, 1, rest, wj), bv.row_slice(j0 + 1, wj), bv.row_slice(j0 + wj + 1, rest), -1.0, 1.0);
+    });
+
+    // Back substitution with U, or with L^T for Cholesky, from the last
+    // panel to the first
+    std::reverse(order.begin(), order.end());
+    stream(order, [&](blas_idx_t j, block_cyclic_mat_t& l) {
+        blas_idx_t j0 = j * w, wj = m_a->cols(j), rest = n - j0 - wj;
+        block_cyclic_view_t lv(l);
+        if (m_kind == LU)
+        {
+            trsm('L', 'U', 'N', 'N', lv.submatrix(j0 + 1, 1, wj, wj), bv.row_slice(j0 + 1, wj));
+            if (j0 > 0)
+                gemm(lv.submatrix(1, 1, j0, wj), bv.row_slice(j0 + 1, wj), bv.row_slice(1, j0), -1.0, 1.0);
+        }
+        else
+        {
+            if (rest > 0)
+                gemm(lv.submatrix(j0 + wj + 1, 1, rest, wj).transpose(), bv.row_slice(j0 + wj + 1, rest), bv.row_slice(j0 + 1, wj), -1.0, 1.0);
+            trsm('L', 'L', 'T', 'N', lv.submatrix(j0 + 1, 1, wj, wj), bv.row_slice(j0 + 1, wj));
+        }
+    });
+
+    b->mark_modified();
+    return 0;
+}
+
+ooc_factorization_t::kind_t ooc_factorization_t::kind() const
+{
+    return m_kind;
+}
@@ -0,0 +1,288 @@
+// -*- mode: c++ -*-
+#ifndef _OUT_OF_CORE_H_
+#define _OUT_OF_CORE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "block_cyclic_mat.h"
+#include "generators.h"
+
+/// <summary>
+///   The I/O and compute totals of an out-of-core matrix on the calling
+///   process.
+/// </summary>
+struct ooc_stats_t
+{
+    double bytes_read;
+    double bytes_written;
+
+    /// <summary>
+    ///   The seconds spent blocked in I/O calls, which is the I/O time that
+    ///   was not hidden behind computation.
+    /// </summary>
+    double io_wait;
+
+    /// <summary>
+    ///   The seconds spent in ScaLAPACK calls.
+    /// </summary>
+    double compute;
+
+    /// <summary>
+    ///   The rate in bytes per second of the synchronous writes made by
+    ///   generate(), or zero before the matrix is generated.
+    /// </summary>
+    double write_rate;
+
+    ooc_stats_t() : bytes_read(0.0), bytes_written(0.0), io_wait(0.0), compute(0.0), write_rate(0.0) {}
+
+    /// <summary>
+    ///   Returns the fraction of the I/O time that overlapped with
+    ///   computation, from 0 to 1. The I/O time is modelled as the bytes
+    ///   moved at the write rate measured by generate(), since the time an
+    ///   asynchronous request spends in flight cannot be observed.
+    /// </summary>
+    double overlap() const;
+};
+
+/// <summary>
+///   A square double precision matrix too large for the aggregate memory
+///   of the grid, which lives on node-local disk as a sequence of column
+///   panels.
+/// </summary>
+/// <remark>
+///   Panel p holds columns p * W to (p + 1) * W - 1 of the matrix, where W
+///   is the panel width, and is distributed over the grid as an N x W
+///   block-cyclic matrix whose first column is on process column 0. Each
+///   process keeps the local parts of its panels one after the other in
+///   its own file, PATH.RANK, which is deleted when the matrix is
+///   destroyed. Only the panels held in buffers made by make_panel() are
+///   ever in memory.
+///
+///   Panels are read and written with nonblocking MPI-IO on MPI_COMM_SELF,
+///   so that a process can compute on one panel while the next one is
+///   being transferred. Whether the transfer really proceeds in the
+///   background depends on the MPI library; ooc_stats_t::overlap reports
+///   how much of it did.
+/// </remark>
+class ooc_matrix_t
+{
+public:
+    /// <summary>
+    ///   Creates the files of an N x N matrix. Every process in the grid
+    ///   must call this constructor.
+    /// </summary>
+    /// <param name="panel_cols">
+    ///   The panel width W, which is rounded down to a multiple of the
+    ///   block size, or zero for eight blocks. A buffer holds N / NPROW x W / NPCOL elements per
+    ///   process, and factorizations keep four of them in memory.
+    /// </param>
+    /// <param name="path">
+    ///   The prefix of the file of each process, such as a directory on a
+    ///   node-local disk followed by a file name.
+    /// </param>
+    /// <param name="block_size">
+    ///   The square block size, or zero for the tuned or default block size.
+    /// </param>
+    ooc_matrix_t(std::shared_ptr<blacs_grid_t> grid, blas_idx_t n, blas_idx_t panel_cols,
+        const std::string& path, blas_idx_t block_size = 0);
+
+    ~ooc_matrix_t();
+
+    /// <summary>
+    ///   Returns true if the file of every process could be opened.
+    /// </summary>
+    bool valid() const;
+
+    /// <summary>
+    ///   Returns the order N of the matrix.
+    /// </summary>
+    blas_idx_t n() const;
+
+    /// <summary>
+    ///   Returns the panel width W.
+    /// </summary>
+    blas_idx_t panel_cols() const;
+
+    /// <summary>
+    ///   Returns the block size of the panels, MB_A = NB_A.
+    /// </summary>
+    blas_idx_t block_size() const;
+
+    /// <summary>
+    ///   Returns the number of panels.
+    /// </summary>
+    blas_idx_t panels() const;
+
+    /// <summary>
+    ///   Returns the number of columns of the matrix in panel p, which is
+    ///   W except for the last panel.
+    /// </summary>
+    blas_idx_t cols(blas_idx_t p) const;
+
+    /// <summary>
+    ///   Returns the grid the panels are distributed on.
+    /// </summary>
+    std::shared_ptr<blacs_grid_t> grid();
+
+    /// <summary>
+    ///   Returns a new N x W buffer with the distribution of a panel.
+    /// </summary>
+    std::shared_ptr<block_cyclic_mat_t> make_panel();
+
+    /// <summary>
+    ///   Sets every element A(i, j) of the matrix to f(i, j), where i and j
+    ///   are the global row and column from 0, panel by panel through a
+    ///   single buffer. f is called concurrently from several threads. The
+    ///   writes are synchronous and their rate is recorded in the stats,
+    ///   whose other counters are reset afterwards so that they only
+    ///   cover the factorization and solves that follow.
+    /// </summary>
+    template <typename F>
+    void generate(F f)
+    {
+        auto panel = make_panel();
+        double bytes = 0.0, t = 0.0;
+        for (blas_idx_t p = 0; p < panels(); p ++)
+        {
+            blas_idx_t j0 = p * m_panel_cols, n = m_n;
+            ::generate(*panel, [&](blas_idx_t i, blas_idx_t j) {
+                return j0 + j < n ? f(i, j0 + j) : 0.0;
+            });
+
+            double t0 = MPI_Wtime();
+            MPI_Request request = begin_write(p, *panel);
+            wait(request);
+            t += MPI_Wtime() - t0;
+            bytes += double(panel->local_size()) * sizeof(double);
+        }
+        m_stats = ooc_stats_t();
+        m_stats.write_rate = t > 0.0 ? bytes / t : 0.0;
+    }
+
+    /// <summary>
+    ///   Starts reading panel p into a buffer made by make_panel() and
+    ///   returns the request to pass to wait().
+    /// </summary>
+    MPI_Request begin_read(blas_idx_t p, block_cyclic_mat_t& panel);
+
+    /// <summary>
+    ///   Starts writing a buffer to panel p and returns the request to pass
+    ///   to wait(). The buffer must not be changed until the write is done.
+    /// </summary>
+    MPI_Request begin_write(blas_idx_t p, block_cyclic_mat_t& panel);
+
+    /// <summary>
+    ///   Waits for a request to complete and adds the time spent waiting
+    ///   to the stats. Waiting on MPI_REQUEST_NULL returns immediately.
+    /// </summary>
+    void wait(MPI_Request& request);
+
+    /// <summary>
+    ///   Returns the I/O and compute totals of the calling process.
+    /// </summary>
+    ooc_stats_t& stats();
+
+private:
+    std::shared_ptr<blacs_grid_t> m_grid;
+    blas_idx_t                    m_n;
+    blas_idx_t                    m_panel_cols;
+    blas_idx_t                    m_block_size;
+    blas_idx_t                    m_local_size;
+    MPI_File                      m_file;
+    bool                          m_valid;
+    ooc_stats_t                   m_stats;
+
+    // Mark this class as non-copyable
+    ooc_matrix_t(const ooc_matrix_t&);
+    const ooc_matrix_t& operator=(const ooc_matrix_t&);
+};
+
+/// <summary>
+///   LU and Cholesky factorizations of an out-of-core matrix, and the
+///   solution of systems with them.
+/// </summary>
+/// <remark>
+///   The factorizations are left-looking, as in the out-of-core ScaLAPACK
+///   of D'Azevedo and Dongarra. For each panel in turn, the panel is read,
+///   updated with every panel to its left as they are streamed from disk,
+///   factorized in memory with PxPOTRF or PxGETRF and written back in
+///   place of the matrix. Reads are issued one panel ahead, so the next
+///   panel arrives while the current one is being updated, and a panel is
+///   written while the next one is processed. Four buffers are kept: two
+///   for the current and next panel and two for the stream. Panel k
+///   reads the k panels to its left, so the matrix is read about N / 2W
+///   times in total and wider panels mean less I/O.
+///
+///   The LU factorization uses partial pivoting, choosing each pivot
+///   from all the rows below the diagonal. The row interchanges of a panel are not applied to the
+///   panels to its left, which would mean rewriting them. Instead, solve()
+///   interleaves them with the forward substitution in the order they
+///   were made. The pivots are kept in memory.
+///
+///   The block size must be square, and the right-hand sides of solve()
+///   must fit in memory.
+/// </remark>
+class ooc_factorization_t
+{
+public:
+    /// <summary>
+    ///   The kind of factorization.
+    ///     LU: PA = LU with partial pivoting (DEFAULT).
+    ///     CHOLESKY: A = L L^T for symmetric positive definite matrices,
+    ///         which only reads the lower triangle.
+    /// </summary>
+    enum kind_t {LU, CHOLESKY};
+
+    /// <summary>
+    ///   Creates a factorization of the matrix and allocates its buffers.
+    ///   No work is done until factor() is called.
+    /// </summary>
+    ooc_factorization_t(std::shared_ptr<ooc_matrix_t> a, kind_t kind = LU);
+
+    /// <summary>
+    ///   Overwrites the matrix with its factors and returns INFO as
+    ///   ScaLAPACK would for the whole matrix, which is zero on success.
+    ///   Every process in the grid must call this method.
+    /// </summary>
+    blas_idx_t factor();
+
+    /// <summary>
+    ///   Overwrites b with the solution of AX = B, streaming the factors
+    ///   from disk twice. Returns -1 if the matrix is not factorized.
+    /// </summary>
+    /// <param name="b">
+    ///   The right-hand sides, which must have N rows and be distributed on
+    ///   the same grid with the block size of the matrix.
+    /// </param>
+    blas_idx_t solve(std::shared_ptr<block_cyclic_mat_t> b);
+
+    /// <summary>
+    ///   Returns the kind of factorization.
+    /// </summary>
+    kind_t kind() const;
+
+private:
+    std::shared_ptr<ooc_matrix_t>        m_a;
+    kind_t                               m_kind;
+    bool                                 m_factored;
+    std::vector<std::vector<blas_idx_t> > m_ipiv;
+    std::shared_ptr<block_cyclic_mat_t>  m_current[2];
+    std::shared_ptr<block_cyclic_mat_t>  m_stream[2];
+    MPI_Request                          m_write[2];
+    blas_idx_t                           m_written[2];
+
+    MPI_Request begin_read(blas_idx_t p, block_cyclic_mat_t& panel);
+    void stream(const std::vector<blas_idx_t>& order,
+        const std::function<void (blas_idx_t, block_cyclic_mat_t&)>& update);
+    void update(blas_idx_t k, block_cyclic_mat_t& a, blas_idx_t j, block_cyclic_mat_t& l);
+    blas_idx_t factor_panel(blas_idx_t k, block_cyclic_mat_t& a);
+
+    // Mark this class as non-copyable
+    ooc_factorization_t(const ooc_factorization_t&);
+    const ooc_factorization_t& operator=(const ooc_factorization_t&);
+};
+
+#endif // _OUT_OF_CORE_H_
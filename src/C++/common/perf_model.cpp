@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <mpi.h>
+#include "lapack.h"
+#include "perf_model.h"
+
+// The fraction of a matrix a process receives when it is broadcast
+// across p processes, which is zero when nothing needs to be sent
+static double received(blas_idx_t p)
+{
+    return 1.0 - 1.0/double(p);
+}
+
+// The words received per process when an N x N triangle is broadcast
+// panel by panel along the process rows and row by row down the process
+// columns, as in PxGETRF and PxPOTRF
+static double panel_words(double area, blas_idx_t nprows, blas_idx_t npcols)
+{
+    return area * (received(npcols)/nprows + received(nprows)/npcols);
+}
+
+// The words received per process by a triangular solve, in which every
+// block of the solution is broadcast along its process column and the
+// updates are summed along the process rows
+static double solve_words(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    return double(n) * nrhs * (received(nprows)/npcols + received(npcols)/nprows);
+}
+
+static perf_count_t count(double flops, double words, size_t element_size = sizeof(double))
+{
+    perf_count_t c = {flops, words * element_size};
+    return c;
+}
+
+perf_count_t operator+(const perf_count_t& a, const perf_count_t& b)
+{
+    perf_count_t c = {a.flops + b.flops, a.bytes + b.bytes};
+    return c;
+}
+
+perf_count_t gemm_count(blas_idx_t m, blas_idx_t n, blas_idx_t k, blas_idx_t nprows, blas_idx_t npcols,
+    size_t element_size /*= sizeof(double)*/, bool is_complex /*= false*/)
+{
+    // Every process receives the K columns of its rows of A and the
+    // K rows of its columns of B
+    double M = m, N = n, K = k;
+    return count((is_complex ? 4.0 : 1.0) * 2.0 * M * N * K,
+        K * (M/nprows * received(npcols) + N/npcols * received(nprows)), element_size);
+}
+
+perf_count_t gemm_25d_count(blas_idx_t m, blas_idx_t n, blas_idx_t k, blas_idx_t nprocs, blas_idx_t layers,
+    size_t element_size /*= sizeof(double)*/, bool is_complex /*= false*/)
+{
+    blas_idx_t size   = nprocs / layers;
+    blas_idx_t nprows = blas_idx_t(sqrt(double(size)));
+    while (size % nprows)
+        nprows --;
+    blas_idx_t npcols = size / nprows;
+
+    // Every process receives its share of the slices of A and B, then its
+    // layer multiplies them as PxGEMM would with K / layers. The partial
+    // products are summed across the layers, each layer receiving the
+    // columns of C it owns from the others, and copied back to the grid
+    // of C.
+    double M = m, N = n, K = k, P = nprocs;
+    perf_count_t c = gemm_count(m, n, blas_idx_t(K / layers), nprows, npcols, element_size, is_complex);
+    c.flops = (is_complex ? 4.0 : 1.0) * 2.0 * M * N * K;
+    c.bytes += ((M * K + K * N) / P + (layers - 1) * M * N / P + M * N / P) * element_size;
+    return c;
+}
+
+perf_count_t getrf_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    double N = n;
+    return count(2.0/3.0 * N * N * N - 1.0/2.0 * N * N, panel_words(N * N/2.0, nprows, npcols));
+}
+
+perf_count_t getrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // One solve with L and one with U
+    double N = n;
+    return count(2.0 * nrhs * N * N, 2.0 * solve_words(n, nrhs, nprows, npcols));
+}
+
+perf_count_t gesv_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    return getrf_count(n, nprows, npcols) + getrs_count(n, nrhs, nprows, npcols);
+}
+
+perf_count_t getri_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // Inverting U and then solving for inv(A) inv(L) = inv(U) each
+    // broadcast a triangle
+    double N = n;
+    return count(4.0/3.0 * N * N * N - N * N, 2.0 * panel_words(N * N/2.0, nprows, npcols));
+}
+
+perf_count_t potrf_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // Each panel is needed along the process rows and, transposed, down
+    // the process columns
+    double N = n;
+    return count(1.0/3.0 * N * N * N + 1.0/2.0 * N * N, panel_words(N * N/2.0, nprows, npcols));
+}
+
+perf_count_t potrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    double N = n;
+    return count(2.0 * nrhs * N * N, 2.0 * solve_words(n, nrhs, nprows, npcols));
+}
+
+perf_count_t chol_update_count(blas_idx_t n, blas_idx_t k, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // Three multiply-adds per element of U and column of X, X replicated
+    // on every process and the rotations broadcast along the process rows
+    double N = n, K = k;
+    return count(3.0 * K * N * N, N * K * (1.0 + 2.0 * received(npcols)/nprows))
+        + gemm_count(n, n, k, nprows, npcols);
+}
+
+perf_count_t geqrf_count(blas_idx_t m, blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // The Householder vectors are broadcast along the process rows and
+    // the triangular factors of the block reflectors down the columns
+    double M = m, N = n;
+    return count(2.0 * M * N * N - 2.0/3.0 * N * N * N,
+        (M * N - N * N/2.0) * received(npcols)/nprows + N * N/2.0 * received(nprows)/npcols);
+}
+
+perf_count_t ormqr_count(blas_idx_t m, blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    double M = m, N = n;
+    return count(nrhs * (4.0 * M * N - 2.0 * N * N),
+        (M * N - N * N/2.0) * received(npcols)/nprows + N * nrhs * received(nprows)/npcols);
+}
+
+perf_count_t trtrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols)
+{
+    double N = n;
+    return count(nrhs * N * N, solve_words(n, nrhs, nprows, npcols));
+}
+
+perf_count_t syevd_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // The two-sided reduction needs each Householder vector along the
+    // process rows and down the process columns, PxSTEDC replicates the
+    // tridiagonal matrix and the back-transformation is PxORMQR on N
+    // columns
+    double N = n;
+    return count(4.0/3.0 * N * N * N + 4.0/3.0 * N * N * N, 2.0 * panel_words(N * N/2.0, nprows, npcols) + 2.0 * N)
+        + ormqr_count(n, n, n, nprows, npcols);
+}
+
+perf_count_t schur_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols)
+{
+    // The Hessenberg reduction and the back-transformation move data as
+    // for the symmetric problem, and every QR sweep updates T and Z
+    // along both grid dimensions once more
+    double N = n;
+    perf_count_t back = ormqr_count(n, n, n, nprows, npcols);
+    return count(25.0 * N * N * N - back.flops, 3.0 * panel_words(N * N/2.0, nprows, npcols)) + back;
+}
+
+double calibrate_peak(blas_idx_t n /*= 1024*/)
+{
+    std::vector<double> a(size_t(n) * n, 1.0), b(size_t(n) * n, 0.5), c(size_t(n) * n, 0.0);
+    char       nein  = 'N';
+    double     alpha = 1.0, beta = 0.0;
+    blas_idx_t ld    = n;
+
+    // The first product warms up the BLAS library and the caches
+    double best = 0.0;
+    for (int i = 0; i < 4; i ++)
+    {
+        double t0 = MPI_Wtime();
+        dgemm_(nein, nein, n, n, n, alpha, a.data(), ld, b.data(), ld, beta, c.data(), ld);
+        double t = MPI_Wtime() - t0;
+        if (i > 0 && t > 0.0)
+            best = std::max(best, 2.0 * double(n) * n * n / t);
+    }
+    return best;
+}
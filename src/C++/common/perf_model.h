@@ -0,0 +1,128 @@
+// -*- mode: c++ -*-
+#ifndef _PERF_MODEL_H_
+#define _PERF_MODEL_H_
+
+#include <cstddef>
+#include "index.h"
+
+/// <summary>
+///   The work of a distributed routine: the floating point operations of
+///   the whole computation and the bytes that each process receives from
+///   other processes.
+/// </summary>
+/// <remark>
+///   Operation counts are the ones used by the ScaLAPACK testers, e.g.
+///   TESTING/LIN/pdludriver.f. Byte counts follow the usual model of a
+///   right-looking algorithm on an nprows x npcols grid, in which every
+///   panel is broadcast along the process rows and every row block down
+///   the process columns. They ignore pivoting, latency and the lower
+///   order terms, so they are meant for telling communication-bound runs
+///   apart rather than for predicting times.
+/// </remark>
+struct perf_count_t
+{
+    double flops;
+    double bytes;
+};
+
+perf_count_t operator+(const perf_count_t& a, const perf_count_t& b);
+
+/// <summary>
+///   C = AB for an M x K matrix A and a K x N matrix B, with elements of
+///   the given size. A complex multiply-add takes four real multiplies
+///   and four real adds.
+/// </summary>
+perf_count_t gemm_count(blas_idx_t m, blas_idx_t n, blas_idx_t k, blas_idx_t nprows, blas_idx_t npcols,
+    size_t element_size = sizeof(double), bool is_complex = false);
+
+/// <summary>
+///   C = AB computed by gemm_25d with the given number of layers on
+///   nprocs processes, each layer being a grid of nprocs / layers
+///   processes shaped as by blacs_grid_t::split.
+/// </summary>
+perf_count_t gemm_25d_count(blas_idx_t m, blas_idx_t n, blas_idx_t k, blas_idx_t nprocs, blas_idx_t layers,
+    size_t element_size = sizeof(double), bool is_complex = false);
+
+/// <summary>
+///   The LU factorization of an N x N matrix with PxGETRF.
+/// </summary>
+perf_count_t getrf_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Solving for NRHS right-hand sides with the LU factors, with PxGETRS.
+/// </summary>
+perf_count_t getrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   PxGESV, which is PxGETRF followed by PxGETRS.
+/// </summary>
+perf_count_t gesv_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   The inverse of an N x N matrix from its LU factors with PxGETRI.
+/// </summary>
+perf_count_t getri_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   The Cholesky factorization of an N x N matrix with PxPOTRF.
+/// </summary>
+perf_count_t potrf_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Solving for NRHS right-hand sides with the Cholesky factor, with PxPOTRS.
+/// </summary>
+perf_count_t potrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Updating the Cholesky factor of an N x N matrix A for A + X X^T or
+///   A - X X^T, where X is N x K, with factorization_t, including the
+///   update of A itself. The rotated columns of X passed between process
+///   rows are not counted.
+/// </summary>
+perf_count_t chol_update_count(blas_idx_t n, blas_idx_t k, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   The QR factorization of an M x N matrix, M >= N, with PxGEQRF.
+/// </summary>
+perf_count_t geqrf_count(blas_idx_t m, blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Applying Q^T from the QR factorization of an M x N matrix to NRHS
+///   columns with PxORMQR.
+/// </summary>
+perf_count_t ormqr_count(blas_idx_t m, blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Solving an N x N triangular system for NRHS right-hand sides with
+///   PxTRTRS.
+/// </summary>
+perf_count_t trtrs_count(blas_idx_t n, blas_idx_t nrhs, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   The eigenvalues and eigenvectors of a symmetric N x N matrix in the
+///   three phases of PxSYEVD: PxSYTRD, PxSTEDC without deflation and
+///   PxORMTR.
+/// </summary>
+perf_count_t syevd_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   The real Schur form and Schur vectors of an N x N matrix with
+///   PxGEHRD, PxLAHQR and PxORMHR, taking the 25 N^3 operations that
+///   Golub and Van Loan give for the whole computation.
+/// </summary>
+perf_count_t schur_count(blas_idx_t n, blas_idx_t nprows, blas_idx_t npcols);
+
+/// <summary>
+///   Measures the DGEMM rate of the calling process, in floating point
+///   operations per second, by timing the best of several local products
+///   of N x N matrices. Every process should call this method at the same
+///   time, so that the measurement includes the effect of the other
+///   processes on shared memory bandwidth and clock speed.
+/// </summary>
+/// <remark>
+///   The rate is per process, which is the per-core peak when each
+///   process runs a single-threaded BLAS.
+/// </remark>
+double calibrate_peak(blas_idx_t n = 1024);
+
+#endif // _PERF_MODEL_H_
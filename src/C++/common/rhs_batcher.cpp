@@ -0,0 +1,119 @@
+#include <cassert>
+
+#include <mpi.h>
+#include "rhs_batcher.h"
+#include "scalapack.h"
+#include "scalapack_traits.h"
+
+rhs_batcher_t::rhs_batcher_t(std::shared_ptr<factorization_t> solver, blas_idx_t max_columns, double max_wait /*= -1.0*/)
+    : m_solver(solver), m_max_columns(max_columns), m_pending_columns(0), m_flushes(0), 
+      m_max_wait(max_wait), m_oldest(0.0)
+{
+    assert(max_columns > 0);
+}
+
+rhs_batcher_t::~rhs_batcher_t()
+{
+    // Callers must not lose their solutions, so solve whatever is left 
+    if (m_pending_columns)
+        flush();
+}
+
+blas_idx_t rhs_batcher_t::submit(std::shared_ptr<block_cyclic_mat_t> b, callback_t done /*= callback_t()*/)
+{
+    assert(b->global_rows() == m_solver->matrix()->global_rows());
+
+    if (m_pending.empty())
+        m_oldest = MPI_Wtime();
+
+    request_t request = {b, done};
+    m_pending.push_back(request);
+    m_pending_columns += b->global_cols();
+
+    if (m_pending_columns >= m_max_columns)
+        return flush();
+    return poll();
+}
+
+blas_idx_t rhs_batcher_t::poll()
+{
+    return timed_out() ? flush() : 0;
+}
+
+bool rhs_batcher_t::timed_out() const
+{
+    if (m_max_wait < 0 || m_pending.empty())
+        return false;
+
+    // Clocks differ between processes, so the first process of the grid
+    // decides for everyone
+    int expired = (MPI_Wtime() - m_oldest) >= m_max_wait;
+    MPI_Bcast(&expired, 1, MPI_INT, 0, m_solver->matrix()->grid()->comm());
+    return expired != 0;
+}
+
+blas_idx_t rhs_batcher_t::flush()
+{
+    if (m_pending.empty())
+        return 0;
+
+    auto a     = m_solver->matrix();
+    auto grid  = a->grid();
+    auto batch = std::make_shared<block_cyclic_mat_t>(grid, a->global_rows(), m_pending_columns, 
+        a->row_block_size(), a->col_block_size());
+
+    blas_idx_t ictxt = grid->context();
+    blas_idx_t m = a->global_rows();
+    blas_idx_t one = 1;
+
+    // Gather the pending right-hand sides side by side
+    blas_idx_t jb = 1;
+    for (size_t i = 0; i < m_pending.size(); i ++)
+    {
+        auto b = m_pending[i].b;
+        blas_idx_t n = b->global_cols();
+        scalapack_traits<double>::gemr2d(m, n, 
+            b->local_data(), one, one, b->descriptor(), 
+            batch->local_data(), one, jb, batch->descriptor(), 
+            ictxt);
+        jb += n;
+    }
+
+    blas_idx_t info = m_solver->solve(batch);
+
+    // Scatter the solutions back to their owners
+    jb = 1;
+    for (size_t i = 0; i < m_pending.size(); i ++)
+    {
+        auto b = m_pending[i].b;
+        blas_idx_t n = b->global_cols();
+        scalapack_traits<double>::gemr2d(m, n, 
+            batch->local_data(), one, jb, batch->descriptor(), 
+            b->local_data(), one, one, b->descriptor(), 
+            ictxt);
+        b->mark_modified();
+        jb += n;
+    }
+
+    std::vector<request_t> done;
+    done.swap(m_pending);
+    m_pending_columns = 0;
+    m_flushes ++;
+
+    for (size_t i = 0; i < done.size(); i ++)
+    {
+        if (done[i].done)
+            done[i].done(done[i].b);
+    }
+    return info;
+}
+
+blas_idx_t rhs_batcher_t::pending_columns() const
+{
+    return m_pending_columns;
+}
+
+blas_idx_t rhs_batcher_t::flushes() const
+{
+    return m_flushes;
+}
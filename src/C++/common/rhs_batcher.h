@@ -0,0 +1,102 @@
+// -*- mode: c++ -*-
+#ifndef _RHS_BATCHER_H_
+#define _RHS_BATCHER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "factorization.h"
+
+/// <summary>
+///   A class that gathers right-hand sides arriving one at a time into
+///   a single multi-column matrix, so that they are solved by a single
+///   PxGETRS or PxPOTRS call instead of many latency-bound ones.
+/// </summary>
+/// <remark>
+///   All methods are collective over the grid of the factorization.
+///   Right-hand sides are queued until the number of pending columns
+///   reaches the size threshold or the oldest one has waited longer 
+///   than the time threshold, as measured on the first process of the
+///   grid. On a flush the pending right-hand sides are copied into one
+///   matrix with PxGEMR2D, solved together and copied back, so each
+///   submitted matrix ends up holding its own solution.
+/// </remark>
+class rhs_batcher_t
+{
+public:
+    /// <summary>
+    ///   A function called with each right-hand side once it holds 
+    ///   the solution.
+    /// </summary>
+    typedef std::function<void(std::shared_ptr<block_cyclic_mat_t>)> callback_t;
+
+    /// <summary>
+    ///   Creates a batcher in front of the given factorization.
+    /// </summary>
+    /// <param name="solver">
+    ///   The factorization used to solve the batched right-hand sides.
+    /// </param>
+    /// <param name="max_columns">
+    ///   The number of pending columns that triggers a flush.
+    /// </param>
+    /// <param name="max_wait">
+    ///   The time in seconds after which a pending right-hand side
+    ///   triggers a flush. A negative value disables the time threshold.
+    /// </param>
+    rhs_batcher_t(std::shared_ptr<factorization_t> solver, blas_idx_t max_columns, double max_wait = -1.0);
+
+    /// <summary>
+    ///   Queues a right-hand side, which must have as many rows as the
+    ///   factorized matrix and live on the same grid, and flushes the 
+    ///   batch if a threshold has been reached. Returns the INFO value
+    ///   of the solve if a flush happened and zero otherwise.
+    /// </summary>
+    blas_idx_t submit(std::shared_ptr<block_cyclic_mat_t> b, callback_t done = callback_t());
+
+    /// <summary>
+    ///   Flushes the batch if the time threshold has been reached. Returns
+    ///   the INFO value of the solve if a flush happened and zero otherwise.
+    /// </summary>
+    blas_idx_t poll();
+
+    /// <summary>
+    ///   Solves all pending right-hand sides and returns the INFO value
+    ///   of the solve.
+    /// </summary>
+    blas_idx_t flush();
+
+    /// <summary>
+    ///   Returns the number of columns waiting to be solved.
+    /// </summary>
+    blas_idx_t pending_columns() const;
+
+    /// <summary>
+    ///   Returns the number of flushes so far.
+    /// </summary>
+    blas_idx_t flushes() const;
+
+    ~rhs_batcher_t();
+
+private:
+    struct request_t
+    {
+        std::shared_ptr<block_cyclic_mat_t> b;
+        callback_t                          done;
+    };
+
+    bool timed_out() const;
+
+    std::shared_ptr<factorization_t> m_solver;
+    std::vector<request_t>           m_pending;
+    blas_idx_t                       m_max_columns;
+    blas_idx_t                       m_pending_columns;
+    blas_idx_t                       m_flushes;
+    double                           m_max_wait;
+    double                           m_oldest;
+
+    // Mark this class as non-copyable
+    rhs_batcher_t(const rhs_batcher_t&);
+    const rhs_batcher_t& operator=(const rhs_batcher_t&);
+};
+
+#endif // _RHS_BATCHER_H_
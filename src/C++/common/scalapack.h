@@ -2,6 +2,10 @@
 #include "index.h"
 #include "import.h"
 
+#ifdef __cplusplus
+#include <complex>
+#endif
+
 #ifdef _WIN32
 #define pdlaset_ PDLASET
 #define pdlange_ PDLANGE
@@ -9,6 +13,53 @@
 #define pdgetrf_ PDGETRF
 #define pdpotrf_ PDPOTRF
 #define pdgemm_ PDGEMM
+#define pdgemr2d_ PDGEMR2D
+#define pdgetrs_ PDGETRS
+#define pdpotrs_ PDPOTRS
+#define pdgetri_ PDGETRI
+#define pdgehrd_ PDGEHRD
+#define pdlahqr_ PDLAHQR
+#define pdormhr_ PDORMHR
+#define pdsytrd_ PDSYTRD
+#define pdstedc_ PDSTEDC
+#define pdormtr_ PDORMTR
+#define pdgeqrf_ PDGEQRF
+#define pdormqr_ PDORMQR
+#define pdtrtrs_ PDTRTRS
+#define pdgels_ PDGELS
+#define pdtrsm_ PDTRSM
+#define pdlaswp_ PDLASWP
+#define pdgeadd_ PDGEADD
+#define pslaset_ PSLASET
+#define pslange_ PSLANGE
+#define psgemm_ PSGEMM
+#define psgemr2d_ PSGEMR2D
+#define psgesv_ PSGESV
+#define psgetrf_ PSGETRF
+#define psgetrs_ PSGETRS
+#define psgetri_ PSGETRI
+#define pspotrf_ PSPOTRF
+#define pspotrs_ PSPOTRS
+#define pclaset_ PCLASET
+#define pclange_ PCLANGE
+#define pcgemm_ PCGEMM
+#define pcgemr2d_ PCGEMR2D
+#define pcgesv_ PCGESV
+#define pcgetrf_ PCGETRF
+#define pcgetrs_ PCGETRS
+#define pcgetri_ PCGETRI
+#define pcpotrf_ PCPOTRF
+#define pcpotrs_ PCPOTRS
+#define pzlaset_ PZLASET
+#define pzlange_ PZLANGE
+#define pzgemm_ PZGEMM
+#define pzgemr2d_ PZGEMR2D
+#define pzgesv_ PZGESV
+#define pzgetrf_ PZGETRF
+#define pzgetrs_ PZGETRS
+#define pzgetri_ PZGETRI
+#define pzpotrf_ PZPOTRF
+#define pzpotrs_ PZPOTRS
 #endif
 
 #ifdef __cplusplus
@@ -33,6 +84,11 @@ extern "C"
         double &, 
         double *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
 
+    void pdgemr2d_ (blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
     void pdgesv_ (blas_idx_t &, blas_idx_t &, 
         double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
         blas_idx_t *, 
@@ -60,6 +116,180 @@ extern "C"
     void pdpotrf_ (char &, blas_idx_t &, 
         double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
 
+    void pdpotrs_ (char &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    // Single precision, single precision complex and double precision 
+    // complex versions of the routines above. The complex types are
+    // layout compatible with the Fortran COMPLEX and COMPLEX*16 types.
+
+    void pslaset_ (char&, 
+        blas_idx_t&, blas_idx_t&,  
+        float&,  float&,  
+        float*, blas_idx_t&, blas_idx_t&, blas_idx_t*);
+        
+    float pslange_ (char&, 
+        blas_idx_t&, blas_idx_t&, 
+        float*, blas_idx_t&, blas_idx_t&, blas_idx_t*,
+        float*);
+
+    void psgemm_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        float &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        float &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
+
+    void psgemr2d_ (blas_idx_t &, blas_idx_t &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void psgesv_ (blas_idx_t &, blas_idx_t &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t *, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void psgetrf_ (blas_idx_t &, blas_idx_t &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *,
+        blas_idx_t *, 
+        blas_idx_t &);
+
+    void psgetrs_(char&, 
+        blas_idx_t&, blas_idx_t&, 
+        float*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        float*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t&);
+
+    void psgetri_(blas_idx_t&, 
+        float*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        float*, blas_idx_t&, 
+        blas_idx_t*, blas_idx_t&, 
+        blas_idx_t&);
+
+    void pspotrf_ (char &, blas_idx_t &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void pspotrs_ (char &, blas_idx_t &, blas_idx_t &, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        float *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void pclaset_ (char&, 
+        blas_idx_t&, blas_idx_t&,  
+        std::complex<float>&,  std::complex<float>&,  
+        std::complex<float>*, blas_idx_t&, blas_idx_t&, blas_idx_t*);
+        
+    float pclange_ (char&, 
+        blas_idx_t&, blas_idx_t&, 
+        std::complex<float>*, blas_idx_t&, blas_idx_t&, blas_idx_t*,
+        float*);
+
+    void pcgemm_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        std::complex<float> &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<float> &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
+
+    void pcgemr2d_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void pcgesv_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t *, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void pcgetrf_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *,
+        blas_idx_t *, 
+        blas_idx_t &);
+
+    void pcgetrs_(char&, 
+        blas_idx_t&, blas_idx_t&, 
+        std::complex<float>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        std::complex<float>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t&);
+
+    void pcgetri_(blas_idx_t&, 
+        std::complex<float>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        std::complex<float>*, blas_idx_t&, 
+        blas_idx_t*, blas_idx_t&, 
+        blas_idx_t&);
+
+    void pcpotrf_ (char &, blas_idx_t &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void pcpotrs_ (char &, blas_idx_t &, blas_idx_t &, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<float> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void pzlaset_ (char&, 
+        blas_idx_t&, blas_idx_t&,  
+        std::complex<double>&,  std::complex<double>&,  
+        std::complex<double>*, blas_idx_t&, blas_idx_t&, blas_idx_t*);
+        
+    double pzlange_ (char&, 
+        blas_idx_t&, blas_idx_t&, 
+        std::complex<double>*, blas_idx_t&, blas_idx_t&, blas_idx_t*,
+        double*);
+
+    void pzgemm_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        std::complex<double> &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<double> &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
+
+    void pzgemr2d_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void pzgesv_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t *, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void pzgetrf_ (blas_idx_t &, blas_idx_t &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *,
+        blas_idx_t *, 
+        blas_idx_t &);
+
+    void pzgetrs_(char&, 
+        blas_idx_t&, blas_idx_t&, 
+        std::complex<double>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        std::complex<double>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t&);
+
+    void pzgetri_(blas_idx_t&, 
+        std::complex<double>*, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
+        blas_idx_t*, 
+        std::complex<double>*, blas_idx_t&, 
+        blas_idx_t*, blas_idx_t&, 
+        blas_idx_t&);
+
+    void pzpotrf_ (char &, blas_idx_t &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, blas_idx_t &);
+
+    void pzpotrs_ (char &, blas_idx_t &, blas_idx_t &, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        std::complex<double> *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
     void pdgehrd_ (blas_idx_t &,blas_idx_t &,blas_idx_t&, 
         double *, blas_idx_t&, blas_idx_t&, blas_idx_t*, 
         double *, double *, blas_idx_t&, blas_idx_t&);
@@ -69,6 +299,72 @@ extern "C"
         double*, double*, blas_idx_t &, blas_idx_t &, 
         double*, blas_idx_t *, double*, blas_idx_t &, 
         blas_idx_t *, blas_idx_t &, blas_idx_t &);
+
+    void pdormhr_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdsytrd_ (char &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, double *, double *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdstedc_ (char &, blas_idx_t &, 
+        double *, double *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, 
+        blas_idx_t *, blas_idx_t &, 
+        blas_idx_t &);
+
+    void pdormtr_ (char &, char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdgeqrf_ (blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdormqr_ (char &, char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdtrtrs_ (char &, char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &);
+
+    void pdgels_ (char &, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &);
+
+    void pdtrsm_ (char &, char &, char &, char &, 
+        blas_idx_t &, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
+
+    void pdlaswp_ (char &, char &, blas_idx_t &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        blas_idx_t &, blas_idx_t &, blas_idx_t *);
+
+    void pdgeadd_ (char &, blas_idx_t &, blas_idx_t &, 
+        double &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *, 
+        double &, 
+        double *, blas_idx_t &, blas_idx_t &, blas_idx_t *);
 #ifdef __cplusplus
 };
 #endif
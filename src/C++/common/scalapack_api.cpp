@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <string>
+
+#include "scalapack_api.h"
+
+// The wrappers are implemented once as templates and exposed through the
+// overloads declared in scalapack_api.h
+
+template <typename T>
+static void gemm_impl(basic_block_cyclic_view_t<T>& a, basic_block_cyclic_view_t<T>& b, basic_block_cyclic_view_t<T>& c, T alpha, T beta)
+{
+    assert(!c.transposed());
+    assert(a.rows() == c.rows() && b.cols() == c.cols() && a.cols() == b.rows());
+
+    char transa = a.trans(), transb = b.trans();
+    blas_idx_t m = c.rows(), n = c.cols(), k = a.cols();
+    blas_idx_t ia = a.ia(), ja = a.ja(), ib = b.ia(), jb = b.ja(), ic = c.ia(), jc = c.ja();
+    scalapack_traits<T>::gemm(transa, transb, m, n, k,
+        alpha,
+        a.data(), ia, ja, a.descriptor(),
+        b.data(), ib, jb, b.descriptor(),
+        beta,
+        c.data(), ic, jc, c.descriptor());
+    c.matrix().mark_modified();
+}
+
+template <typename T>
+static std::vector<blas_idx_t> getrf_impl(basic_block_cyclic_view_t<T>& a, blas_idx_t& info)
+{
+    assert(!a.transposed());
+
+    // LOCr(M_A) + MB_A bounds the LOCr(M_SUB + MOD(IA-1, MB_A)) + MB_A
+    // entries that ScaLAPACK needs for any submatrix
+    basic_block_cyclic_mat_t<T>& mat = a.matrix();
+    std::vector<blas_idx_t> ipiv(mat.local_rows() + mat.row_block_size());
+
+    blas_idx_t m = a.m(), n = a.n(), ia = a.ia(), ja = a.ja();
+    scalapack_traits<T>::getrf(m, n, a.data(), ia, ja, a.descriptor(), ipiv.data(), info);
+    mat.mark_modified();
+    return ipiv;
+}
+
+template <typename T>
+static blas_idx_t getri_impl(basic_block_cyclic_view_t<T>& a, std::vector<blas_idx_t>& ipiv)
+{
+    assert(!a.transposed() && a.m() == a.n());
+    workspace_pool_t& pool = workspace_pool_t::instance();
+
+    blas_idx_t n = a.n(), ia = a.ia(), ja = a.ja(), info = 0;
+
+    // The workspace depends on the descriptor and the position and size
+    // of the submatrix
+    std::string routine = std::string(scalapack_traits<T>::prefix()) + "getri";
+    std::vector<blas_idx_t> args(a.descriptor(), a.descriptor() + DLEN_);
+    args.push_back(ia);
+    args.push_back(ja);
+    args.push_back(n);
+
+    std::vector<blas_idx_t> sizes;
+    if (!pool.find_query(routine, args, sizes))
+    {
+        blas_idx_t lwork = -1, liwork = -1;
+        T          work_size;
+        blas_idx_t iwork_size;
+        scalapack_traits<T>::getri(n,
+            a.data(), ia, ja, a.descriptor(),
+            ipiv.data(),
+            &work_size, lwork, &iwork_size, liwork, info);
+        if (info != 0)
+            return info;
+        sizes.push_back(static_cast<blas_idx_t>(std::real(work_size)));
+        sizes.push_back(iwork_size);
+        pool.store_query(routine, args, sizes);
+    }
+
+    blas_idx_t lwork = sizes[0], liwork = sizes[1];
+    workspace_t<T>          work (lwork);
+    workspace_t<blas_idx_t> iwork(liwork);
+    scalapack_traits<T>::getri(n,
+        a.data(), ia, ja, a.descriptor(),
+        ipiv.data(),
+        work.data(), lwork, iwork.data(), liwork, info);
+    a.matrix().mark_modified();
+    return info;
+}
+
+template <typename T>
+static blas_idx_t potrf_impl(basic_block_cyclic_view_t<T>& a, char uplo)
+{
+    assert(!a.transposed() && a.m() == a.n());
+
+    blas_idx_t n = a.n(), ia = a.ia(), ja = a.ja(), info = 0;
+    scalapack_traits<T>::potrf(uplo, n, a.data(), ia, ja, a.descriptor(), info);
+    a.matrix().mark_modified();
+    return info;
+}
+
+template <typename T>
+static typename scalapack_traits<T>::real_type lange_impl(basic_block_cyclic_view_t<T>& a, char norm)
+{
+    typedef typename scalapack_traits<T>::real_type real_type;
+
+    // The 1-norm of A^T is the infinity norm of A and vice versa
+    if (a.transposed())
+    {
+        if (norm == '1' || norm == 'O' || norm == 'o')
+            norm = 'I';
+        else if (norm == 'I' || norm == 'i')
+            norm = '1';
+    }
+
+    // Large enough for the LOCr(M_SUB + MOD(IA-1, MB_A)) entries needed for
+    // the infinity norm and the LOCc(N_SUB + MOD(JA-1, NB_A)) for the 1-norm
+    basic_block_cyclic_mat_t<T>& mat = a.matrix();
+    workspace_t<real_type> work(std::max(mat.local_rows() + mat.row_block_size(), mat.local_cols() + mat.col_block_size()));
+
+    blas_idx_t m = a.m(), n = a.n(), ia = a.ia(), ja = a.ja();
+    return scalapack_traits<T>::lange(norm, m, n, a.data(), ia, ja, a.descriptor(), work.data());
+}
+
+#define DEFINE_SCALAPACK_API(T, R) \
+    void gemm(basic_block_cyclic_view_t<T> a, basic_block_cyclic_view_t<T> b, basic_block_cyclic_view_t<T> c, T alpha, T beta) \
+    { \
+        gemm_impl(a, b, c, alpha, beta); \
+    } \
+    std::vector<blas_idx_t> getrf(basic_block_cyclic_view_t<T> a, blas_idx_t& info) \
+    { \
+        return getrf_impl(a, info); \
+    } \
+    blas_idx_t getri(basic_block_cyclic_view_t<T> a, std::vector<blas_idx_t>& ipiv) \
+    { \
+        return getri_impl(a, ipiv); \
+    } \
+    blas_idx_t potrf(basic_block_cyclic_view_t<T> a, char uplo) \
+    { \
+        return potrf_impl(a, uplo); \
+    } \
+    R lange(basic_block_cyclic_view_t<T> a, char norm) \
+    { \
+        return lange_impl(a, norm); \
+    }
+
+DEFINE_SCALAPACK_API(float,                float)
+DEFINE_SCALAPACK_API(double,               double)
+DEFINE_SCALAPACK_API(std::complex<float>,  float)
+DEFINE_SCALAPACK_API(std::complex<double>, double)
@@ -0,0 +1,70 @@
+// -*- mode: c++ -*-
+#ifndef _SCALAPACK_API_H_
+#define _SCALAPACK_API_H_
+
+#include <complex>
+#include <vector>
+#include "block_cyclic_mat.h"
+#include "block_cyclic_view.h"
+#include "scalapack_traits.h"
+#include "workspace_pool.h"
+
+/// <remark>
+///   Type-safe wrappers over the ScaLAPACK routines in scalapack.h. They
+///   operate on views, pick the routine for the element type through
+///   scalapack_traits, size pivot vectors the way ScaLAPACK documents them
+///   and take their workspace from workspace_pool_t::instance(), so
+///   repeated calls neither allocate nor repeat workspace queries.
+///   Matrices written by a routine are marked as modified.
+///
+///   The wrappers are overloaded for float, double, std::complex&lt;float&gt;
+///   and std::complex&lt;double&gt; rather than being function templates, so
+///   that a whole matrix converts to a view implicitly. For element type T
+///   they are:
+///
+///   void gemm(A, B, C, T alpha = 1, T beta = 0)
+///     Computes C = alpha * op(A) * op(B) + beta * C with PxGEMM, where
+///     op(X) is X or X^T depending on whether the view is transposed. C
+///     must not be transposed.
+///
+///   std::vector&lt;blas_idx_t&gt; getrf(A, blas_idx_t&amp; info)
+///     Computes the LU factorization of A in place with PxGETRF and returns
+///     the pivots, which hold LOCr(M_A) + MB_A entries. INFO is positive
+///     if U is singular.
+///
+///   blas_idx_t getri(A, std::vector&lt;blas_idx_t&gt;&amp; ipiv)
+///     Overwrites the LU factors computed by getrf with the inverse of the
+///     original matrix using PxGETRI, and returns INFO. The workspace query
+///     is made on the first call for a given distribution and submatrix
+///     and remembered by the pool afterwards.
+///
+///   blas_idx_t potrf(A, char uplo = 'U')
+///     Computes the Cholesky factorization of the Hermitian positive
+///     definite matrix A in place with PxPOTRF, and returns INFO. With 'U'
+///     A = U^H U is computed from the upper triangle, with 'L' A = L L^H
+///     from the lower triangle.
+///
+///   real_type lange(A, char norm)
+///     Returns a norm of A computed with PxLANGE: 'M' for the largest
+///     absolute value, '1' or 'O' for the 1-norm, 'I' for the infinity norm
+///     and 'F' for the Frobenius norm.
+///
+///   The factorizations do not accept transposed views.
+/// </remark>
+
+#define DECLARE_SCALAPACK_API(T, R) \
+    void gemm(basic_block_cyclic_view_t<T> a, basic_block_cyclic_view_t<T> b, basic_block_cyclic_view_t<T> c, \
+        T alpha = T(1), T beta = T(0)); \
+    std::vector<blas_idx_t> getrf(basic_block_cyclic_view_t<T> a, blas_idx_t& info); \
+    blas_idx_t getri(basic_block_cyclic_view_t<T> a, std::vector<blas_idx_t>& ipiv); \
+    blas_idx_t potrf(basic_block_cyclic_view_t<T> a, char uplo = 'U'); \
+    R lange(basic_block_cyclic_view_t<T> a, char norm);
+
+DECLARE_SCALAPACK_API(float,                float)
+DECLARE_SCALAPACK_API(double,               double)
+DECLARE_SCALAPACK_API(std::complex<float>,  float)
+DECLARE_SCALAPACK_API(std::complex<double>, double)
+
+#undef DECLARE_SCALAPACK_API
+
+#endif // _SCALAPACK_API_H_
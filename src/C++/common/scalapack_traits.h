@@ -0,0 +1,125 @@
+// -*- mode: c++ -*-
+#ifndef _SCALAPACK_TRAITS_H_
+#define _SCALAPACK_TRAITS_H_
+
+#include <complex>
+#include <mpi.h>
+#include "scalapack.h"
+#include "trace.h"
+
+/// <summary>
+///   Selects the ScaLAPACK routines and the MPI datatype that match an
+///   element type at compile time: ps* for float, pd* for double, pc* for
+///   std::complex&lt;float&gt; and pz* for std::complex&lt;double&gt;.
+/// </summary>
+/// <remark>
+///   Every call is recorded by trace_t when tracing is enabled.
+///   The primary template is deliberately left undefined, so using a
+///   distributed matrix with any other element type, or passing data of
+///   one precision to a routine of another, fails to compile.
+/// </remark>
+template <typename T>
+struct scalapack_traits;
+
+#define SCALAPACK_TRAITS(T, R, P, MPI_TYPE, IS_COMPLEX) \
+template <> \
+struct scalapack_traits<T> \
+{ \
+    typedef R real_type; \
+    static const bool is_complex = IS_COMPLEX; \
+    static const char* prefix() { return #P; } \
+    static MPI_Datatype mpi_type() { return MPI_TYPE; } \
+    \
+    static void laset(char& uplo, blas_idx_t& m, blas_idx_t& n, T& alpha, T& beta, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca) \
+    { \
+        trace_scope_t scope(#P "laset"); \
+        P##laset_(uplo, m, n, alpha, beta, a, ia, ja, desca); \
+    } \
+    \
+    static R lange(char& norm, blas_idx_t& m, blas_idx_t& n, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, R* work) \
+    { \
+        trace_scope_t scope(#P "lange"); \
+        return P##lange_(norm, m, n, a, ia, ja, desca, work); \
+    } \
+    \
+    static void gemm(char& transa, char& transb, blas_idx_t& m, blas_idx_t& n, blas_idx_t& k, \
+        T& alpha, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        T* b, blas_idx_t& ib, blas_idx_t& jb, blas_idx_t* descb, \
+        T& beta, \
+        T* c, blas_idx_t& ic, blas_idx_t& jc, blas_idx_t* descc) \
+    { \
+        trace_scope_t scope(#P "gemm"); \
+        P##gemm_(transa, transb, m, n, k, alpha, a, ia, ja, desca, b, ib, jb, descb, beta, c, ic, jc, descc); \
+    } \
+    \
+    static void gemr2d(blas_idx_t& m, blas_idx_t& n, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        T* b, blas_idx_t& ib, blas_idx_t& jb, blas_idx_t* descb, \
+        blas_idx_t& ictxt) \
+    { \
+        trace_scope_t scope(#P "gemr2d"); \
+        P##gemr2d_(m, n, a, ia, ja, desca, b, ib, jb, descb, ictxt); \
+    } \
+    \
+    static void gesv(blas_idx_t& n, blas_idx_t& nrhs, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        blas_idx_t* ipiv, \
+        T* b, blas_idx_t& ib, blas_idx_t& jb, blas_idx_t* descb, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "gesv"); \
+        P##gesv_(n, nrhs, a, ia, ja, desca, ipiv, b, ib, jb, descb, info); \
+    } \
+    \
+    static void getrf(blas_idx_t& m, blas_idx_t& n, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        blas_idx_t* ipiv, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "getrf"); \
+        P##getrf_(m, n, a, ia, ja, desca, ipiv, info); \
+    } \
+    \
+    static void getrs(char& trans, blas_idx_t& n, blas_idx_t& nrhs, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        blas_idx_t* ipiv, \
+        T* b, blas_idx_t& ib, blas_idx_t& jb, blas_idx_t* descb, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "getrs"); \
+        P##getrs_(trans, n, nrhs, a, ia, ja, desca, ipiv, b, ib, jb, descb, info); \
+    } \
+    \
+    static void getri(blas_idx_t& n, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        blas_idx_t* ipiv, T* work, blas_idx_t& lwork, \
+        blas_idx_t* iwork, blas_idx_t& liwork, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "getri"); \
+        P##getri_(n, a, ia, ja, desca, ipiv, work, lwork, iwork, liwork, info); \
+    } \
+    \
+    static void potrf(char& uplo, blas_idx_t& n, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "potrf"); \
+        P##potrf_(uplo, n, a, ia, ja, desca, info); \
+    } \
+    \
+    static void potrs(char& uplo, blas_idx_t& n, blas_idx_t& nrhs, \
+        T* a, blas_idx_t& ia, blas_idx_t& ja, blas_idx_t* desca, \
+        T* b, blas_idx_t& ib, blas_idx_t& jb, blas_idx_t* descb, blas_idx_t& info) \
+    { \
+        trace_scope_t scope(#P "potrs"); \
+        P##potrs_(uplo, n, nrhs, a, ia, ja, desca, b, ib, jb, descb, info); \
+    } \
+};
+
+SCALAPACK_TRAITS(float,                float,  ps, MPI_FLOAT,          false)
+SCALAPACK_TRAITS(double,               double, pd, MPI_DOUBLE,         false)
+SCALAPACK_TRAITS(std::complex<float>,  float,  pc, MPI_COMPLEX,        true)
+SCALAPACK_TRAITS(std::complex<double>, double, pz, MPI_DOUBLE_COMPLEX, true)
+
+#undef SCALAPACK_TRAITS
+
+#endif // _SCALAPACK_TRAITS_H_
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <utility>
+#include <omp.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "task_pool.h"
+
+// Minimal mutex, condition variable and thread wrappers over the Win32
+// and POSIX primitives
+
+class mutex_t
+{
+public:
+#ifdef _WIN32
+    mutex_t()     { InitializeCriticalSection(&m_mutex); }
+    ~mutex_t()    { DeleteCriticalSection(&m_mutex); }
+    void lock()   { EnterCriticalSection(&m_mutex); }
+    void unlock() { LeaveCriticalSection(&m_mutex); }
+
+    CRITICAL_SECTION m_mutex;
+#else
+    mutex_t()     { pthread_mutex_init(&m_mutex, NULL); }
+    ~mutex_t()    { pthread_mutex_destroy(&m_mutex); }
+    void lock()   { pthread_mutex_lock(&m_mutex); }
+    void unlock() { pthread_mutex_unlock(&m_mutex); }
+
+    pthread_mutex_t m_mutex;
+#endif
+
+private:
+    mutex_t(const mutex_t&);
+    const mutex_t& operator=(const mutex_t&);
+};
+
+class scoped_lock_t
+{
+public:
+    explicit scoped_lock_t(mutex_t& mutex) : m_mutex(mutex) { m_mutex.lock(); }
+    ~scoped_lock_t() { m_mutex.unlock(); }
+
+private:
+    mutex_t& m_mutex;
+
+    scoped_lock_t(const scoped_lock_t&);
+    const scoped_lock_t& operator=(const scoped_lock_t&);
+};
+
+class condition_t
+{
+public:
+#ifdef _WIN32
+    condition_t()              { InitializeConditionVariable(&m_cond); }
+    ~condition_t()             {}
+    void wait(mutex_t& mutex)  { SleepConditionVariableCS(&m_cond, &mutex.m_mutex, INFINITE); }
+    void notify_one()          { WakeConditionVariable(&m_cond); }
+    void notify_all()          { WakeAllConditionVariable(&m_cond); }
+
+    CONDITION_VARIABLE m_cond;
+#else
+    condition_t()              { pthread_cond_init(&m_cond, NULL); }
+    ~condition_t()             { pthread_cond_destroy(&m_cond); }
+    void wait(mutex_t& mutex)  { pthread_cond_wait(&m_cond, &mutex.m_mutex); }
+    void notify_one()          { pthread_cond_signal(&m_cond); }
+    void notify_all()          { pthread_cond_broadcast(&m_cond); }
+
+    pthread_cond_t m_cond;
+#endif
+
+private:
+    condition_t(const condition_t&);
+    const condition_t& operator=(const condition_t&);
+};
+
+typedef std::function<void ()> thread_entry_t;
+
+#ifdef _WIN32
+typedef HANDLE thread_handle_t;
+
+static unsigned __stdcall thread_main(void* entry)
+{
+    (*static_cast<thread_entry_t*>(entry))();
+    return 0;
+}
+
+static thread_handle_t start_thread(thread_entry_t* entry)
+{
+    return reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, thread_main, entry, 0, NULL));
+}
+
+static void join_thread(thread_handle_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t thread_handle_t;
+
+static void* thread_main(void* entry)
+{
+    (*static_cast<thread_entry_t*>(entry))();
+    return NULL;
+}
+
+static thread_handle_t start_thread(thread_entry_t* entry)
+{
+    pthread_t thread;
+    int rc = pthread_create(&thread, NULL, thread_main, entry);
+    assert(rc == 0);
+    return thread;
+}
+
+static void join_thread(thread_handle_t thread)
+{
+    pthread_join(thread, NULL);
+}
+#endif
+
+// The state shared by the workers and the scheduling thread. The counters
+// and the list of finished tasks are guarded by the lock.
+struct task_pool_t::shared_t
+{
+    mutex_t                lock;
+    condition_t            work;
+    condition_t            finished;
+    size_t                 queued;
+    bool                   stop;
+    std::vector<size_t>    done;
+    std::vector<worker_t*> workers;
+    size_t                 tasks;
+    size_t                 steals;
+    double                 busy;
+
+    shared_t() : queued(0), stop(false), tasks(0), steals(0), busy(0.0) {}
+};
+
+struct task_pool_t::worker_t
+{
+    mutex_t                               lock;
+    std::deque<std::pair<task_t, size_t> > queue;
+    size_t                                index;
+    shared_t*                             shared;
+    thread_entry_t                        entry;
+    thread_handle_t                       thread;
+
+    // Pops from the back of the worker's own deque, or else steals from
+    // the front of the others. Returns false if every deque is empty.
+    bool take(task_t& task, size_t& id, bool& stolen)
+    {
+        size_t n = shared->workers.size();
+        for (size_t k = 0; k < n; k ++)
+        {
+            worker_t* victim = shared->workers[(index + k) % n];
+            scoped_lock_t guard(victim->lock);
+            if (victim->queue.empty())
+                continue;
+            if (k == 0)
+            {
+                task = victim->queue.back().first;
+                id   = victim->queue.back().second;
+                victim->queue.pop_back();
+            }
+            else
+            {
+                task = victim->queue.front().first;
+                id   = victim->queue.front().second;
+                victim->queue.pop_front();
+            }
+            stolen = k != 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+task_pool_t::task_pool_t(blas_idx_t threads /*= 0*/) : m_shared(new shared_t), m_next(0), m_pending(0)
+{
+    if (threads <= 0)
+        threads = std::max(1, omp_get_max_threads() - 1);
+
+    for (blas_idx_t i = 0; i < threads; i ++)
+    {
+        worker_t* worker = new worker_t;
+        worker->index  = size_t(i);
+        worker->shared = m_shared;
+        worker->entry  = std::bind(&task_pool_t::run_worker, worker);
+        m_shared->workers.push_back(worker);
+    }
+
+    // The workers only look at each other once they are all listed
+    for (size_t i = 0; i < m_shared->workers.size(); i ++)
+        m_shared->workers[i]->thread = start_thread(&m_shared->workers[i]->entry);
+}
+
+task_pool_t::~task_pool_t()
+{
+    {
+        scoped_lock_t guard(m_shared->lock);
+        m_shared->stop = true;
+        m_shared->work.notify_all();
+    }
+
+    for (size_t i = 0; i < m_shared->workers.size(); i ++)
+    {
+        join_thread(m_shared->workers[i]->thread);
+        delete m_shared->workers[i];
+    }
+    delete m_shared;
+}
+
+blas_idx_t task_pool_t::threads() const
+{
+    return blas_idx_t(m_shared->workers.size());
+}
+
+void task_pool_t::submit(const task_t& task, size_t id, bool urgent /*= false*/)
+{
+    worker_t* worker = m_shared->workers[m_next ++ % m_shared->workers.size()];
+    {
+        scoped_lock_t guard(worker->lock);
+        if (urgent)
+            worker->queue.push_back(std::make_pair(task, id));
+        else
+            worker->queue.push_front(std::make_pair(task, id));
+    }
+
+    scoped_lock_t guard(m_shared->lock);
+    m_shared->queued ++;
+    m_pending ++;
+    m_shared->work.notify_one();
+}
+
+size_t task_pool_t::pending() const
+{
+    return m_pending;
+}
+
+size_t task_pool_t::drain(std::vector<size_t>& done, bool wait /*= false*/)
+{
+    scoped_lock_t guard(m_shared->lock);
+    while (wait && m_shared->done.empty() && m_pending > 0)
+        m_shared->finished.wait(m_shared->lock);
+
+    size_t count = m_shared->done.size();
+    done.insert(done.end(), m_shared->done.begin(), m_shared->done.end());
+    m_shared->done.clear();
+    m_pending -= count;
+    return count;
+}
+
+size_t task_pool_t::tasks() const
+{
+    scoped_lock_t guard(m_shared->lock);
+    return m_shared->tasks;
+}
+
+size_t task_pool_t::steals() const
+{
+    scoped_lock_t guard(m_shared->lock);
+    return m_shared->steals;
+}
+
+double task_pool_t::busy() const
+{
+    scoped_lock_t guard(m_shared->lock);
+    return m_shared->busy;
+}
+
+void task_pool_t::run_worker(worker_t* worker)
+{
+    shared_t& shared = *worker->shared;
+    for (;;)
+    {
+        // Claim one of the queued tasks, or leave once they are all done
+        // and the pool is stopping
+        {
+            scoped_lock_t guard(shared.lock);
+            while (shared.queued == 0 && !shared.stop)
+                shared.work.wait(shared.lock);
+            if (shared.queued == 0)
+                return;
+            shared.queued --;
+        }
+
+        // Every claim is backed by a task in one of the deques, although
+        // other workers may take the ones seen first
+        task_t task;
+        size_t id     = 0;
+        bool   stolen = false;
+        while (!worker->take(task, id, stolen))
+            ;
+
+        double t0 = omp_get_wtime();
+        task();
+        double t = omp_get_wtime() - t0;
+
+        scoped_lock_t guard(shared.lock);
+        shared.done.push_back(id);
+        shared.tasks ++;
+        shared.steals += stolen ? 1 : 0;
+        shared.busy   += t;
+        shared.finished.notify_one();
+    }
+}
@@ -0,0 +1,112 @@
+// -*- mode: c++ -*-
+#ifndef _TASK_POOL_H_
+#define _TASK_POOL_H_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "index.h"
+
+/// <summary>
+///   A pool of worker threads that run tasks submitted by a single
+///   scheduling thread, balancing the load by work stealing.
+/// </summary>
+/// <remark>
+///   Each worker has its own deque. A worker takes tasks from the back of
+///   its deque and, when it runs out, steals from the front of the deque
+///   of another worker, visiting them in turn from its right neighbour.
+///   Tasks are spread over the deques as they are submitted: urgent tasks
+///   go to the back, where they are run next, and the others to the front,
+///   where they wait behind the urgent ones and are the first to be
+///   stolen. Workers with nothing to do sleep until a task is submitted.
+///
+///   Every task carries an id chosen by the caller, and the ids of the
+///   tasks that have finished are collected with drain(). The scheduling
+///   thread can thus keep all its bookkeeping to itself, releasing the
+///   tasks that depend on finished ones and making the MPI calls between
+///   drains, which only needs MPI_THREAD_FUNNELED. Tasks must not submit
+///   tasks or call MPI themselves.
+/// </remark>
+class task_pool_t
+{
+public:
+    typedef std::function<void ()> task_t;
+
+    /// <summary>
+    ///   Starts the worker threads.
+    /// </summary>
+    /// <param name="threads">
+    ///   The number of workers, or zero for one less than the number of
+    ///   OpenMP threads (at least one), leaving a core to the scheduling
+    ///   thread.
+    /// </param>
+    explicit task_pool_t(blas_idx_t threads = 0);
+
+    /// <summary>
+    ///   Waits for the submitted tasks to finish and stops the workers.
+    /// </summary>
+    ~task_pool_t();
+
+    /// <summary>
+    ///   Returns the number of worker threads.
+    /// </summary>
+    blas_idx_t threads() const;
+
+    /// <summary>
+    ///   Queues a task, which is run by one of the workers.
+    /// </summary>
+    /// <param name="id">
+    ///   The id that drain() returns once the task has finished.
+    /// </param>
+    /// <param name="urgent">
+    ///   True for tasks on the critical path, which are run before the
+    ///   tasks already queued.
+    /// </param>
+    void submit(const task_t& task, size_t id, bool urgent = false);
+
+    /// <summary>
+    ///   Returns the number of tasks submitted but not yet drained.
+    /// </summary>
+    size_t pending() const;
+
+    /// <summary>
+    ///   Appends the ids of the tasks that have finished since the last
+    ///   call to done and returns how many there were. If wait is true and
+    ///   none has finished, blocks until one does; this returns at once
+    ///   when nothing is pending.
+    /// </summary>
+    size_t drain(std::vector<size_t>& done, bool wait = false);
+
+    /// <summary>
+    ///   Returns the number of tasks that have been run.
+    /// </summary>
+    size_t tasks() const;
+
+    /// <summary>
+    ///   Returns the number of tasks that were run by a worker other than
+    ///   the one they were queued on.
+    /// </summary>
+    size_t steals() const;
+
+    /// <summary>
+    ///   Returns the seconds the workers have spent running tasks, summed
+    ///   over the workers.
+    /// </summary>
+    double busy() const;
+
+private:
+    struct shared_t;
+    struct worker_t;
+
+    shared_t* m_shared;
+    size_t    m_next;
+    size_t    m_pending;
+
+    static void run_worker(worker_t* worker);
+
+    // Mark this class as non-copyable
+    task_pool_t(const task_pool_t&);
+    const task_pool_t& operator=(const task_pool_t&);
+};
+
+#endif // _TASK_POOL_H_
@@ -0,0 +1,575 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <mpi.h>
+
+#include "lapack.h"
+#include "task_pool.h"
+#include "tiled_cholesky.h"
+#include "trace.h"
+
+double tiled_stats_t::utilization() const
+{
+    return elapsed > 0.0 && threads > 0.0 ? busy / (elapsed * threads) : 0.0;
+}
+
+// The tile kernels, written in terms of the tiles of L. For the upper
+// factor the tiles are stored transposed, U(j, i) = L(i, j)^T, and the
+// kernels make the same operations on the transposes.
+
+static void potrf_tile(bool lower, blas_idx_t n, double* a, blas_idx_t lda, blas_idx_t& info)
+{
+    char uplo = lower ? 'L' : 'U';
+    dpotrf_(uplo, n, a, lda, info);
+}
+
+// L(i, j) = A(i, j) L(j, j)^-T, where A(i, j) is m x n
+static void trsm_tile(bool lower, blas_idx_t m, blas_idx_t n, double* l, blas_idx_t ldl, double* a, blas_idx_t lda)
+{
+    char   trans = 'T', diag = 'N';
+    double one   = 1.0;
+    if (lower)
+    {
+        char side = 'R', uplo = 'L';
+        dtrsm_(side, uplo, trans, diag, m, n, one, l, ldl, a, lda);
+    }
+    else
+    {
+        char side = 'L', uplo = 'U';
+        dtrsm_(side, uplo, trans, diag, n, m, one, l, ldl, a, lda);
+    }
+}
+
+// A(i, i) -= L(i, k) L(i, k)^T, where L(i, k) is n x k
+static void syrk_tile(bool lower, blas_idx_t n, blas_idx_t k, double* l, blas_idx_t ldl, double* a, blas_idx_t lda)
+{
+    char   uplo  = lower ? 'L' : 'U', trans = lower ? 'N' : 'T';
+    double alpha = -1.0, beta = 1.0;
+    dsyrk_(uplo, trans, n, k, alpha, l, ldl, beta, a, lda);
+}
+
+// A(i, j) -= L(i, k) L(j, k)^T, where L(i, k) is m x k and L(j, k) is n x k
+static void gemm_tile(bool lower, blas_idx_t m, blas_idx_t n, blas_idx_t k,
+    double* li, blas_idx_t ldi, double* lj, blas_idx_t ldj, double* a, blas_idx_t lda)
+{
+    double alpha = -1.0, beta = 1.0;
+    if (lower)
+    {
+        char transa = 'N', transb = 'T';
+        dgemm_(transa, transb, m, n, k, alpha, li, ldi, lj, ldj, beta, a, lda);
+    }
+    else
+    {
+        char transa = 'T', transb = 'N';
+        dgemm_(transa, transb, n, m, k, alpha, lj, ldj, li, ldi, beta, a, lda);
+    }
+}
+
+// Copies a rows x cols tile into a contiguous buffer
+static void pack_tile(const double* a, blas_idx_t lda, blas_idx_t rows, blas_idx_t cols, double* buffer)
+{
+    for (blas_idx_t j = 0; j < cols; j ++)
+        std::copy(a + j * lda, a + j * lda + rows, buffer + j * rows);
+}
+
+// The state of tile (i, j) of L, i >= j, on the calling process. Tiles
+// owned by other processes only matter when a local task reads them.
+struct tile_t
+{
+    blas_idx_t i;
+    blas_idx_t j;
+    bool       local;
+
+    // Owned tiles: the updates applied so far, whether a task is running
+    // on the tile and whether it holds its final value
+    blas_idx_t next;
+    bool       busy;
+    bool       done;
+    blas_idx_t info;
+
+    // Whether the final value can be read at data, and how many local
+    // tasks are left to read it
+    bool       available;
+    blas_idx_t uses;
+    double*    data;
+    blas_idx_t ld;
+
+    // The received copy of a tile of another process, or the packed copy
+    // of an owned tile while it is being sent to the processes in dests
+    std::vector<double> buffer;
+    std::vector<int>    dests;
+    size_t              sends;
+
+    tile_t() : i(0), j(0), local(false), next(0), busy(false), done(false), info(0),
+        available(false), uses(0), data(NULL), ld(0), sends(0) {}
+};
+
+// Runs one factorization: builds the tile states of the calling process,
+// then hands tasks to the pool as their inputs become available and moves
+// tiles between processes until every owned tile is final
+class tiled_engine_t
+{
+public:
+    tiled_engine_t(block_cyclic_mat_t& a, bool lower, blas_idx_t lookahead, task_pool_t& pool, MPI_Comm comm);
+
+    // Returns the local INFO, and adds the messages to the stats
+    blas_idx_t run(tiled_stats_t& stats);
+
+private:
+    bool                     m_lower;
+    blas_idx_t               m_lookahead;
+    task_pool_t&             m_pool;
+    MPI_Comm                 m_comm;
+    int                      m_rank;
+    blas_idx_t               m_n;
+    blas_idx_t               m_nb;
+    blas_idx_t               m_count;
+    blas_idx_t               m_nprows;
+    blas_idx_t               m_npcols;
+    blas_idx_t               m_rsrc;
+    blas_idx_t               m_csrc;
+    std::vector<tile_t>      m_tiles;
+    std::vector<blas_idx_t>  m_column;
+    blas_idx_t               m_progress;
+    blas_idx_t               m_posted;
+    blas_idx_t               m_remaining;
+    blas_idx_t               m_info;
+    std::vector<MPI_Request> m_recvs;
+    std::vector<tile_t*>     m_recv_tiles;
+    std::vector<MPI_Request> m_sends;
+    std::vector<tile_t*>     m_send_tiles;
+    std::vector<int>         m_indices;
+    std::vector<size_t>      m_done;
+
+    size_t  index(blas_idx_t i, blas_idx_t j) const { return size_t(i) * (i + 1) / 2 + j; }
+    tile_t& tile(blas_idx_t i, blas_idx_t j)        { return m_tiles[index(i, j)]; }
+    blas_idx_t size(blas_idx_t i) const             { return std::min(m_nb, m_n - i * m_nb); }
+
+    // The block of the matrix holding tile (i, j) of L, which is (j, i)
+    // for the upper factor, and its shape
+    blas_idx_t block_row(const tile_t& t) const { return m_lower ? t.i : t.j; }
+    blas_idx_t block_col(const tile_t& t) const { return m_lower ? t.j : t.i; }
+    blas_idx_t rows(const tile_t& t) const      { return size(block_row(t)); }
+    blas_idx_t cols(const tile_t& t) const      { return size(block_col(t)); }
+
+    int  owner(const tile_t& t) const;
+    void use(blas_idx_t a, blas_idx_t k);
+    void release(tile_t& t);
+    void post_receives();
+    void schedule(tile_t& t);
+    void finish(tile_t& t);
+    void notify(tile_t& t);
+    void send(tile_t& t);
+    size_t test(std::vector<MPI_Request>& requests, std::vector<tile_t*>& tiles, std::vector<tile_t*>& completed);
+
+    tiled_engine_t(const tiled_engine_t&);
+    const tiled_engine_t& operator=(const tiled_engine_t&);
+};
+
+tiled_engine_t::tiled_engine_t(block_cyclic_mat_t& a, bool lower, blas_idx_t lookahead, task_pool_t& pool, MPI_Comm comm)
+    : m_lower(lower), m_lookahead(lookahead), m_pool(pool), m_comm(comm), m_progress(0), m_posted(0),
+      m_remaining(0), m_info(0)
+{
+    MPI_Comm_rank(comm, &m_rank);
+
+    blas_idx_t* desc = a.descriptor();
+    m_n      = a.global_rows();
+    m_nb     = a.col_block_size();
+    m_count  = (m_n + m_nb - 1) / m_nb;
+    m_nprows = a.grid()->nprows();
+    m_npcols = a.grid()->npcols();
+    m_rsrc   = desc[RSRC_];
+    m_csrc   = desc[CSRC_];
+
+    double*    local = a.local_data();
+    blas_idx_t lld   = desc[LLD_];
+
+    m_tiles.resize(index(m_count, 0));
+    m_column.assign(m_count, 0);
+    for (blas_idx_t i = 0; i < m_count; i ++)
+    {
+        for (blas_idx_t j = 0; j <= i; j ++)
+        {
+            tile_t& t = tile(i, j);
+            t.i     = i;
+            t.j     = j;
+            t.local = owner(t) == m_rank;
+            if (!t.local)
+                continue;
+
+            t.data = local + (block_row(t) / m_nprows) * m_nb + (block_col(t) / m_npcols) * m_nb * lld;
+            t.ld   = lld;
+            m_remaining ++;
+        }
+    }
+
+    // Count the reads of every tile by the owned tiles: the tiles of
+    // column k in row i and j for each update, and the diagonal tile for
+    // the TRSM
+    for (blas_idx_t i = 0; i < m_count; i ++)
+    {
+        for (blas_idx_t j = 0; j <= i; j ++)
+        {
+            if (!tile(i, j).local)
+                continue;
+            for (blas_idx_t k = 0; k < j; k ++)
+            {
+                use(i, k);
+                if (i != j)
+                    use(j, k);
+            }
+            if (i != j)
+                use(j, j);
+        }
+    }
+
+    // The processes each owned tile is sent to are the owners of the tiles
+    // that read it: the column below a diagonal tile, and the row and
+    // column of the trailing matrix through the diagonal of row a for
+    // tile (a, k)
+    std::vector<char> marked(size_t(m_nprows * m_npcols), 0);
+    for (size_t t = 0; t < m_tiles.size(); t ++)
+    {
+        tile_t& source = m_tiles[t];
+        if (!source.local)
+            continue;
+
+        std::vector<int> readers;
+        blas_idx_t a = source.i, k = source.j;
+        if (a == k)
+        {
+            for (blas_idx_t i = k + 1; i < m_count; i ++)
+                readers.push_back(owner(tile(i, k)));
+        }
+        else
+        {
+            for (blas_idx_t j = k + 1; j <= a; j ++)
+                readers.push_back(owner(tile(a, j)));
+            for (blas_idx_t i = a + 1; i < m_count; i ++)
+                readers.push_back(owner(tile(i, a)));
+        }
+
+        for (size_t r = 0; r < readers.size(); r ++)
+        {
+            if (readers[r] != m_rank && !marked[readers[r]])
+            {
+                marked[readers[r]] = 1;
+                source.dests.push_back(readers[r]);
+            }
+        }
+        for (size_t r = 0; r < source.dests.size(); r ++)
+            marked[source.dests[r]] = 0;
+    }
+}
+
+int tiled_engine_t::owner(const tile_t& t) const
+{
+    blas_idx_t prow = (block_row(t) + m_rsrc) % m_nprows;
+    blas_idx_t pcol = (block_col(t) + m_csrc) % m_npcols;
+    return int(prow * m_npcols + pcol);
+}
+
+void tiled_engine_t::use(blas_idx_t a, blas_idx_t k)
+{
+    tile(a, k).uses ++;
+    m_column[k] ++;
+}
+
+// Called when a task has read tile t; a received copy is freed once no
+// task is left to read it
+void tiled_engine_t::release(tile_t& t)
+{
+    assert(t.uses > 0);
+    t.uses --;
+    m_column[t.j] --;
+    if (t.uses == 0 && !t.local)
+    {
+        std::vector<double>().swap(t.buffer);
+        t.data = NULL;
+    }
+}
+
+// Posts the receives of the tiles of the panels up to lookahead beyond
+// the first one that local tasks still have to read
+void tiled_engine_t::post_receives()
+{
+    while (m_progress < m_count && m_column[m_progress] == 0)
+        m_progress ++;
+
+    for (; m_posted < m_count && m_posted <= m_progress + m_lookahead; m_posted ++)
+    {
+        blas_idx_t k = m_posted;
+        for (blas_idx_t a = k; a < m_count; a ++)
+        {
+            tile_t& t = tile(a, k);
+            if (t.local || t.uses == 0)
+                continue;
+
+            t.buffer.resize(size_t(rows(t)) * cols(t));
+            t.data = &t.buffer[0];
+            t.ld   = rows(t);
+
+            MPI_Request request;
+            MPI_Irecv(t.data, int(t.buffer.size()), MPI_DOUBLE, owner(t), int(index(a, k)), m_comm, &request);
+            m_recvs.push_back(request);
+            m_recv_tiles.push_back(&t);
+        }
+    }
+}
+
+// Queues the next task of an owned tile if the tiles it reads are
+// available: update k = t.next while k < j, then the POTRF or TRSM
+void tiled_engine_t::schedule(tile_t& t)
+{
+    if (!t.local || t.busy || t.done)
+        return;
+
+    bool       lower = m_lower;
+    blas_idx_t i = t.i, j = t.j, k = t.next;
+    double*    a   = t.data;
+    blas_idx_t lda = t.ld;
+    task_pool_t::task_t task;
+    bool       urgent = true;
+
+    if (k < j)
+    {
+        tile_t& tik = tile(i, k);
+        tile_t& tjk = tile(j, k);
+        if (!tik.available || !tjk.available)
+            return;
+
+        blas_idx_t m = size(i), n = size(j), kb = size(k);
+        double*    li = tik.data;
+        double*    lj = tjk.data;
+        blas_idx_t ldi = tik.ld, ldj = tjk.ld;
+        if (i == j)
+            task = [=]() { syrk_tile(lower, m, kb, li, ldi, a, lda); };
+        else
+            task = [=]() { gemm_tile(lower, m, n, kb, li, ldi, lj, ldj, a, lda); };
+        urgent = j <= k + m_lookahead;
+    }
+    else
+    {
+        // The final value is packed for sending by the task itself
+        double*    packed = NULL;
+        blas_idx_t r = rows(t), c = cols(t);
+        if (!t.dests.empty())
+        {
+            t.buffer.resize(size_t(r) * c);
+            packed = &t.buffer[0];
+        }
+
+        blas_idx_t m = size(i), n = size(j);
+        if (i == j)
+        {
+            blas_idx_t* info = &t.info;
+            task = [=]() {
+                potrf_tile(lower, m, a, lda, *info);
+                if (packed != NULL)
+                    pack_tile(a, lda, r, c, packed);
+            };
+        }
+        else
+        {
+            tile_t& tjj = tile(j, j);
+            if (!tjj.available)
+                return;
+
+            double*    l   = tjj.data;
+            blas_idx_t ldl = tjj.ld;
+            task = [=]() {
+                trsm_tile(lower, m, n, l, ldl, a, lda);
+                if (packed != NULL)
+                    pack_tile(a, lda, r, c, packed);
+            };
+        }
+    }
+
+    t.busy = true;
+    m_pool.submit(task, index(i, j), urgent);
+}
+
+void tiled_engine_t::finish(tile_t& t)
+{
+    t.busy = false;
+    if (t.next < t.j)
+    {
+        blas_idx_t k = t.next ++;
+        release(tile(t.i, k));
+        if (t.i != t.j)
+            release(tile(t.j, k));
+        schedule(t);
+        return;
+    }
+
+    t.done      = true;
+    t.available = true;
+    m_remaining --;
+    if (t.i == t.j)
+    {
+        // The first failure in the order PxPOTRF would meet it
+        blas_idx_t info = t.j * m_nb + t.info;
+        if (t.info > 0 && (m_info == 0 || info < m_info))
+            m_info = info;
+    }
+    else
+    {
+        release(tile(t.j, t.j));
+    }
+
+    send(t);
+    notify(t);
+}
+
+// Schedules the owned tiles that read tile t, now that it is available
+void tiled_engine_t::notify(tile_t& t)
+{
+    blas_idx_t a = t.i, k = t.j;
+    if (a == k)
+    {
+        for (blas_idx_t i = k + 1; i < m_count; i ++)
+            schedule(tile(i, k));
+        return;
+    }
+
+    for (blas_idx_t j = k + 1; j <= a; j ++)
+        schedule(tile(a, j));
+    for (blas_idx_t i = a + 1; i < m_count; i ++)
+        schedule(tile(i, a));
+}
+
+void tiled_engine_t::send(tile_t& t)
+{
+    for (size_t d = 0; d < t.dests.size(); d ++)
+    {
+        MPI_Request request;
+        MPI_Isend(&t.buffer[0], int(t.buffer.size()), MPI_DOUBLE, t.dests[d], int(index(t.i, t.j)), m_comm, &request);
+        m_sends.push_back(request);
+        m_send_tiles.push_back(&t);
+    }
+    t.sends = t.dests.size();
+}
+
+// Tests the outstanding requests, appends the tiles of the completed ones
+// and removes them from the lists
+size_t tiled_engine_t::test(std::vector<MPI_Request>& requests, std::vector<tile_t*>& tiles,
+    std::vector<tile_t*>& completed)
+{
+    if (requests.empty())
+        return 0;
+
+    int count = 0;
+    m_indices.resize(requests.size());
+    MPI_Testsome(int(requests.size()), &requests[0], &count, &m_indices[0], MPI_STATUSES_IGNORE);
+    if (count == MPI_UNDEFINED || count == 0)
+        return 0;
+
+    for (int c = 0; c < count; c ++)
+        completed.push_back(tiles[m_indices[c]]);
+
+    size_t kept = 0;
+    for (size_t r = 0; r < requests.size(); r ++)
+    {
+        if (requests[r] == MPI_REQUEST_NULL)
+            continue;
+        requests[kept] = requests[r];
+        tiles[kept]    = tiles[r];
+        kept ++;
+    }
+    requests.resize(kept);
+    tiles.resize(kept);
+    return size_t(count);
+}
+
+blas_idx_t tiled_engine_t::run(tiled_stats_t& stats)
+{
+    post_receives();
+    for (size_t t = 0; t < m_tiles.size(); t ++)
+        schedule(m_tiles[t]);
+
+    std::vector<tile_t*> completed;
+    while (m_remaining > 0 || !m_recvs.empty() || !m_sends.empty())
+    {
+        // Block on the workers only when no message is in flight
+        bool wait = m_recvs.empty() && m_sends.empty();
+        assert(!wait || m_pool.pending() > 0);
+
+        m_done.clear();
+        m_pool.drain(m_done, wait);
+        for (size_t d = 0; d < m_done.size(); d ++)
+            finish(m_tiles[m_done[d]]);
+
+        completed.clear();
+        stats.received += double(test(m_recvs, m_recv_tiles, completed));
+        for (size_t c = 0; c < completed.size(); c ++)
+        {
+            completed[c]->available = true;
+            notify(*completed[c]);
+        }
+
+        completed.clear();
+        stats.sent += double(test(m_sends, m_send_tiles, completed));
+        for (size_t c = 0; c < completed.size(); c ++)
+        {
+            if (-- completed[c]->sends == 0)
+                std::vector<double>().swap(completed[c]->buffer);
+        }
+
+        post_receives();
+    }
+    return m_info;
+}
+
+tiled_cholesky_t::tiled_cholesky_t(std::shared_ptr<block_cyclic_mat_t> a, char uplo /*= 'U'*/,
+    blas_idx_t threads /*= 0*/, blas_idx_t lookahead /*= 1*/)
+    : m_a(a), m_uplo(uplo), m_threads(threads), m_lookahead(lookahead)
+{
+    assert(a->global_rows() == a->global_cols());
+    assert(a->row_block_size() == a->col_block_size());
+    assert(uplo == 'U' || uplo == 'u' || uplo == 'L' || uplo == 'l');
+    assert(lookahead >= 0);
+}
+
+blas_idx_t tiled_cholesky_t::factor()
+{
+    trace_scope_t scope("tiled_potrf");
+    m_stats = tiled_stats_t();
+
+    // Tiles are matched by their index in the lower triangle
+    blas_idx_t n     = m_a->global_rows();
+    blas_idx_t count = (n + m_a->col_block_size() - 1) / m_a->col_block_size();
+    int*       tag_ub = NULL;
+    int        flag   = 0;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &flag);
+    if (flag && double(count) * (count + 1) / 2 - 1 > double(*tag_ub))
+        return -1;
+
+    MPI_Comm comm;
+    MPI_Comm_dup(m_a->grid()->comm(), &comm);
+
+    double     t0 = MPI_Wtime();
+    blas_idx_t info;
+    {
+        task_pool_t    pool(m_threads);
+        tiled_engine_t engine(*m_a, m_uplo == 'L' || m_uplo == 'l', m_lookahead, pool, comm);
+        info = engine.run(m_stats);
+
+        m_stats.elapsed = MPI_Wtime() - t0;
+        m_stats.threads = double(pool.threads());
+        m_stats.tasks   = double(pool.tasks());
+        m_stats.steals  = double(pool.steals());
+        m_stats.busy    = pool.busy();
+    }
+    m_a->mark_modified();
+
+    // The first failure over all processes
+    double first = info > 0 ? double(info) : double(n + 1);
+    MPI_Allreduce(MPI_IN_PLACE, &first, 1, MPI_DOUBLE, MPI_MIN, comm);
+    MPI_Comm_free(&comm);
+    return first <= double(n) ? blas_idx_t(first) : 0;
+}
+
+const tiled_stats_t& tiled_cholesky_t::stats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,133 @@
+// -*- mode: c++ -*-
+#ifndef _TILED_CHOLESKY_H_
+#define _TILED_CHOLESKY_H_
+
+#include <memory>
+#include "block_cyclic_mat.h"
+
+/// <summary>
+///   The work done by a tiled factorization on the calling process.
+/// </summary>
+struct tiled_stats_t
+{
+    /// <summary>
+    ///   The number of worker threads.
+    /// </summary>
+    double threads;
+
+    /// <summary>
+    ///   The tile tasks run, and those of them that a worker stole from
+    ///   the deque of another.
+    /// </summary>
+    double tasks;
+    double steals;
+
+    /// <summary>
+    ///   The tile messages sent and received.
+    /// </summary>
+    double sent;
+    double received;
+
+    /// <summary>
+    ///   The seconds the workers spent in tile tasks, summed over the
+    ///   workers, and the wall clock seconds of the factorization.
+    /// </summary>
+    double busy;
+    double elapsed;
+
+    tiled_stats_t() : threads(0.0), tasks(0.0), steals(0.0), sent(0.0), received(0.0), busy(0.0), elapsed(0.0) {}
+
+    /// <summary>
+    ///   Returns the fraction of the time the workers were running tasks,
+    ///   from 0 to 1. The rest is time spent waiting for tiles to arrive
+    ///   or for the tasks they depend on.
+    /// </summary>
+    double utilization() const;
+};
+
+/// <summary>
+///   A Cholesky factorization that runs as a graph of tile tasks instead of
+///   the panel by panel steps of PxPOTRF, and produces the same factor.
+/// </summary>
+/// <remark>
+///   The MB_A x NB_A blocks of the matrix are the tiles. Tile (i, j) of the
+///   factor L is final once it has received the j updates
+///     SYRK: A(i, i) -= L(i, k) L(i, k)^T, or
+///     GEMM: A(i, j) -= L(i, k) L(j, k)^T,
+///   for k = 0 to j - 1 in turn, followed by
+///     POTRF: A(j, j) = L(j, j) L(j, j)^T on the diagonal, or
+///     TRSM: L(i, j) = A(i, j) L(j, j)^-T below it.
+///   Each process runs the tasks on the tiles it owns as soon as the tiles
+///   they read are available, so the next panels are factorized while the
+///   trailing matrix is still being updated, and no process waits for a
+///   whole step to finish on the others. The upper factor is computed in
+///   the same way on the transposed tiles.
+///
+///   Every process keeps the bookkeeping of its tasks on the thread that
+///   calls factor(), which hands ready tasks to a task_pool_t and makes all
+///   MPI calls, so MPI only needs to be initialized with
+///   MPI_THREAD_FUNNELED. A finished tile of L is sent straight to the
+///   processes that read it: those owning tiles in its row and column of
+///   the trailing matrix. Receives are posted for the tiles of the next
+///   lookahead + 1 panels that the process has not finished with, which
+///   bounds the memory held by tiles of other processes while the sends
+///   and receives proceed behind the tile tasks.
+///
+///   Updates to the tiles of the next lookahead panels, and the POTRF and
+///   TRSM tasks, are queued as urgent, ahead of the rest of the trailing
+///   update. The tile kernels are the serial BLAS and LAPACK routines, so
+///   the library should be linked sequential, as it is by default.
+///
+///   The matrix must be square with square blocks, and is factorized as a
+///   whole. As with PxPOTRF only the triangle given by uplo is referenced
+///   and overwritten, and the result can be passed to PxPOTRS.
+/// </remark>
+class tiled_cholesky_t
+{
+public:
+    /// <summary>
+    ///   Creates a factorization of the given matrix. No work is done until
+    ///   factor() is called.
+    /// </summary>
+    /// <param name="uplo">
+    ///   'U' for A = U^T U as factorization_t computes it (DEFAULT), or 'L'
+    ///   for A = L L^T.
+    /// </param>
+    /// <param name="threads">
+    ///   The number of worker threads per process, or zero for the default
+    ///   of task_pool_t.
+    /// </param>
+    /// <param name="lookahead">
+    ///   The number of panels beyond the current one whose updates are
+    ///   urgent and whose tiles are received early (DEFAULT 1).
+    /// </param>
+    tiled_cholesky_t(std::shared_ptr<block_cyclic_mat_t> a, char uplo = 'U', blas_idx_t threads = 0,
+        blas_idx_t lookahead = 1);
+
+    /// <summary>
+    ///   Overwrites the matrix with its Cholesky factor and returns INFO as
+    ///   PxPOTRF would, which is zero on success and K if the leading minor
+    ///   of order K is not positive definite, or -1 if the matrix has more
+    ///   tiles than there are MPI tags. Every process in the grid must call
+    ///   this method.
+    /// </summary>
+    blas_idx_t factor();
+
+    /// <summary>
+    ///   Returns the statistics of the last call to factor().
+    /// </summary>
+    const tiled_stats_t& stats() const;
+
+private:
+    std::shared_ptr<block_cyclic_mat_t> m_a;
+    char                                m_uplo;
+    blas_idx_t                          m_threads;
+    blas_idx_t                          m_lookahead;
+    tiled_stats_t                       m_stats;
+
+    // Mark this class as non-copyable
+    tiled_cholesky_t(const tiled_cholesky_t&);
+    const tiled_cholesky_t& operator=(const tiled_cholesky_t&);
+};
+
+#endif // _TILED_CHOLESKY_H_
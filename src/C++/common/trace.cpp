@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <mpi.h>
+#include "trace.h"
+
+bool trace_t::s_enabled = false;
+
+struct trace_event_t
+{
+    const char*         name;
+    trace_t::category_t category;
+    double              start;
+    double              duration;
+    double              bytes;
+};
+
+// The totals of the calling process, kept as doubles so that they can be
+// gathered in one message
+enum {LIBRARY_TIME, NESTED_MESSAGE_TIME, MESSAGE_TIME, BYTES_SENT, POINT_TO_POINT_CALLS, COLLECTIVE_CALLS,
+    EVENTS, DROPPED_EVENTS, SUMMARY_SIZE};
+
+static std::string                s_prefix;
+static std::vector<trace_event_t> s_events;
+static size_t                     s_limit  = 0;
+static double                     s_origin = 0.0;
+static int                        s_depth  = 0;
+static double                     s_summary[SUMMARY_SIZE];
+
+static const char* category_name(trace_t::category_t category)
+{
+    switch (category)
+    {
+    case trace_t::BLACS:          return "blacs";
+    case trace_t::POINT_TO_POINT: return "mpi";
+    case trace_t::COLLECTIVE:     return "collective";
+    default:                      return "library";
+    }
+}
+
+void trace_t::enable(const std::string& prefix)
+{
+    // Events beyond the limit are counted but not kept, which bounds the
+    // memory taken by long runs
+    const char* limit = getenv("SCALAPACK_TRACE_LIMIT");
+    s_limit  = limit && atol(limit) > 0 ? size_t(atol(limit)) : size_t(1) << 20;
+    s_prefix = prefix;
+    s_depth  = 0;
+    s_events.clear();
+    std::fill(s_summary, s_summary + SUMMARY_SIZE, 0.0);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    s_origin  = MPI_Wtime();
+    s_enabled = true;
+}
+
+void trace_t::enter()
+{
+    s_depth ++;
+}
+
+void trace_t::leave()
+{
+    s_depth --;
+}
+
+void trace_t::record(const char* name, category_t category, double start, double bytes /*= 0.0*/)
+{
+    double duration = MPI_Wtime() - start;
+    if (category == POINT_TO_POINT || category == COLLECTIVE)
+    {
+        s_summary[MESSAGE_TIME]   += duration;
+        s_summary[BYTES_SENT] += bytes;
+        s_summary[category == COLLECTIVE ? COLLECTIVE_CALLS : POINT_TO_POINT_CALLS] ++;
+        if (s_depth > 0)
+            s_summary[NESTED_MESSAGE_TIME] += duration;
+    }
+    else if (s_depth == 0)
+    {
+        // Only the outermost library call counts, since the calls it
+        // makes are already part of its time
+        s_summary[LIBRARY_TIME] += duration;
+    }
+
+    if (s_events.size() < s_limit)
+    {
+        trace_event_t e = {name, category, start - s_origin, duration, bytes};
+        s_events.push_back(e);
+        s_summary[EVENTS] ++;
+    }
+    else
+    {
+        s_summary[DROPPED_EVENTS] ++;
+    }
+}
+
+// Formats the events of the calling process as Chrome trace events, each
+// followed by a comma
+static std::string format_events(int rank)
+{
+    std::string text;
+    char line[256];
+    sprintf(line, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}},\n",
+        rank, rank);
+    text += line;
+    for (size_t i = 0; i < s_events.size(); i ++)
+    {
+        const trace_event_t& e = s_events[i];
+        sprintf(line, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": 0, "
+            "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"bytes\": %.0f}},\n",
+            e.name, category_name(e.category), rank, e.start * 1e6, e.duration * 1e6, e.bytes);
+        text += line;
+    }
+    return text;
+}
+
+void trace_t::finish()
+{
+    if (!s_enabled)
+        return;
+
+    // The MPI calls below are not traced
+    s_enabled = false;
+
+    int rank, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    std::vector<double> summaries(rank == 0 ? nprocs * SUMMARY_SIZE : 0);
+    MPI_Gather(s_summary, SUMMARY_SIZE, MPI_DOUBLE, summaries.data(), SUMMARY_SIZE, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    std::string text = format_events(rank);
+    int length = int(text.size());
+    std::vector<int> lengths(nprocs), offsets(nprocs);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<char> all;
+    if (rank == 0)
+    {
+        for (int i = 1; i < nprocs; i ++)
+            offsets[i] = offsets[i - 1] + lengths[i - 1];
+        all.resize(offsets[nprocs - 1] + lengths[nprocs - 1]);
+    }
+    MPI_Gatherv(&text[0], length, MPI_CHAR, all.data(), lengths.data(), offsets.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    s_events.clear();
+    if (rank != 0)
+        return;
+
+    std::string name = s_prefix + ".json";
+    FILE* out = fopen(name.c_str(), "w");
+    if (out)
+    {
+        // Drop the comma after the last event
+        fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        fwrite(all.data(), 1, all.size() - 2, out);
+        fprintf(out, "\n]}\n");
+        fclose(out);
+    }
+    else
+    {
+        printf("Unable to write %s\n", name.c_str());
+    }
+
+    name = s_prefix + ".summary.csv";
+    out  = fopen(name.c_str(), "w");
+    if (!out)
+    {
+        printf("Unable to write %s\n", name.c_str());
+        return;
+    }
+    fprintf(out, "rank,library_seconds,compute_seconds,mpi_in_library_seconds,mpi_seconds,"
+        "bytes_sent,point_to_point_calls,collective_calls,events,dropped_events\n");
+    for (int i = 0; i < nprocs; i ++)
+    {
+        const double* s = &summaries[i * SUMMARY_SIZE];
+        fprintf(out, "%d,%.9g,%.9g,%.9g,%.9g,%.0f,%.0f,%.0f,%.0f,%.0f\n", i,
+            s[LIBRARY_TIME], s[LIBRARY_TIME] - s[NESTED_MESSAGE_TIME], s[NESTED_MESSAGE_TIME], s[MESSAGE_TIME],
+            s[BYTES_SENT], s[POINT_TO_POINT_CALLS], s[COLLECTIVE_CALLS], s[EVENTS], s[DROPPED_EVENTS]);
+    }
+    fclose(out);
+}
+
+void trace_scope_t::start()
+{
+    trace_t::enter();
+    m_start = MPI_Wtime();
+}
+
+void trace_scope_t::stop()
+{
+    trace_t::leave();
+    if (trace_t::enabled())
+        trace_t::record(m_name, m_category, m_start);
+}
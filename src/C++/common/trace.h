@@ -0,0 +1,118 @@
+// -*- mode: c++ -*-
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <string>
+
+/// <summary>
+///   Opt-in per-process tracing of ScaLAPACK, BLACS and MPI calls.
+/// </summary>
+/// <remark>
+///   Tracing is off unless the SCALAPACK_TRACE environment variable names
+///   an output prefix when MPI_Init is called, or enable() is called. The
+///   MPI side is recorded by the PMPI wrappers in trace_mpi.cpp, which
+///   take the place of the MPI functions the samples and, where MPI is
+///   linked dynamically, the ScaLAPACK library call. Library calls are
+///   recorded by trace_scope_t objects in scalapack_traits and the other
+///   wrappers. While tracing is off each of them costs one test of a
+///   flag.
+///
+///   On MPI_Finalize every process sends its events to process 0, which
+///   writes PREFIX.json in the Chrome trace event format, with one track
+///   per rank (load it in chrome://tracing or Perfetto), and
+///   PREFIX.summary.csv with one row per rank. The summary splits the
+///   time spent in library calls into compute and MPI time and counts
+///   the bytes sent and the point-to-point and collective calls.
+///
+///   Timestamps are relative to a barrier taken when tracing starts.
+///   Tracing is not thread-safe, so MPI and library calls must be made
+///   from one thread. Calls that ScaLAPACK makes through the Fortran MPI
+///   bindings, or through an MPI library linked into another DLL as with
+///   MS-MPI on Windows, are not seen by the PMPI wrappers.
+/// </remark>
+class trace_t
+{
+public:
+    /// <summary>
+    ///   The kind of a traced call.
+    ///     LIBRARY: A ScaLAPACK or LAPACK routine.
+    ///     BLACS: A BLACS routine.
+    ///     POINT_TO_POINT: An MPI send, receive or wait.
+    ///     COLLECTIVE: An MPI collective operation.
+    /// </summary>
+    enum category_t {LIBRARY, BLACS, POINT_TO_POINT, COLLECTIVE};
+
+    /// <summary>
+    ///   Returns true if calls are being recorded.
+    /// </summary>
+    static bool enabled() { return s_enabled; }
+
+    /// <summary>
+    ///   Starts recording calls made by the calling process. Every process
+    ///   must call this method, after MPI_Init.
+    /// </summary>
+    /// <param name="prefix">
+    ///   The prefix of the files written when tracing stops.
+    /// </param>
+    static void enable(const std::string& prefix);
+
+    /// <summary>
+    ///   Records a call that started at the given MPI_Wtime and ends now.
+    ///   The name must stay valid until tracing stops, such as a string
+    ///   literal.
+    /// </summary>
+    /// <param name="bytes">
+    ///   For MPI calls, the bytes sent by the calling process.
+    /// </param>
+    static void record(const char* name, category_t category, double start, double bytes = 0.0);
+
+    /// <summary>
+    ///   Marks the start and end of a library call, so that the MPI calls
+    ///   made inside it are counted as part of it.
+    /// </summary>
+    static void enter();
+    static void leave();
+
+    /// <summary>
+    ///   Stops recording and writes the trace and the summary. Every process
+    ///   must call this method; the MPI_Finalize wrapper calls it.
+    /// </summary>
+    static void finish();
+
+private:
+    static bool s_enabled;
+};
+
+/// <summary>
+///   Records the library call made during the lifetime of the object
+///   when tracing is enabled.
+/// </summary>
+class trace_scope_t
+{
+public:
+    explicit trace_scope_t(const char* name, trace_t::category_t category = trace_t::LIBRARY)
+        : m_name(name), m_category(category), m_start(-1.0)
+    {
+        if (trace_t::enabled())
+            start();
+    }
+
+    ~trace_scope_t()
+    {
+        if (m_start >= 0.0)
+            stop();
+    }
+
+private:
+    const char*         m_name;
+    trace_t::category_t m_category;
+    double              m_start;
+
+    void start();
+    void stop();
+
+    trace_scope_t(const trace_scope_t&);
+    const trace_scope_t& operator=(const trace_scope_t&);
+};
+
+#endif // _TRACE_H_
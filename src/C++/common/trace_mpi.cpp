@@ -0,0 +1,305 @@
+#include <cstdlib>
+
+#include <mpi.h>
+#include "trace.h"
+
+// PMPI wrappers that record MPI calls while tracing is enabled. Each one
+// tests the flag and otherwise goes straight to the PMPI entry point.
+// The buffer arguments are const from MPI 3 on, and in MS-MPI.
+
+#if MPI_VERSION >= 3 || defined(MSMPI_VER)
+#define TRACE_CONST const
+#else
+#define TRACE_CONST
+#endif
+
+#ifndef MPIAPI
+#define MPIAPI
+#endif
+
+static double message_bytes(int count, MPI_Datatype datatype)
+{
+    int size = 0;
+    PMPI_Type_size(datatype, &size);
+    return double(count) * size;
+}
+
+static bool is_root(int root, MPI_Comm comm)
+{
+    int rank;
+    PMPI_Comm_rank(comm, &rank);
+    return rank == root;
+}
+
+static int comm_size(MPI_Comm comm)
+{
+    int size;
+    PMPI_Comm_size(comm, &size);
+    return size;
+}
+
+static int sum(TRACE_CONST int counts[], int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; i ++)
+        total += counts[i];
+    return total;
+}
+
+// Tracing starts in MPI_Init if SCALAPACK_TRACE names an output prefix
+static void start_from_environment()
+{
+    const char* prefix = getenv("SCALAPACK_TRACE");
+    if (prefix && *prefix)
+        trace_t::enable(prefix);
+}
+
+int MPIAPI MPI_Init(int* argc, char*** argv)
+{
+    int rc = PMPI_Init(argc, argv);
+    start_from_environment();
+    return rc;
+}
+
+int MPIAPI MPI_Init_thread(int* argc, char*** argv, int required, int* provided)
+{
+    int rc = PMPI_Init_thread(argc, argv, required, provided);
+    start_from_environment();
+    return rc;
+}
+
+int MPIAPI MPI_Finalize()
+{
+    trace_t::finish();
+    return PMPI_Finalize();
+}
+
+int MPIAPI MPI_Send(TRACE_CONST void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Send(buf, count, datatype, dest, tag, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Send(buf, count, datatype, dest, tag, comm);
+    trace_t::record("MPI_Send", trace_t::POINT_TO_POINT, t0, message_bytes(count, datatype));
+    return rc;
+}
+
+int MPIAPI MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status* status)
+{
+    if (!trace_t::enabled())
+        return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    trace_t::record("MPI_Recv", trace_t::POINT_TO_POINT, t0);
+    return rc;
+}
+
+int MPIAPI MPI_Isend(TRACE_CONST void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm,
+    MPI_Request* request)
+{
+    if (!trace_t::enabled())
+        return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+    trace_t::record("MPI_Isend", trace_t::POINT_TO_POINT, t0, message_bytes(count, datatype));
+    return rc;
+}
+
+int MPIAPI MPI_Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm,
+    MPI_Request* request)
+{
+    if (!trace_t::enabled())
+        return PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+    trace_t::record("MPI_Irecv", trace_t::POINT_TO_POINT, t0);
+    return rc;
+}
+
+int MPIAPI MPI_Sendrecv(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+    void* recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status* status)
+{
+    if (!trace_t::enabled())
+        return PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+            recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+        recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+    trace_t::record("MPI_Sendrecv", trace_t::POINT_TO_POINT, t0, message_bytes(sendcount, sendtype));
+    return rc;
+}
+
+int MPIAPI MPI_Wait(MPI_Request* request, MPI_Status* status)
+{
+    if (!trace_t::enabled())
+        return PMPI_Wait(request, status);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Wait(request, status);
+    trace_t::record("MPI_Wait", trace_t::POINT_TO_POINT, t0);
+    return rc;
+}
+
+int MPIAPI MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[])
+{
+    if (!trace_t::enabled())
+        return PMPI_Waitall(count, requests, statuses);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Waitall(count, requests, statuses);
+    trace_t::record("MPI_Waitall", trace_t::POINT_TO_POINT, t0);
+    return rc;
+}
+
+int MPIAPI MPI_Barrier(MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Barrier(comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Barrier(comm);
+    trace_t::record("MPI_Barrier", trace_t::COLLECTIVE, t0);
+    return rc;
+}
+
+int MPIAPI MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Bcast(buffer, count, datatype, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Bcast(buffer, count, datatype, root, comm);
+    trace_t::record("MPI_Bcast", trace_t::COLLECTIVE, t0,
+        is_root(root, comm) ? message_bytes(count, datatype) : 0.0);
+    return rc;
+}
+
+int MPIAPI MPI_Reduce(TRACE_CONST void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
+    int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    trace_t::record("MPI_Reduce", trace_t::COLLECTIVE, t0, message_bytes(count, datatype));
+    return rc;
+}
+
+int MPIAPI MPI_Allreduce(TRACE_CONST void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
+    MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    trace_t::record("MPI_Allreduce", trace_t::COLLECTIVE, t0, message_bytes(count, datatype));
+    return rc;
+}
+
+int MPIAPI MPI_Gather(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_t::record("MPI_Gather", trace_t::COLLECTIVE, t0, message_bytes(sendcount, sendtype));
+    return rc;
+}
+
+int MPIAPI MPI_Gatherv(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, TRACE_CONST int recvcounts[], TRACE_CONST int displs[], MPI_Datatype recvtype,
+    int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    trace_t::record("MPI_Gatherv", trace_t::COLLECTIVE, t0, message_bytes(sendcount, sendtype));
+    return rc;
+}
+
+int MPIAPI MPI_Allgather(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    trace_t::record("MPI_Allgather", trace_t::COLLECTIVE, t0, message_bytes(sendcount, sendtype));
+    return rc;
+}
+
+int MPIAPI MPI_Allgatherv(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, TRACE_CONST int recvcounts[], TRACE_CONST int displs[], MPI_Datatype recvtype, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+    trace_t::record("MPI_Allgatherv", trace_t::COLLECTIVE, t0, message_bytes(sendcount, sendtype));
+    return rc;
+}
+
+int MPIAPI MPI_Scatter(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_t::record("MPI_Scatter", trace_t::COLLECTIVE, t0,
+        is_root(root, comm) ? message_bytes(sendcount, sendtype) * comm_size(comm) : 0.0);
+    return rc;
+}
+
+int MPIAPI MPI_Scatterv(TRACE_CONST void* sendbuf, TRACE_CONST int sendcounts[], TRACE_CONST int displs[],
+    MPI_Datatype sendtype, void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_t::record("MPI_Scatterv", trace_t::COLLECTIVE, t0,
+        is_root(root, comm) ? message_bytes(sum(sendcounts, comm_size(comm)), sendtype) : 0.0);
+    return rc;
+}
+
+int MPIAPI MPI_Alltoall(TRACE_CONST void* sendbuf, int sendcount, MPI_Datatype sendtype,
+    void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    trace_t::record("MPI_Alltoall", trace_t::COLLECTIVE, t0, message_bytes(sendcount, sendtype) * comm_size(comm));
+    return rc;
+}
+
+int MPIAPI MPI_Alltoallv(TRACE_CONST void* sendbuf, TRACE_CONST int sendcounts[], TRACE_CONST int sdispls[],
+    MPI_Datatype sendtype, void* recvbuf, TRACE_CONST int recvcounts[], TRACE_CONST int rdispls[],
+    MPI_Datatype recvtype, MPI_Comm comm)
+{
+    if (!trace_t::enabled())
+        return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+
+    double t0 = MPI_Wtime();
+    int rc = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+    trace_t::record("MPI_Alltoallv", trace_t::COLLECTIVE, t0,
+        message_bytes(sum(sendcounts, comm_size(comm)), sendtype));
+    return rc;
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cassert>
+
+#include <mpi.h>
+#include "lapack.h"
+#include "trace.h"
+#include "tsqr.h"
+#include "workspace_pool.h"
+
+// Computes the QR factorization of the m x n matrix A and applies Q^T to
+// the m x nrhs matrix C, both in place
+static blas_idx_t local_qr(blas_idx_t m, blas_idx_t n, double* a, blas_idx_t lda,
+    blas_idx_t nrhs, double* c, blas_idx_t ldc)
+{
+    blas_idx_t k = std::min(m, n), info = 0;
+    if (k == 0)
+        return 0;
+
+    trace_scope_t scope("dgeqrf");
+
+    std::vector<double> tau(k);
+    blas_idx_t lwork = -1;
+    double     size;
+    dgeqrf_(m, n, a, lda, tau.data(), &size, lwork, info);
+    if (nrhs > 0)
+    {
+        char side = 'L', trans = 'T';
+        double ormqr_size;
+        dormqr_(side, trans, m, nrhs, k, a, lda, tau.data(), c, ldc, &ormqr_size, lwork, info);
+        size = std::max(size, ormqr_size);
+    }
+
+    lwork = blas_idx_t(size);
+    workspace_t<double> work(lwork);
+    dgeqrf_(m, n, a, lda, tau.data(), work.data(), lwork, info);
+    if (info == 0 && nrhs > 0)
+    {
+        char side = 'L', trans = 'T';
+        dormqr_(side, trans, m, nrhs, k, a, lda, tau.data(), c, ldc, work.data(), lwork, info);
+    }
+    return info;
+}
+
+// Copies the R factor (the upper triangle of the first rows of A) and
+// the first rows of C into the n x (n + nrhs) column-major matrix [R C],
+// padding with zeros if there are fewer than n rows
+static void extract(blas_idx_t m, blas_idx_t n, const double* a, blas_idx_t lda,
+    blas_idx_t nrhs, const double* c, blas_idx_t ldc, double* rc)
+{
+    std::fill(rc, rc + n * (n + nrhs), 0.0);
+    for (blas_idx_t j = 0; j < n; j ++)
+    {
+        for (blas_idx_t i = 0; i <= j && i < m; i ++)
+            rc[i + j * n] = a[i + j * lda];
+    }
+    for (blas_idx_t j = 0; j < nrhs; j ++)
+    {
+        for (blas_idx_t i = 0; i < n && i < m; i ++)
+            rc[i + (n + j) * n] = c[i + j * ldc];
+    }
+}
+
+// Combines the [R C] blocks of all processes up a binary tree, leaving
+// the R factor of A and Q^T B in the [R C] block of rank 0
+static blas_idx_t reduce(MPI_Comm comm, blas_idx_t n, blas_idx_t nrhs, std::vector<double>& rc)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    const blas_idx_t cols  = n + nrhs;
+    const int        count = int(n * cols);
+    std::vector<double> received(count), stacked(2 * n * cols);
+
+    blas_idx_t info = 0;
+    for (int step = 1; step < size; step *= 2)
+    {
+        if (rank % (2 * step) == step)
+        {
+            MPI_Send(rc.data(), count, MPI_DOUBLE, rank - step, step, comm);
+            break;
+        }
+
+        if (rank + step >= size)
+            continue;
+
+        MPI_Recv(received.data(), count, MPI_DOUBLE, rank + step, step, comm, MPI_STATUS_IGNORE);
+
+        // Stack the two blocks and factor the result
+        blas_idx_t ld = 2 * n;
+        for (blas_idx_t j = 0; j < cols; j ++)
+        {
+            std::copy_n(&rc[j * n],       n, &stacked[j * ld]);
+            std::copy_n(&received[j * n], n, &stacked[j * ld + n]);
+        }
+        blas_idx_t result = local_qr(ld, n, stacked.data(), ld, nrhs, stacked.data() + n * ld, ld);
+        info = info ? info : result;
+        extract(ld, n, stacked.data(), ld, nrhs, stacked.data() + n * ld, ld, rc.data());
+    }
+    return info;
+}
+
+// Factors the local rows and reduces the [R C] blocks to rank 0
+static blas_idx_t factor(block_cyclic_mat_t& a, block_cyclic_mat_t* b, std::vector<double>& rc)
+{
+    assert(a.grid()->npcols() == 1);
+    assert(!b || b->local_rows() == a.local_rows());
+
+    blas_idx_t m    = a.local_rows();
+    blas_idx_t n    = a.global_cols();
+    blas_idx_t nrhs = b ? b->global_cols() : 0;
+    blas_idx_t lda  = a.descriptor()[LLD_];
+    blas_idx_t ldb  = b ? b->descriptor()[LLD_] : 1;
+    double*    c    = b ? b->local_data() : nullptr;
+
+    blas_idx_t info = local_qr(m, n, a.local_data(), lda, nrhs, c, ldb);
+    a.mark_modified();
+    if (b)
+        b->mark_modified();
+
+    rc.resize(n * (n + nrhs));
+    extract(m, n, a.local_data(), lda, nrhs, c, ldb, rc.data());
+
+    blas_idx_t result = reduce(a.grid()->comm(), n, nrhs, rc);
+    return info ? info : result;
+}
+
+blas_idx_t tsqr(block_cyclic_mat_t& a, std::vector<double>& r)
+{
+    blas_idx_t info = factor(a, nullptr, r);
+
+    MPI_Bcast(r.data(), int(r.size()), MPI_DOUBLE, 0, a.grid()->comm());
+    MPI_Bcast(&info, int(sizeof(info)), MPI_BYTE, 0, a.grid()->comm());
+    return info;
+}
+
+blas_idx_t tsqr_solve(block_cyclic_mat_t& a, block_cyclic_mat_t& b, std::vector<double>& x)
+{
+    std::vector<double> rc;
+    blas_idx_t info = factor(a, &b, rc);
+
+    blas_idx_t n    = a.global_cols();
+    blas_idx_t nrhs = b.global_cols();
+    x.assign(rc.begin() + n * n, rc.end());
+
+    // Solve R X = Q^T B on rank 0 and share the solution
+    int rank;
+    MPI_Comm_rank(a.grid()->comm(), &rank);
+    if (rank == 0 && info == 0)
+    {
+        char uplo = 'U', trans = 'N', diag = 'N';
+        trace_scope_t scope("dtrtrs");
+        dtrtrs_(uplo, trans, diag, n, nrhs, rc.data(), n, x.data(), n, info);
+    }
+
+    MPI_Bcast(x.data(), int(x.size()), MPI_DOUBLE, 0, a.grid()->comm());
+    MPI_Bcast(&info, int(sizeof(info)), MPI_BYTE, 0, a.grid()->comm());
+    return info;
+}
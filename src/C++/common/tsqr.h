@@ -0,0 +1,37 @@
+// -*- mode: c++ -*-
+#ifndef _TSQR_H_
+#define _TSQR_H_
+
+#include <vector>
+#include "block_cyclic_mat.h"
+
+/// <remark>
+///   Communication-avoiding QR (TSQR) for tall and skinny matrices on a
+///   P x 1 grid. Every process computes the QR factorization of its own
+///   rows with LAPACK, then the R factors are combined pairwise up a
+///   binary tree, which takes log2(P) messages instead of the column
+///   broadcast per step of PxGEQRF. A block-cyclic row layout is fine,
+///   since a permutation of the rows does not change R or the least
+///   squares solution, but a single block of rows per process
+///   (MB_A = CEIL(M_A / P)) gives the largest local factorizations.
+///
+///   Both functions overwrite the local part of A with the Householder
+///   vectors of the local factorization, which are not kept afterwards.
+/// </remark>
+
+/// <summary>
+///   Computes the N x N upper triangular factor R of the M x N matrix A,
+///   returned in column-major order on every process. Returns INFO.
+/// </summary>
+blas_idx_t tsqr(block_cyclic_mat_t& a, std::vector<double>& r);
+
+/// <summary>
+///   Solves the least squares problem min ||A X - B||_2 for the M x N
+///   matrix A and M x NRHS matrix B, which must have the same row
+///   distribution. The N x NRHS solution is returned in column-major
+///   order on every process. B is overwritten. Returns INFO, which is
+///   positive if R is singular.
+/// </summary>
+blas_idx_t tsqr_solve(block_cyclic_mat_t& a, block_cyclic_mat_t& b, std::vector<double>& x);
+
+#endif // _TSQR_H_
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <mpi.h>
+#include "tuning.h"
+
+static bool            s_has_active = false;
+static tuning_config_t s_active;
+
+std::string tuner_t::filename()
+{
+    const char* env = getenv("SCALAPACK_TUNING_FILE");
+    if (env && *env)
+        return env;
+
+    char name[MPI_MAX_PROCESSOR_NAME];
+    int  length = 0;
+    MPI_Get_processor_name(name, &length);
+    return "scalapack_tuning." + std::string(name, length) + ".txt";
+}
+
+tuning_config_t tuner_t::autotune(const std::string& routine, blas_idx_t m, blas_idx_t n, probe_t probe)
+{
+    static const blas_idx_t block_sizes[] = {32, 64, 128, 256};
+    const int nsizes = sizeof(block_sizes)/sizeof(block_sizes[0]);
+
+    int iam, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iam);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    bool            had_active = s_has_active;
+    tuning_config_t saved      = s_active;
+
+    // Every candidate runs the same probe, so that their times compare:
+    // probe_blocks of the largest blocks per process along the longest
+    // grid dimension, as large as the problem at most
+    blas_idx_t side = probe_blocks * block_sizes[nsizes - 1] * nprocs;
+    blas_idx_t pm   = std::min(m, side);
+    blas_idx_t pn   = std::min(n, side);
+
+    tuning_config_t best = {0, 0, 0, 0, -1.0};
+    for (blas_idx_t nprows = 1; nprows <= nprocs; nprows ++)
+    {
+        if (nprocs % nprows)
+            continue;
+
+        auto grid = std::make_shared<blacs_grid_t>(nprows, nprocs/nprows);
+        for (int i = 0; i < nsizes; i ++)
+        {
+            for (int j = 0; j < nsizes; j ++)
+            {
+                if (m == n && i != j)
+                    continue;
+
+                tuning_config_t candidate = {nprows, nprocs/nprows, block_sizes[i], block_sizes[j], 0.0};
+                s_active     = candidate;
+                s_has_active = true;
+
+                MPI_Barrier(MPI_COMM_WORLD);
+                double t = probe(grid, pm, pn);
+                MPI_Allreduce(&t, &candidate.seconds, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+                if (best.seconds < 0 || candidate.seconds < best.seconds)
+                    best = candidate;
+            }
+        }
+    }
+
+    s_active     = saved;
+    s_has_active = had_active;
+
+    if (iam == 0)
+    {
+        std::string name = filename();
+        bool is_new = !std::ifstream(name.c_str()).good();
+        std::ofstream out(name.c_str(), std::ios::app);
+        if (is_new)
+            out << "# routine nprocs m n nprows npcols mb nb seconds\n";
+        out << routine << " " << nprocs << " " << m << " " << n << " " 
+            << best.nprows << " " << best.npcols << " " << best.mb << " " << best.nb << " " 
+            << best.seconds << "\n";
+    }
+    return best;
+}
+
+bool tuner_t::select(const std::string& routine, blas_idx_t m, blas_idx_t n)
+{
+    int iam, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iam);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    // found, nprows, npcols, mb, nb, seconds
+    double config[6] = {0.0};
+    if (iam == 0)
+    {
+        std::ifstream in(filename().c_str());
+        std::string line;
+        double best_distance = 0.0;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string name;
+            double p, mm, nn, r, c, mb, nb, seconds;
+            if (!(fields >> name >> p >> mm >> nn >> r >> c >> mb >> nb >> seconds))
+                continue;
+            if (name != routine || int(p) != nprocs)
+                continue;
+
+            // Problem sizes are compared on a log scale and later entries 
+            // win ties, so that re-tuning overrides older results
+            double distance = fabs(log(mm * nn) - log(double(m) * double(n)));
+            if (config[0] == 0.0 || distance <= best_distance)
+            {
+                double entry[6] = {1.0, r, c, mb, nb, seconds};
+                std::copy(entry, entry + 6, config);
+                best_distance = distance;
+            }
+        }
+    }
+    MPI_Bcast(config, 6, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    s_has_active = config[0] != 0.0;
+    if (s_has_active)
+    {
+        s_active.nprows  = blas_idx_t(config[1]);
+        s_active.npcols  = blas_idx_t(config[2]);
+        s_active.mb      = blas_idx_t(config[3]);
+        s_active.nb      = blas_idx_t(config[4]);
+        s_active.seconds = config[5];
+    }
+    return s_has_active;
+}
+
+void tuner_t::activate(const tuning_config_t& config)
+{
+    s_active     = config;
+    s_has_active = true;
+}
+
+const tuning_config_t* tuner_t::active()
+{
+    return s_has_active ? &s_active : nullptr;
+}
+
+void tuner_t::clear()
+{
+    s_has_active = false;
+}
@@ -0,0 +1,116 @@
+// -*- mode: c++ -*-
+#ifndef _TUNING_H_
+#define _TUNING_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "blacs_grid.h"
+
+/// <summary>
+///   A process grid shape and block size for a routine and problem size.
+/// </summary>
+struct tuning_config_t
+{
+    blas_idx_t nprows;
+    blas_idx_t npcols;
+    blas_idx_t mb;
+    blas_idx_t nb;
+    double     seconds;
+};
+
+/// <summary>
+///   A class that finds the fastest process grid shape and block size 
+///   for a ScaLAPACK routine and keeps the results in a per-machine 
+///   tuning file.
+/// </summary>
+/// <remark>
+///   Once a configuration has been selected, the default blacs_grid_t
+///   constructor uses its grid shape and the block_cyclic_mat_t factory 
+///   functions use its block sizes, so a driver only needs to call 
+///   select() before creating its grid and matrices.
+/// </remark>
+class tuner_t
+{
+public:
+    /// <summary>
+    ///   A function that runs one probe of the routine being tuned on the 
+    ///   given grid, for an M x N problem no larger than the one being
+    ///   tuned, and returns the time taken by the calling process. The
+    ///   candidate block sizes are active while the probe runs, so the 
+    ///   probe should create its matrices with the factory functions.
+    /// </summary>
+    typedef std::function<double(std::shared_ptr<blacs_grid_t>, blas_idx_t, blas_idx_t)> probe_t;
+
+    /// <summary>
+    ///   The number of the largest candidate blocks that each process
+    ///   holds along the longest grid dimension of a probe.
+    /// </summary>
+    static const blas_idx_t probe_blocks = 4;
+
+    /// <summary>
+    ///   Times every candidate configuration for the given routine and
+    ///   problem size, appends the fastest one to the tuning file and 
+    ///   returns it. Every process must call this method.
+    /// </summary>
+    /// <param name="routine">
+    ///   The name under which the result is stored, such as "gesv".
+    /// </param>
+    /// <param name="m">
+    ///   The global number of rows of the problem.
+    /// </param>
+    /// <param name="n">
+    ///   The global number of columns of the problem.
+    /// </param>
+    /// <param name="probe">
+    ///   The function that runs the routine once.
+    /// </param>
+    /// <remark>
+    ///   The candidates are every nprows x npcols factorization of the
+    ///   number of processes combined with block sizes from 32 to 256.
+    ///   Square problems only try square blocks. Every candidate is timed
+    ///   on the same probe, probe_blocks blocks of 256 per process on a
+    ///   1 x P or P x 1 grid and no larger than the problem, so that the
+    ///   sweep stays cheap for large problems while the times remain
+    ///   comparable. Square problems stay square. The configuration that
+    ///   was active before the sweep is restored afterwards.
+    /// </remark>
+    static tuning_config_t autotune(const std::string& routine, blas_idx_t m, blas_idx_t n, probe_t probe);
+
+    /// <summary>
+    ///   Looks up the tuning file for the configuration recorded for the 
+    ///   routine, the current number of processes and the nearest problem
+    ///   size, and makes it active. Returns false and clears the active 
+    ///   configuration if there is none. Every process must call this method.
+    /// </summary>
+    static bool select(const std::string& routine, blas_idx_t m, blas_idx_t n);
+
+    /// <summary>
+    ///   Makes the given configuration active without consulting the 
+    ///   tuning file, so that a benchmark can run with an explicit grid
+    ///   shape and block size. A grid shape that does not use every 
+    ///   process is ignored by the default blacs_grid_t constructor.
+    /// </summary>
+    static void activate(const tuning_config_t& config);
+
+    /// <summary>
+    ///   Returns the active configuration, or nullptr if there is none.
+    /// </summary>
+    static const tuning_config_t* active();
+
+    /// <summary>
+    ///   Clears the active configuration so that the defaults apply again.
+    /// </summary>
+    static void clear();
+
+    /// <summary>
+    ///   Returns the name of the tuning file, which is the value of the
+    ///   SCALAPACK_TUNING_FILE environment variable if it is set and
+    ///   scalapack_tuning.HOSTNAME.txt otherwise, where HOSTNAME is the
+    ///   processor name of the calling process. Only rank 0 reads and 
+    ///   writes the file.
+    /// </summary>
+    static std::string filename();
+};
+
+#endif // _TUNING_H_
@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include "workspace_pool.h"
+
+workspace_pool_t& workspace_pool_t::instance()
+{
+    static workspace_pool_t pool;
+    return pool;
+}
+
+workspace_pool_t::workspace_pool_t() : m_allocations(0)
+{
+}
+
+std::vector<double> workspace_pool_t::acquire(size_t bytes)
+{
+    // Doubles keep the buffer aligned for every element type
+    size_t count = std::max(size_t(1), (bytes + sizeof(double) - 1) / sizeof(double));
+
+    auto best = m_free.end();
+    for (auto it = m_free.begin(); it != m_free.end(); ++ it)
+    {
+        if (it->size() >= count && (best == m_free.end() || it->size() < best->size()))
+            best = it;
+    }
+
+    std::vector<double> buffer;
+    if (best != m_free.end())
+    {
+        buffer.swap(*best);
+        m_free.erase(best);
+    }
+    else
+    {
+        // Grow the largest cached buffer rather than keeping a second one
+        auto largest = std::max_element(m_free.begin(), m_free.end(),
+            [](const std::vector<double>& x, const std::vector<double>& y) { return x.size() < y.size(); });
+        if (largest != m_free.end())
+        {
+            buffer.swap(*largest);
+            m_free.erase(largest);
+            buffer.clear();
+            buffer.shrink_to_fit();
+        }
+        buffer.resize(count);
+        m_allocations ++;
+    }
+    return buffer;
+}
+
+void workspace_pool_t::release(std::vector<double>& buffer)
+{
+    if (!buffer.empty())
+    {
+        m_free.push_back(std::vector<double>());
+        m_free.back().swap(buffer);
+    }
+}
+
+bool workspace_pool_t::find_query(const std::string& routine, const std::vector<blas_idx_t>& args, std::vector<blas_idx_t>& sizes) const
+{
+    auto it = m_queries.find(query_key_t(routine, args));
+    if (it == m_queries.end())
+        return false;
+    sizes = it->second;
+    return true;
+}
+
+void workspace_pool_t::store_query(const std::string& routine, const std::vector<blas_idx_t>& args, const std::vector<blas_idx_t>& sizes)
+{
+    m_queries[query_key_t(routine, args)] = sizes;
+}
+
+std::vector<blas_idx_t> workspace_pool_t::cached_query(const std::string& routine, const std::vector<blas_idx_t>& args,
+    std::function<std::vector<blas_idx_t>()> query)
+{
+    std::vector<blas_idx_t> sizes;
+    if (!find_query(routine, args, sizes))
+    {
+        sizes = query();
+        store_query(routine, args, sizes);
+    }
+    return sizes;
+}
+
+void workspace_pool_t::clear()
+{
+    m_free.clear();
+    m_queries.clear();
+}
+
+size_t workspace_pool_t::cached_bytes() const
+{
+    size_t bytes = 0;
+    for (auto it = m_free.begin(); it != m_free.end(); ++ it)
+        bytes += it->size() * sizeof(double);
+    return bytes;
+}
+
+size_t workspace_pool_t::allocations() const
+{
+    return m_allocations;
+}
@@ -0,0 +1,133 @@
+// -*- mode: c++ -*-
+#ifndef _WORKSPACE_POOL_H_
+#define _WORKSPACE_POOL_H_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "index.h"
+
+/// <summary>
+///   A class that keeps the workspace buffers of ScaLAPACK routines, and
+///   the sizes returned by their workspace queries, across calls.
+/// </summary>
+/// <remark>
+///   Buffers are handed out by workspace_t and come back to the pool when
+///   the workspace_t is destroyed, so a routine called in a loop allocates
+///   its workspace once. The pool is not thread safe; ScaLAPACK routines
+///   are called from a single thread per process.
+/// </remark>
+class workspace_pool_t
+{
+public:
+    /// <summary>
+    ///   Returns the process-wide pool used by the wrappers in scalapack_api.h.
+    /// </summary>
+    static workspace_pool_t& instance();
+
+    workspace_pool_t();
+
+    /// <summary>
+    ///   Returns a buffer of at least the given number of bytes, reusing
+    ///   the smallest cached buffer that is large enough.
+    /// </summary>
+    std::vector<double> acquire(size_t bytes);
+
+    /// <summary>
+    ///   Returns a buffer obtained from acquire() to the pool.
+    /// </summary>
+    void release(std::vector<double>& buffer);
+
+    /// <summary>
+    ///   Looks up the result of a workspace query made by the named routine
+    ///   (such as "pdgetri") with the given arguments, which must include 
+    ///   every argument the query depends on. Returns false if the query
+    ///   has not been made yet.
+    /// </summary>
+    bool find_query(const std::string& routine, const std::vector<blas_idx_t>& args, std::vector<blas_idx_t>& sizes) const;
+
+    /// <summary>
+    ///   Records the result of a workspace query.
+    /// </summary>
+    void store_query(const std::string& routine, const std::vector<blas_idx_t>& args, const std::vector<blas_idx_t>& sizes);
+
+    /// <summary>
+    ///   Returns the sizes from a workspace query, calling query to make it
+    ///   only the first time the routine is seen with the given arguments.
+    /// </summary>
+    std::vector<blas_idx_t> cached_query(const std::string& routine, const std::vector<blas_idx_t>& args, 
+        std::function<std::vector<blas_idx_t>()> query);
+
+    /// <summary>
+    ///   Frees every cached buffer and forgets every workspace query.
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    ///   Returns the number of bytes held by cached buffers.
+    /// </summary>
+    size_t cached_bytes() const;
+
+    /// <summary>
+    ///   Returns the number of requests that needed a new allocation.
+    /// </summary>
+    size_t allocations() const;
+
+private:
+    typedef std::pair<std::string, std::vector<blas_idx_t> > query_key_t;
+
+    std::vector<std::vector<double> >                m_free;
+    std::map<query_key_t, std::vector<blas_idx_t> > m_queries;
+    size_t                                           m_allocations;
+
+    // Mark this class as non-copyable
+    workspace_pool_t(const workspace_pool_t&);
+    const workspace_pool_t& operator=(const workspace_pool_t&);
+};
+
+/// <summary>
+///   A workspace of count elements of type T, borrowed from a
+///   workspace_pool_t for the lifetime of the object.
+/// </summary>
+template <typename T>
+class workspace_t
+{
+public:
+    explicit workspace_t(size_t count, workspace_pool_t& pool = workspace_pool_t::instance())
+        : m_pool(pool), m_buffer(pool.acquire(count * sizeof(T))), m_count(count)
+    {
+    }
+
+    ~workspace_t()
+    {
+        m_pool.release(m_buffer);
+    }
+
+    /// <summary>
+    ///   Returns the first element of the workspace. The contents are
+    ///   left over from previous users of the buffer.
+    /// </summary>
+    T* data()
+    {
+        return reinterpret_cast<T*>(m_buffer.data());
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+private:
+    workspace_pool_t&   m_pool;
+    std::vector<double> m_buffer;
+    size_t              m_count;
+
+    // Mark this class as non-copyable
+    workspace_t(const workspace_t&);
+    const workspace_t& operator=(const workspace_t&);
+};
+
+#endif // _WORKSPACE_POOL_H_
@@ -0,0 +1,360 @@
+#include <mpi.h>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "benchmark.h"
+#include "block_cyclic_mat.h"
+#include "generators.h"
+#include "scalapack.h"
+#include "scalapack_api.h"
+#include "trace.h"
+#include "workspace_pool.h"
+
+static const double pi = 3.14159265358979323846;
+
+// Returns the sizes from a workspace query, which is only made the first
+// time the routine is called with a given descriptor and order
+static std::vector<blas_idx_t> query_workspace(const char* routine, block_cyclic_mat_t& a, blas_idx_t n,
+    std::function<std::vector<blas_idx_t>()> query)
+{
+    std::vector<blas_idx_t> args(a.descriptor(), a.descriptor() + DLEN_);
+    args.push_back(n);
+    return workspace_pool_t::instance().cached_query(routine, args, query);
+}
+
+// Prints the INFO of a failed ScaLAPACK call on process 0 and returns true
+// if the call failed
+static bool failed(std::shared_ptr<blacs_grid_t> grid, const char* routine, blas_idx_t info)
+{
+    if (info != 0 && grid->iam() == 0)
+    {
+        printf("%s failed with INFO = %d\n", routine, info); fflush(stdout);
+    }
+    return info != 0;
+}
+
+// Copies the diagonal and the subdiagonal of A to every process in the grid
+static void gather_tridiagonal(block_cyclic_mat_t& a, std::vector<double>& d, std::vector<double>& e)
+{
+    auto grid = a.grid();
+    blas_idx_t n      = a.global_rows();
+    blas_idx_t mb     = a.row_block_size(), nb = a.col_block_size();
+    blas_idx_t nprows = grid->nprows(), npcols = grid->npcols();
+    blas_idx_t* desc  = a.descriptor();
+    blas_idx_t mypcol = (grid->mypcol() - desc[CSRC_] + npcols) % npcols;
+    const double* local = a.local_data();
+
+    d.assign(n, 0.0);
+    e.assign(n, 0.0);
+    for (blas_idx_t jl = 0; jl < a.local_cols(); jl ++)
+    {
+        blas_idx_t j = ((jl / nb) * npcols + mypcol) * nb + jl % nb;
+        for (blas_idx_t i = j; i <= j + 1 && i < n; i ++)
+        {
+            if ((i / mb + desc[RSRC_]) % nprows != grid->myprow())
+                continue;
+
+            blas_idx_t il = (i / (mb * nprows)) * mb + i % mb;
+            double value  = local[il + jl * desc[LLD_]];
+            if (i == j)
+                d[j] = value;
+            else
+                e[j] = value;
+        }
+    }
+
+    // Every element is owned by exactly one process
+    MPI_Allreduce(MPI_IN_PLACE, d.data(), int(n), MPI_DOUBLE, MPI_SUM, grid->comm());
+    MPI_Allreduce(MPI_IN_PLACE, e.data(), int(n), MPI_DOUBLE, MPI_SUM, grid->comm());
+}
+
+// Computes the eigenvalues and eigenvectors of the symmetric tridiagonal
+// test matrix in the three phases of PxSYEVD: reduction to tridiagonal
+// form with PxSYTRD, the divide and conquer tridiagonal eigensolver
+// PxSTEDC and back-transformation of the eigenvectors with PxORMTR.
+// The error is the largest error in the eigenvalues. Returns false if a
+// phase fails.
+static bool symmetric_eigen(std::shared_ptr<blacs_grid_t> grid, blas_idx_t n, bool verify,
+    benchmark_result_t& result)
+{
+    // The -1, 2, -1 tridiagonal matrix, whose eigenvalues are known
+    auto a = block_cyclic_mat_t::constant(grid, n, n);
+    fill_tridiagonal(*a);
+    auto q = std::make_shared<block_cyclic_mat_t>(grid, n, n, a->row_block_size(), a->col_block_size());
+
+    char uplo = 'L';
+    blas_idx_t ia = 1, ja = 1, info = 0;
+    std::vector<double> d  (a->local_cols() + a->col_block_size());
+    std::vector<double> e  (a->local_cols() + a->col_block_size());
+    std::vector<double> tau(a->local_cols() + a->col_block_size());
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // Reduction to tridiagonal form
+    auto sizes = query_workspace("pdsytrd", *a, n, [&]() {
+        blas_idx_t lwork = -1;
+        double     size;
+        pdsytrd_(uplo, n, a->local_data(), ia, ja, a->descriptor(),
+            d.data(), e.data(), tau.data(), &size, lwork, info);
+        return std::vector<blas_idx_t>(1, blas_idx_t(size));
+    });
+    {
+        workspace_t<double> work(sizes[0]);
+        trace_scope_t scope("pdsytrd");
+        double t0 = MPI_Wtime();
+        pdsytrd_(uplo, n, a->local_data(), ia, ja, a->descriptor(),
+            d.data(), e.data(), tau.data(), work.data(), sizes[0], info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxSYTRD", info))
+            return false;
+    }
+
+    // Eigenvalues and eigenvectors of the tridiagonal matrix, which
+    // PxSTEDC expects on every process
+    char compz = 'I';
+    std::vector<double> dg, eg;
+    sizes = query_workspace("pdstedc", *q, n, [&]() {
+        blas_idx_t lwork = -1, liwork = -1;
+        double     size;
+        blas_idx_t isize;
+        pdstedc_(compz, n, d.data(), e.data(), q->local_data(), ia, ja, q->descriptor(),
+            &size, lwork, &isize, liwork, info);
+        std::vector<blas_idx_t> query_sizes(1, blas_idx_t(size));
+        query_sizes.push_back(isize);
+        return query_sizes;
+    });
+    {
+        workspace_t<double>     work (sizes[0]);
+        workspace_t<blas_idx_t> iwork(sizes[1]);
+        trace_scope_t scope("pdstedc");
+        double t0 = MPI_Wtime();
+        gather_tridiagonal(*a, dg, eg);
+        pdstedc_(compz, n, dg.data(), eg.data(), q->local_data(), ia, ja, q->descriptor(),
+            work.data(), sizes[0], iwork.data(), sizes[1], info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxSTEDC", info))
+            return false;
+    }
+
+    // Back-transformation of the eigenvectors
+    char side = 'L', trans = 'N';
+    sizes = query_workspace("pdormtr", *q, n, [&]() {
+        blas_idx_t lwork = -1;
+        double     size;
+        pdormtr_(side, uplo, trans, n, n,
+            a->local_data(), ia, ja, a->descriptor(), tau.data(),
+            q->local_data(), ia, ja, q->descriptor(),
+            &size, lwork, info);
+        return std::vector<blas_idx_t>(1, blas_idx_t(size));
+    });
+    {
+        workspace_t<double> work(sizes[0]);
+        trace_scope_t scope("pdormtr");
+        double t0 = MPI_Wtime();
+        pdormtr_(side, uplo, trans, n, n,
+            a->local_data(), ia, ja, a->descriptor(), tau.data(),
+            q->local_data(), ia, ja, q->descriptor(),
+            work.data(), sizes[0], info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxORMTR", info))
+            return false;
+    }
+
+    if (verify)
+    {
+        // PxSTEDC returns the eigenvalues in ascending order
+        double error = 0.0;
+        for (blas_idx_t k = 1; k <= n; k ++)
+        {
+            double exact = 2.0 - 2.0 * cos(k * pi / (n + 1));
+            error = std::max(error, fabs(dg[k - 1] - exact));
+        }
+        result.metrics.push_back(std::make_pair(std::string("Eigenvalue error"), error));
+    }
+    return true;
+}
+
+// Computes the Schur factorization A = Z T Z^T of a random matrix in three
+// phases: reduction to upper Hessenberg form with PxGEHRD, the QR iteration
+// PxLAHQR and back-transformation of the Schur vectors with PxORMHR.
+// The error is ||A Z - Z T||_F / ||A||_F. Returns false if a phase fails.
+static bool nonsymmetric_eigen(std::shared_ptr<blacs_grid_t> grid, blas_idx_t n, bool verify,
+    benchmark_result_t& result)
+{
+    auto a = block_cyclic_mat_t::random(grid, n, n);
+    auto z = block_cyclic_mat_t::diagonal(grid, n, n);
+
+    // Keep A for the residual
+    std::shared_ptr<block_cyclic_mat_t> a0;
+    if (verify)
+        a0 = std::make_shared<block_cyclic_mat_t>(*a);
+
+    blas_idx_t ilo = 1, ihi = n;
+    blas_idx_t ia = 1, ja = 1, info = 0;
+    std::vector<double> tau(a->local_cols() + a->col_block_size());
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // Reduction to upper Hessenberg form
+    auto sizes = query_workspace("pdgehrd", *a, n, [&]() {
+        blas_idx_t lwork = -1;
+        double     size;
+        pdgehrd_(n, ilo, ihi, a->local_data(), ia, ja, a->descriptor(),
+            tau.data(), &size, lwork, info);
+        return std::vector<blas_idx_t>(1, blas_idx_t(size));
+    });
+    {
+        workspace_t<double> work(sizes[0]);
+        trace_scope_t scope("pdgehrd");
+        double t0 = MPI_Wtime();
+        pdgehrd_(n, ilo, ihi, a->local_data(), ia, ja, a->descriptor(),
+            tau.data(), work.data(), sizes[0], info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxGEHRD", info))
+            return false;
+    }
+
+    // PxLAHQR needs an upper Hessenberg matrix, so work on a copy with the
+    // Householder vectors below the subdiagonal cleared
+    auto h = std::make_shared<block_cyclic_mat_t>(*a);
+    if (n > 2)
+    {
+        char lower = 'L';
+        blas_idx_t m = n - 2, ih = 3, jh = 1;
+        double zero = 0.0;
+        pdlaset_(lower, m, m, zero, zero, h->local_data(), ih, jh, h->descriptor());
+    }
+
+    // QR iteration, which leaves the Schur form T in H and accumulates the
+    // transformations in Z. The eigenvalues are replicated on every process.
+    blas_idx_t wantt = 1, wantz = 1, iloz = 1, ihiz = n;
+    std::vector<double>     wr(n), wi(n);
+    std::vector<blas_idx_t> iwork(1);
+    blas_idx_t              liwork = blas_idx_t(iwork.size());
+    sizes = query_workspace("pdlahqr", *h, n, [&]() {
+        // PxLAHQR has no workspace query, so use the documented minimum
+        // 3N + MAX(2 MAX(LLD_Z, LLD_A) + 2 LOCc(N), 7 CEIL(N/NB) / LCM(NPROW, NPCOL))
+        // with the LCM bounded below by 1
+        blas_idx_t lld   = std::max(h->descriptor()[LLD_], z->descriptor()[LLD_]);
+        blas_idx_t nb    = h->col_block_size();
+        blas_idx_t lwork = 3 * n + std::max(2 * lld + 2 * h->local_cols(), 7 * ((n + nb - 1) / nb));
+        return std::vector<blas_idx_t>(1, lwork);
+    });
+    {
+        workspace_t<double> work(sizes[0]);
+        trace_scope_t scope("pdlahqr");
+        double t0 = MPI_Wtime();
+        pdlahqr_(wantt, wantz, n, ilo, ihi, h->local_data(), h->descriptor(),
+            wr.data(), wi.data(), iloz, ihiz, z->local_data(), z->descriptor(),
+            work.data(), sizes[0], iwork.data(), liwork, info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxLAHQR", info))
+            return false;
+    }
+
+    // Back-transformation Z = Q Z, where Q is the orthogonal matrix of the
+    // Hessenberg reduction
+    char side = 'L', trans = 'N';
+    sizes = query_workspace("pdormhr", *z, n, [&]() {
+        blas_idx_t lwork = -1;
+        double     size;
+        pdormhr_(side, trans, n, n, ilo, ihi,
+            a->local_data(), ia, ja, a->descriptor(), tau.data(),
+            z->local_data(), ia, ja, z->descriptor(),
+            &size, lwork, info);
+        return std::vector<blas_idx_t>(1, blas_idx_t(size));
+    });
+    {
+        workspace_t<double> work(sizes[0]);
+        trace_scope_t scope("pdormhr");
+        double t0 = MPI_Wtime();
+        pdormhr_(side, trans, n, n, ilo, ihi,
+            a->local_data(), ia, ja, a->descriptor(), tau.data(),
+            z->local_data(), ia, ja, z->descriptor(),
+            work.data(), sizes[0], info);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (failed(grid, "PxORMHR", info))
+            return false;
+    }
+
+    if (verify)
+    {
+        // Verify the Schur factorization
+        auto r = block_cyclic_mat_t::constant(grid, n, n);
+        gemm(*a0, *z, *r);
+        gemm(*z, *h, *r, -1.0, 1.0);
+        result.metrics.push_back(std::make_pair(std::string("Schur residual"), lange(*r, 'F') / lange(*a0, 'F')));
+    }
+    return true;
+}
+
+// Solves the symmetric eigenvalue problem with the phases of PxSYEVD or,
+// with -nonsym, computes the real Schur form of a random matrix
+class eigen_benchmark_t : public benchmark_routine_t
+{
+public:
+    eigen_benchmark_t() : m_symmetric(true)
+    {
+    }
+
+    std::string name()      const { return m_symmetric ? "syevd" : "gehrd"; }
+    std::string title()     const { return "EIGENVALUE"; }
+    std::string sizes()     const { return "n"; }
+
+    // The positional arguments are N and the matrix, sym or nonsym
+    std::string arguments() const { return "n matrix"; }
+
+    std::vector<std::string> phases() const
+    {
+        std::vector<std::string> names;
+        names.push_back(m_symmetric ? "PxSYTRD" : "PxGEHRD");
+        names.push_back(m_symmetric ? "PxSTEDC" : "PxLAHQR");
+        names.push_back(m_symmetric ? "PxORMTR" : "PxORMHR");
+        return names;
+    }
+
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {4096, 4096, 4096, 1, 0, 0, 0, 0};
+        return c;
+    }
+
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "nonsym" || (key == "matrix" && value == "nonsym"))
+            m_symmetric = false;
+        else if (key == "matrix" && value == "sym")
+            m_symmetric = true;
+        else
+            return false;
+        return true;
+    }
+
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        return m_symmetric ? syevd_count(c.n, c.nprows, c.npcols) : schur_count(c.n, c.nprows, c.npcols);
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
+    {
+        return m_symmetric ? symmetric_eigen(grid, c.n, verify, result) : nonsymmetric_eigen(grid, c.n, verify, result);
+    }
+
+private:
+    bool m_symmetric;
+};
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  // Arguments are N and the matrix, which selects the symmetric (DEFAULT)
+  // or the nonsymmetric eigenvalue problem, and the options of
+  // run_benchmark
+  eigen_benchmark_t routine;
+  int status = run_benchmark(argc, argv, routine);
+
+  MPI_Finalize();
+  return status;
+}
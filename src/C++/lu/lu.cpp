@@ -1,115 +1,251 @@
 #include <mpi.h>
 #include <cstdio>
-#include <cassert>
+#include <cstdlib>
+#include "benchmark.h"
 #include "block_cyclic_mat.h"
+#include "butterfly.h"
+#include "generators.h"
+#include "mixed_precision.h"
 #include "scalapack.h"
+#include "scalapack_traits.h"
+#include "scalapack_api.h"
 
-static double gesv_flops(blas_idx_t N, blas_idx_t NR)
+// Solves AX = B with PxGESV, or in mixed precision, where A is random,
+// diagonally dominant or read from a file and B is filled with the value 42.
+// With -rbt the system is also solved by random butterfly transformation
+// and LU without pivoting, so that the two can be compared.
+class gesv_benchmark_t : public benchmark_routine_t
 {
-    // From:
-    // https://icl.cs.utk.edu/svn/scalapack-dev/scalapack/trunk/TESTING/LIN/pdludriver.f
-    // Factorization: 2/3 N^3 - 1/2 N^2
-    // Back solve   : NR * 2 N^2
+public:
+    gesv_benchmark_t() : m_a_file(), m_save_file(), m_mixed(false), m_dominant(false), m_rbt(false), m_depth(2), m_storage(false)
+    {
+    }
 
-    return ((2.0/3.0 * N * N * N) - (1.0/2.0 * N * N) + (NR * N * N))/1024.0/1024.0/1024.0;
-}
+    std::string name()  const { return "gesv"; }
+    std::string title() const { return "MATRIX SOLVE"; }
+    std::string sizes() const { return "n nrhs"; }
 
-static void lu_driver(blas_idx_t m_global, blas_idx_t n_global = 1)
-{
-    auto grid = std::make_shared<blacs_grid_t>();
+    // The positional arguments are N and the file to read A from
+    std::string arguments() const { return "n a_file"; }
 
-    // Create a MxM random matrix A
-    auto a = block_cyclic_mat_t::random(grid, m_global, m_global);    
+    std::vector<std::string> phases() const
+    {
+        std::vector<std::string> names(1, m_mixed ? "PSGETRF + refinement" : "PxGESV");
+        if (m_rbt)
+            names.push_back("RBT + refinement");
+        return names;
+    }
 
-    // Save the local data for A since it is overwritten during factorization
-    std::vector<double> a_save(a->local_data(), a->local_data() + a->local_size());
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {4096, 4096, 4096, 1, 0, 0, 0, 0};
+        return c;
+    }
 
-    // Compute the 1-norm of A
-    double norm_a = 0;
-    {        
-        blas_idx_t ia = 1, ja = 1;
-        char norm = '1';
-        std::vector<double> work(a->local_cols());
-        norm_a = pdlange_(norm, m_global, m_global, a->local_data(), ia, ja, a->descriptor(),
-            work.data());
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "a_file" && !value.empty())
+            m_a_file = value;
+        else if (key == "save_file" && !value.empty())
+            m_save_file = value;
+        else if (key == "mixed")
+            m_mixed = true;
+        else if (key == "dominant")
+            m_dominant = true;
+        else if (key == "rbt")
+            m_rbt = true;
+        else if (key == "depth" && atoi(value.c_str()) > 0)
+            m_depth = atoi(value.c_str());
+        else if (key == "storage")
+            m_storage = true;
+        else
+            return false;
+        return true;
     }
 
-    // Create a MxN right-hand-side matrix filled with the value 42
-    // This is overwritten with the solution of Ax = b
-    auto x = block_cyclic_mat_t::constant(grid, m_global, n_global, 42.0);
-
-    std::vector<blas_idx_t> ipiv(a->local_rows() + a->row_block_size() + 100);
-    blas_idx_t ia = 1, ja = 1;
-    blas_idx_t ib = 1, jb = 1;
-    blas_idx_t info;
-
-    MPI_Barrier (MPI_COMM_WORLD);
-    
-    // First compute Ax = b
-    double t0 = MPI_Wtime();    
-    pdgesv_ (m_global, n_global, 
-        a->local_data(), ia, ja, a->descriptor(), 
-        ipiv.data(), 
-        x->local_data(), ib, jb, x->descriptor(), info);
-    assert(info == 0);
-    double t1 = MPI_Wtime() - t0;
-
-    // Then form r = Ax - b
-    // This is done by first letting r = b
-    // followed by r = alpha * Ax + beta * r where alpha = 1.0, beta = -1.0    
-    auto r = block_cyclic_mat_t::constant(grid, m_global, n_global, 42.0);
-    char nein='N';
-    double alpha = 1.0;
-    double beta  = -1.0;
-    pdgemm_(nein, nein, m_global, n_global, m_global, 
-        alpha,        
-        a_save.data()  , ia, ja, a->descriptor(),
-        x->local_data(), ib, jb, x->descriptor(),
-        beta,
-        r->local_data(), ib, jb, r->descriptor());
-        
-    // Now compute Infinity norm of r
-    double norm_r = -2.0;
+    // The mixed precision and butterfly solvers are rated by the
+    // operations of PxGESV, as in HPL
+    perf_count_t model(const benchmark_case_t& c) const
     {
-        char norm='I';
-        std::vector<double> work(r->local_rows());
-        norm_r = pdlange_(norm, 
-            m_global, n_global, 
-            r->local_data(), ib, jb, r->descriptor(), 
-            work.data());
-    }    
-    
-    // Compute the error
-    // ||Ax - b||_oo/ (M x ||A||_1)
-
-    double err = norm_r/m_global/norm_a;
-    
-    double t_glob;
-    MPI_Reduce(&t1, &t_glob, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-
-    if (grid->iam() == 0) 
+        perf_count_t count = gesv_count(c.n, c.nrhs, c.nprows, c.npcols);
+        if (m_rbt)
+            count = count + gesv_count(c.n, c.nrhs, c.nprows, c.npcols);
+        return count;
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
     {
-        double gflops = gesv_flops(m_global, n_global)/t_glob/grid->nprocs();
-        printf("\n"
-            "MATRIX SOLVE BENCHMARK SUMMARY\n"
-            "==============================\n"
-            "N = %d\tNRHS = %d\tNP = %d\tNP_ROW = %d\tNP_COL = %d\n"
-            "Time for PxGESV = %10.7f seconds\tGflops/Proc = %10.7f, Error = %f\n",
-            m_global, n_global, grid->nprocs(), grid->nprows(), grid->npcols(), 
-            t_glob, gflops, err);fflush(stdout);
+        blas_idx_t m_global = c.n, n_global = c.nrhs;
+        const char* a_file  = m_a_file.empty() ? nullptr : m_a_file.c_str();
+        if (m_dominant && a_file)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("-dominant cannot be combined with a matrix file\n"); fflush(stdout);
+            }
+            return false;
+        }
+
+        // Create a MxM random matrix A, made diagonally dominant with
+        // -dominant, or read it in parallel from a_file
+        auto a = a_file ? block_cyclic_mat_t::from_file(grid, m_global, m_global, a_file)
+                        : block_cyclic_mat_t::random(grid, m_global, m_global);
+        if (!a)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Unable to read %d x %d matrix from %s\n", m_global, m_global, a_file); fflush(stdout);
+            }
+            return false;
+        }
+        if (m_dominant)
+            fill_diagonally_dominant(*a);
+
+        // Write the generated A to save_file, so that later runs can read
+        // the same matrix with a_file
+        if (!m_save_file.empty() && !a->save(m_save_file.c_str()))
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Unable to write %d x %d matrix to %s\n", m_global, m_global, m_save_file.c_str()); fflush(stdout);
+            }
+            return false;
+        }
+
+        // Report the placement and allocation time of A, a rank at a time
+        if (m_storage)
+        {
+            for (blas_idx_t p = 0; p < grid->nprocs(); p ++)
+            {
+                if (p == grid->iam())
+                    a->print_storage();
+                MPI_Barrier(MPI_COMM_WORLD);
+            }
+        }
+
+        // Save A since it is overwritten during factorization
+        std::shared_ptr<block_cyclic_mat_t> a_save;
+        if (verify || m_rbt)
+        {
+            a_save = std::make_shared<block_cyclic_mat_t>(*a);
+        }
+
+        // Create a MxN right-hand-side matrix filled with the value 42
+        // This is overwritten with the solution of Ax = b
+        auto x = block_cyclic_mat_t::constant(grid, m_global, n_global, 42.0);
+
+        // PxGESV needs LOCr(M_A) + MB_A pivots
+        std::vector<blas_idx_t> ipiv(a->local_rows() + a->row_block_size());
+        blas_idx_t ia = 1, ja = 1;
+        blas_idx_t ib = 1, jb = 1;
+        blas_idx_t info;
+        refinement_result_t refinement = {0, 0, 0.0, false};
+
+        MPI_Barrier (MPI_COMM_WORLD);
+
+        double t0 = MPI_Wtime();
+        if (m_mixed)
+        {
+            // Factorize in single precision and refine in double precision,
+            // which leaves A intact
+            auto b = block_cyclic_mat_t::constant(grid, m_global, n_global, 42.0);
+            refinement = mixed_precision_solve(a, b, x);
+            info = refinement.info;
+        }
+        else
+        {
+            scalapack_traits<double>::gesv (m_global, n_global, 
+                a->local_data(), ia, ja, a->descriptor(), 
+                ipiv.data(), 
+                x->local_data(), ib, jb, x->descriptor(), info);
+        }
+        result.t.push_back(MPI_Wtime() - t0);
+        if (info != 0)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Factorization failed with INFO = %d\n", info); fflush(stdout);
+            }
+            return false;
+        }
+
+        if (m_rbt && !run_rbt(a_save, c.nrhs, result))
+            return false;
+
+        if (verify)
+        {
+            // Form r = Ax - b and compute the error ||Ax - b||_oo / (M x ||A||_1)
+            auto r = block_cyclic_mat_t::constant(grid, m_global, n_global, 42.0);
+            gemm(*a_save, *x, *r, 1.0, -1.0);
+            double err = lange(*r, 'I')/m_global/lange(*a_save, '1');
+            result.metrics.push_back(std::make_pair(std::string("Error"), err));
+            if (m_mixed)
+            {
+                result.metrics.push_back(std::make_pair(std::string("Refinement iterations"), double(refinement.iterations)));
+                result.metrics.push_back(std::make_pair(std::string("Fell back"), refinement.fell_back ? 1.0 : 0.0));
+            }
+        }
+        return true;
     }
-}
+
+private:
+    std::string m_a_file;
+    std::string m_save_file;
+    bool        m_mixed;
+    bool        m_dominant;
+    bool        m_rbt;
+    blas_idx_t  m_depth;
+    bool        m_storage;
+
+    // Solves the system again with rbt_solve, which leaves A intact, and
+    // compares its time with that of the first solver. The error is always
+    // reported, since the butterflies only make pivoting unnecessary with
+    // high probability. Returns false if the butterfly solver fails.
+    bool run_rbt(std::shared_ptr<block_cyclic_mat_t> a, blas_idx_t nrhs, benchmark_result_t& result)
+    {
+        auto grid = a->grid();
+        blas_idx_t n = a->global_rows();
+        auto b = block_cyclic_mat_t::constant(grid, n, nrhs, 42.0);
+        auto x = block_cyclic_mat_t::constant(grid, n, nrhs);
+
+        MPI_Barrier (MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        refinement_result_t rbt = rbt_solve(a, b, x, m_depth);
+        result.t.push_back(MPI_Wtime() - t0);
+        if (rbt.info != 0)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Butterfly solve failed with INFO = %d\n", rbt.info); fflush(stdout);
+            }
+            return false;
+        }
+
+        // The times are the maximum over the processes, as in the summary
+        double t[2] = {result.t[0], result.t[1]};
+        MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        result.metrics.push_back(std::make_pair(std::string("RBT speedup"), t[0] / t[1]));
+        result.metrics.push_back(std::make_pair(std::string("RBT error"), rbt.error));
+        result.metrics.push_back(std::make_pair(std::string("RBT refinement iterations"), double(rbt.iterations)));
+        result.metrics.push_back(std::make_pair(std::string("RBT fell back"), rbt.fell_back ? 1.0 : 0.0));
+        return true;
+    }
+};
 
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
-  blas_idx_t n_global = 4096;
-  
-  if (argc > 1)
-  {
-    n_global = blas_idx_t(atol(argv[1]));
-  }
-
-  lu_driver(n_global);
+
+  // Arguments are N, the file to read A from and the options of
+  // run_benchmark, plus -mixed for the mixed precision solver,
+  // -dominant for a generated diagonally dominant A (not allowed with a
+  // file), -rbt to compare with the random butterfly solver of
+  // depth=LEVELS (DEFAULT 2), -storage to print the storage of A on every
+  // rank and save_file=PATH to write A in the format read by a_file
+  gesv_benchmark_t routine;
+  int status = run_benchmark(argc, argv, routine);
+
   MPI_Finalize();
+  return status;
 }
@@ -1,77 +1,207 @@
 #include <mpi.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "benchmark.h"
 #include "block_cyclic_mat.h"
-#include "scalapack.h"
-
-static double gemm_flops(blas_idx_t M, blas_idx_t N, blas_idx_t K)
+#include "gemm_25d.h"
+#include "scalapack_traits.h"
+
+// Multiplies A and B with PxGEMM and, given a plan, again with gemm_25d,
+// storing the times and the comparison of the two in result
+template <typename T>
+static void gemm_run(std::shared_ptr<blacs_grid_t> grid, blas_idx_t m_global, blas_idx_t n_global, blas_idx_t k_global,
+    const gemm_25d_plan_t* plan, bool verify, benchmark_result_t& result)
 {
-    return (2.0 * M * N * K)/(1024.0 * 1024.0 * 1024.0);
-}
+    typedef basic_block_cyclic_mat_t<T> mat_t;
+    typedef scalapack_traits<T>         traits;
 
-static void dgemm_driver(blas_idx_t m_global, blas_idx_t n_global, blas_idx_t k_global)
-{
-    auto grid = std::make_shared<blacs_grid_t>();
-
-    auto a = block_cyclic_mat_t::random(grid, m_global, k_global);
-    auto b = block_cyclic_mat_t::random(grid, k_global, n_global);
-    auto c = block_cyclic_mat_t::random(grid, m_global, n_global);
+    auto a = mat_t::random(grid, m_global, k_global);
+    auto b = mat_t::random(grid, k_global, n_global);
+    auto c = mat_t::random(grid, m_global, n_global);
 
     MPI_Barrier(MPI_COMM_WORLD);
 
-    double alpha = 1.0, beta = 0.0;
+    T alpha = T(1), beta = T();
 
     double t0 = MPI_Wtime();
     char NEIN = 'N';
     blas_idx_t ia = 1, ja = 1, ib = 1, jb = 1, ic = 1, jc = 1;
 
-    pdgemm_ (NEIN, NEIN, m_global, n_global, k_global, 
+    traits::gemm (NEIN, NEIN, m_global, n_global, k_global, 
         alpha, 
         a->local_data(), ia, ja, a->descriptor(), 
         b->local_data(), ib, jb, b->descriptor(),
         beta,
         c->local_data(), ic, jc, c->descriptor());
-    double t1 = MPI_Wtime() - t0;
-
-    double t_glob;
-    MPI_Reduce(&t1, &t_glob, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD); 
-
-    if (grid->iam() == 0) 
-    { 
-        double gflops = gemm_flops(m_global, n_global, k_global)/t_glob/grid->nprocs();
-
-        printf("\n"
-            "MATRIX MULTIPLY BENCHMARK SUMMARY\n"
-            "=================================\n"
-            "M = %d\tN = %d\tK = %d\tNP = %d\tNP_ROW = %d\tNP_COL = %d\n"
-            "Time for PxGEMM = %10.7f seconds\tGFlops/Proc = %10.7f\n", 
-            m_global, n_global, k_global, grid->nprocs(), grid->nprows(), grid->npcols(),
-            t_glob, gflops); fflush(stdout);
+    result.t.push_back(MPI_Wtime() - t0);
+    if (!plan)
+        return;
+
+    auto c25 = mat_t::constant(grid, m_global, n_global);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    t0 = MPI_Wtime();
+    blas_idx_t layers = gemm_25d(*plan, *a, *b, *c25, alpha, beta);
+    result.t.push_back(MPI_Wtime() - t0);
+
+    // The times are the maximum over the processes, as in the summary
+    double t[2] = {result.t[0], result.t[1]};
+    MPI_Allreduce(MPI_IN_PLACE, t, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    result.metrics.push_back(std::make_pair(std::string("2.5D layers"), double(layers)));
+    result.metrics.push_back(std::make_pair(std::string("2.5D speedup"), t[0] / t[1]));
+
+    if (verify)
+    {
+        // max |C_2.5D - C| / max |C|
+        double diff[2] = {0.0, 0.0};
+        for (blas_idx_t i = 0; i < c->local_size(); i ++)
+        {
+            diff[0] = std::max(diff[0], double(std::abs(c25->local_data()[i] - c->local_data()[i])));
+            diff[1] = std::max(diff[1], double(std::abs(c->local_data()[i])));
+        }
+        MPI_Allreduce(MPI_IN_PLACE, diff, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        result.metrics.push_back(std::make_pair(std::string("2.5D difference"), diff[0] / diff[1]));
     }
 }
 
-int main(int argc, char** argv)
+// Multiplies random M x K and K x N matrices in the selected precision,
+// with PxGEMM and optionally also with the 2.5D algorithm of gemm_25d
+class gemm_benchmark_t : public benchmark_routine_t
 {
-    MPI_Init(&argc, &argv);
+public:
+    gemm_benchmark_t() : m_precision('d'), m_layers(-1)
+    {
+    }
 
-    blas_idx_t m_global = 4096;
-    blas_idx_t n_global = 4096;
-    blas_idx_t k_global = 4096;
+    std::string name()  const { return "gemm"; }
+    std::string title() const { return "MATRIX MULTIPLY"; }
+    std::string sizes() const { return "m n k"; }
 
+    // The precision is s, d, c or z as in the ScaLAPACK routine names
+    std::string arguments() const { return "m n k precision"; }
 
-    if (argc > 1)
+    std::vector<std::string> phases() const
     {
-        m_global = blas_idx_t(atol(argv[1]));
+        std::vector<std::string> names(1, std::string(prefix()) + "gemm");
+        if (m_layers >= 0)
+            names.push_back("2.5D " + std::string(prefix()) + "gemm");
+        return names;
     }
 
-    if (argc > 2)
+    benchmark_case_t defaults() const
     {
-        n_global = blas_idx_t(atol(argv[2]));
+        benchmark_case_t c = {4096, 4096, 4096, 1, 0, 0, 0, 0};
+        return c;
     }
 
-    if (argc > 3)
+    // -25d adds the 2.5D multiply with the number of layers chosen from
+    // the free memory, and layers=COUNT sets it
+    bool set_option(const std::string& key, const std::string& value)
     {
-        k_global = blas_idx_t(atol(argv[3]));
+        if (key == "precision" && value.size() == 1 && strchr("sdcz", value[0]))
+            m_precision = value[0];
+        else if (key == "25d")
+            m_layers = std::max(m_layers, blas_idx_t(0));
+        else if (key == "layers" && atoi(value.c_str()) > 0)
+            m_layers = atoi(value.c_str());
+        else
+            return false;
+        return true;
     }
-    
-    dgemm_driver(m_global, n_global, k_global);
+
+    // The layers are those of the plan the case ran with, so that model
+    // makes no collective calls
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        bool is_complex = m_precision == 'c' || m_precision == 'z';
+        perf_count_t count = gemm_count(c.m, c.n, c.k, c.nprows, c.npcols, element_size(), is_complex);
+        if (m_layers < 0)
+            return count;
+
+        blas_idx_t layers = m_plan ? m_plan->layers() : std::max(m_layers, blas_idx_t(1));
+        return count + gemm_25d_count(c.m, c.n, c.k, c.nprows * c.npcols, layers, element_size(), is_complex);
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
+    {
+        if (m_layers > 0 && grid->nprocs() % m_layers != 0)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("%d layers do not divide %d processes\n", m_layers, grid->nprocs()); fflush(stdout);
+            }
+            return false;
+        }
+
+        // The context, layer grids and communicators of gemm_25d are set up
+        // outside the timed multiply, and kept while the layers stay the same
+        if (m_layers >= 0)
+        {
+            blas_idx_t layers = m_layers > 0 ? m_layers : gemm_25d_layers(c.m, c.n, c.k, element_size());
+            if (!m_plan || m_plan->layers() != layers)
+            {
+                m_plan.reset();
+                m_plan = std::make_shared<gemm_25d_plan_t>(layers);
+            }
+        }
+
+        const gemm_25d_plan_t* plan = m_plan.get();
+        switch (m_precision)
+        {
+        case 's': gemm_run<float>               (grid, c.m, c.n, c.k, plan, verify, result); break;
+        case 'c': gemm_run<std::complex<float> > (grid, c.m, c.n, c.k, plan, verify, result); break;
+        case 'z': gemm_run<std::complex<double> >(grid, c.m, c.n, c.k, plan, verify, result); break;
+        default : gemm_run<double>              (grid, c.m, c.n, c.k, plan, verify, result); break;
+        }
+        return true;
+    }
+
+private:
+    char                             m_precision;
+    blas_idx_t                       m_layers;
+    std::shared_ptr<gemm_25d_plan_t> m_plan;
+
+    size_t element_size() const
+    {
+        switch (m_precision)
+        {
+        case 's': return sizeof(float);
+        case 'c': return sizeof(std::complex<float>);
+        case 'z': return sizeof(std::complex<double>);
+        default : return sizeof(double);
+        }
+    }
+
+    const char* prefix() const
+    {
+        switch (m_precision)
+        {
+        case 's': return scalapack_traits<float>::prefix();
+        case 'c': return scalapack_traits<std::complex<float> >::prefix();
+        case 'z': return scalapack_traits<std::complex<double> >::prefix();
+        default : return scalapack_traits<double>::prefix();
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    // Arguments are M, N, K, the precision and the options of run_benchmark,
+    // plus -25d to compare PxGEMM with the 2.5D multiply side by side and
+    // layers=COUNT for its number of layers (DEFAULT chosen from the free
+    // memory). The routine holds the plan of gemm_25d, which must be freed
+    // before MPI_Finalize.
+    int status;
+    {
+        gemm_benchmark_t routine;
+        status = run_benchmark(argc, argv, routine);
+    }
+
     MPI_Finalize();
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,170 @@
+#include <mpi.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "benchmark.h"
+#include "counter_rng.h"
+#include "generators.h"
+#include "out_of_core.h"
+#include "scalapack_api.h"
+
+// The element (i, j) of the test matrix: uniform random values in (0,1),
+// symmetric and with 2N added to the diagonal for Cholesky so that the
+// matrix is positive definite
+struct test_matrix_t
+{
+    counter_rng_t rng;
+    blas_idx_t    n;
+    bool          spd;
+
+    double operator()(blas_idx_t i, blas_idx_t j) const
+    {
+        if (!spd)
+            return rng.uniform<double>(uint64_t(i), uint64_t(j));
+        double value = rng.uniform<double>(uint64_t(std::min(i, j)), uint64_t(std::max(i, j)));
+        return i == j ? value + 2.0 * n : value;
+    }
+};
+
+// Factorizes a matrix kept on disk with the out-of-core LU or Cholesky
+// factorization and solves for NRHS right-hand sides filled with 1
+class ooc_benchmark_t : public benchmark_routine_t
+{
+public:
+    ooc_benchmark_t() : m_kind(ooc_factorization_t::LU), m_panel_cols(0), m_path("ooc")
+    {
+    }
+
+    std::string name()      const { return m_kind == ooc_factorization_t::LU ? "ooc_getrf" : "ooc_potrf"; }
+    std::string title()     const { return "OUT-OF-CORE FACTORIZATION"; }
+    std::string sizes()     const { return "n nrhs"; }
+    std::string arguments() const { return "n"; }
+
+    std::vector<std::string> phases() const
+    {
+        std::vector<std::string> names;
+        names.push_back(m_kind == ooc_factorization_t::LU ? "PxGETRF out of core" : "PxPOTRF out of core");
+        names.push_back("Solve");
+        return names;
+    }
+
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {8192, 8192, 8192, 1, 0, 0, 0, 0};
+        return c;
+    }
+
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "cholesky")
+            m_kind = ooc_factorization_t::CHOLESKY;
+        else if (key == "panel" && atoi(value.c_str()) > 0)
+            m_panel_cols = atoi(value.c_str());
+        else if (key == "path" && !value.empty())
+            m_path = value;
+        else
+            return false;
+        return true;
+    }
+
+    // The operations and messages are those of the in-core routines; the
+    // I/O is reported separately
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        if (m_kind == ooc_factorization_t::LU)
+            return getrf_count(c.n, c.nprows, c.npcols) + getrs_count(c.n, c.nrhs, c.nprows, c.npcols);
+        return potrf_count(c.n, c.nprows, c.npcols) + potrs_count(c.n, c.nrhs, c.nprows, c.npcols);
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
+    {
+        auto a = std::make_shared<ooc_matrix_t>(grid, c.n, m_panel_cols, m_path, c.nb);
+        if (!a->valid())
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Unable to create %s.RANK\n", m_path.c_str()); fflush(stdout);
+            }
+            return false;
+        }
+
+        test_matrix_t element;
+        element.n   = c.n;
+        element.spd = m_kind == ooc_factorization_t::CHOLESKY;
+        a->generate(element);
+
+        ooc_factorization_t f(a, m_kind);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        blas_idx_t info = f.factor();
+        result.t.push_back(MPI_Wtime() - t0);
+        if (info != 0)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("Factorization failed with INFO = %d\n", info); fflush(stdout);
+            }
+            return false;
+        }
+
+        blas_idx_t bs = a->block_size();
+        auto x = std::make_shared<block_cyclic_mat_t>(grid, c.n, c.nrhs, bs, bs, block_cyclic_mat_t::CONSTANT, 1.0);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        f.solve(x);
+        result.t.push_back(MPI_Wtime() - t0);
+
+        const ooc_stats_t& stats = a->stats();
+        result.metrics.push_back(std::make_pair(std::string("Panel width"), double(a->panel_cols())));
+        result.metrics.push_back(std::make_pair(std::string("GB read"), stats.bytes_read / 1e9));
+        result.metrics.push_back(std::make_pair(std::string("GB written"), stats.bytes_written / 1e9));
+        result.metrics.push_back(std::make_pair(std::string("Compute seconds"), stats.compute));
+        result.metrics.push_back(std::make_pair(std::string("I/O wait seconds"), stats.io_wait));
+        result.metrics.push_back(std::make_pair(std::string("I/O overlap"), stats.overlap()));
+
+        if (verify)
+        {
+            // ||AX - B||_oo / (N x ||A||_1), regenerating A one panel at
+            // a time since its file now holds the factors
+            auto r     = block_cyclic_mat_t::constant(grid, c.n, c.nrhs, 1.0);
+            auto panel = a->make_panel();
+            double norm = 0.0;
+            for (blas_idx_t p = 0; p < a->panels(); p ++)
+            {
+                blas_idx_t j0 = p * a->panel_cols(), wp = a->cols(p);
+                generate(*panel, [&](blas_idx_t i, blas_idx_t j) {
+                    return j < wp ? element(i, j0 + j) : 0.0;
+                });
+
+                block_cyclic_view_t ap = block_cyclic_view_t(*panel).col_slice(1, wp);
+                gemm(ap, block_cyclic_view_t(*x).row_slice(j0 + 1, wp), *r, 1.0, p == 0 ? -1.0 : 1.0);
+                norm = std::max(norm, lange(ap, '1'));
+            }
+            double err = lange(*r, 'I') / c.n / norm;
+            result.metrics.push_back(std::make_pair(std::string("Error"), err));
+        }
+        return true;
+    }
+
+private:
+    ooc_factorization_t::kind_t m_kind;
+    blas_idx_t                  m_panel_cols;
+    std::string                 m_path;
+};
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  // Arguments are N and the options of run_benchmark, plus -cholesky for
+  // the Cholesky factorization, panel=COLS for the panel width (DEFAULT
+  // eight blocks) and path=PREFIX for the files, which should be on a
+  // node-local disk (DEFAULT ooc in the working directory)
+  ooc_benchmark_t routine;
+  int status = run_benchmark(argc, argv, routine);
+
+  MPI_Finalize();
+  return status;
+}
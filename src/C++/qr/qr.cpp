@@ -0,0 +1,324 @@
+#include <mpi.h>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include "benchmark.h"
+#include "block_cyclic_mat.h"
+#include "block_cyclic_view.h"
+#include "scalapack.h"
+#include "scalapack_api.h"
+#include "tsqr.h"
+#include "trace.h"
+#include "workspace_pool.h"
+
+enum lls_mode_t {QR, GELS, TSQR};
+
+// Returns the workspace size of a routine, querying it only the first time
+// it is called on matrices with the given descriptors
+static blas_idx_t query_lwork(const char* routine, block_cyclic_mat_t& a, block_cyclic_mat_t& b,
+    std::function<double()> query)
+{
+    std::vector<blas_idx_t> args(a.descriptor(), a.descriptor() + DLEN_);
+    args.insert(args.end(), b.descriptor(), b.descriptor() + DLEN_);
+    return workspace_pool_t::instance().cached_query(routine, args, [&]() {
+        return std::vector<blas_idx_t>(1, blas_idx_t(query()));
+    })[0];
+}
+
+// Copies a matrix held in column-major order on every process into the
+// local part of the distributed matrix x
+static void scatter(const std::vector<double>& x, block_cyclic_mat_t& xd)
+{
+    auto grid = xd.grid();
+    blas_idx_t m      = xd.global_rows();
+    blas_idx_t mb     = xd.row_block_size(), nb = xd.col_block_size();
+    blas_idx_t nprows = grid->nprows(), npcols = grid->npcols();
+    blas_idx_t* desc  = xd.descriptor();
+    blas_idx_t myprow = (grid->myprow() - desc[RSRC_] + nprows) % nprows;
+    blas_idx_t mypcol = (grid->mypcol() - desc[CSRC_] + npcols) % npcols;
+
+    for (blas_idx_t jl = 0; jl < xd.local_cols(); jl ++)
+    {
+        blas_idx_t j = ((jl / nb) * npcols + mypcol) * nb + jl % nb;
+        for (blas_idx_t il = 0; il < xd.local_rows(); il ++)
+        {
+            blas_idx_t i = ((il / mb) * nprows + myprow) * mb + il % mb;
+            xd.local_data()[il + jl * desc[LLD_]] = x[i + j * m];
+        }
+    }
+    xd.mark_modified();
+}
+
+// Returns ||A^T (B - A X)||_F / (||A||_F ||B - A X||_F), which is of the
+// order of the machine precision for a least squares solution
+static double normal_residual(block_cyclic_mat_t& a, block_cyclic_mat_t& b, block_cyclic_view_t x)
+{
+    auto grid = a.grid();
+    blas_idx_t n = a.global_cols(), nrhs = b.global_cols();
+
+    auto r = std::make_shared<block_cyclic_mat_t>(b);
+    gemm(a, x, *r, -1.0, 1.0);
+
+    auto g = std::make_shared<block_cyclic_mat_t>(grid, n, nrhs, a.col_block_size(), b.col_block_size());
+    gemm(block_cyclic_view_t(a).transpose(), *r, *g);
+
+    return lange(*g, 'F') / (lange(a, 'F') * lange(*r, 'F'));
+}
+
+// Prints the INFO of a failed call on process 0 and returns true if the
+// call failed
+static bool failed(std::shared_ptr<blacs_grid_t> grid, const char* routine, blas_idx_t info)
+{
+    if (info != 0 && grid->iam() == 0)
+    {
+        printf("%s failed with INFO = %d\n", routine, info); fflush(stdout);
+    }
+    return info != 0;
+}
+
+// Solves the least squares problem, storing the time of each phase of the
+// mode in result.t and, if verify is true, the normal residual. Returns
+// false if a phase fails.
+static bool lls_solve(std::shared_ptr<blacs_grid_t> grid, blas_idx_t m, blas_idx_t n, blas_idx_t nrhs,
+    lls_mode_t mode, bool verify, benchmark_result_t& result)
+{
+    std::shared_ptr<block_cyclic_mat_t> a, b;
+    if (mode == TSQR)
+    {
+        // One block of rows per process, so each local QR is as large as
+        // possible
+        blas_idx_t mb = (m + grid->nprows() - 1) / grid->nprows();
+        a = std::make_shared<block_cyclic_mat_t>(grid, m, n,    mb, n,    block_cyclic_mat_t::RANDOM);
+        b = std::make_shared<block_cyclic_mat_t>(grid, m, nrhs, mb, nrhs, block_cyclic_mat_t::RANDOM);
+    }
+    else
+    {
+        a = block_cyclic_mat_t::random(grid, m, n);
+        b = block_cyclic_mat_t::random(grid, m, nrhs);
+    }
+
+    // Keep A and B for verification
+    std::shared_ptr<block_cyclic_mat_t> a0, b0;
+    if (verify)
+    {
+        a0 = std::make_shared<block_cyclic_mat_t>(*a);
+        b0 = std::make_shared<block_cyclic_mat_t>(*b);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    blas_idx_t ia = 1, ja = 1, info = 0;
+    switch (mode)
+    {
+    case QR:
+        {
+            // QR factorization A = QR
+            std::vector<double> tau(a->local_cols() + a->col_block_size());
+            blas_idx_t lwork = query_lwork("pdgeqrf", *a, *a, [&]() {
+                blas_idx_t query = -1;
+                double     size;
+                pdgeqrf_(m, n, a->local_data(), ia, ja, a->descriptor(), tau.data(), &size, query, info);
+                return size;
+            });
+            {
+                workspace_t<double> work(lwork);
+                trace_scope_t scope("pdgeqrf");
+                double t0 = MPI_Wtime();
+                pdgeqrf_(m, n, a->local_data(), ia, ja, a->descriptor(), tau.data(), work.data(), lwork, info);
+                result.t.push_back(MPI_Wtime() - t0);
+                if (failed(grid, "PxGEQRF", info))
+                    return false;
+            }
+
+            // B = Q^T B
+            char side = 'L', trans = 'T';
+            lwork = query_lwork("pdormqr", *a, *b, [&]() {
+                blas_idx_t query = -1;
+                double     size;
+                pdormqr_(side, trans, m, nrhs, n,
+                    a->local_data(), ia, ja, a->descriptor(), tau.data(),
+                    b->local_data(), ia, ja, b->descriptor(), &size, query, info);
+                return size;
+            });
+            {
+                workspace_t<double> work(lwork);
+                trace_scope_t scope("pdormqr");
+                double t0 = MPI_Wtime();
+                pdormqr_(side, trans, m, nrhs, n,
+                    a->local_data(), ia, ja, a->descriptor(), tau.data(),
+                    b->local_data(), ia, ja, b->descriptor(), work.data(), lwork, info);
+                result.t.push_back(MPI_Wtime() - t0);
+                if (failed(grid, "PxORMQR", info))
+                    return false;
+            }
+
+            // Solve R X = (Q^T B)(1:N, :)
+            char uplo = 'U', notrans = 'N', diag = 'N';
+            trace_scope_t scope("pdtrtrs");
+            double t0 = MPI_Wtime();
+            pdtrtrs_(uplo, notrans, diag, n, nrhs,
+                a->local_data(), ia, ja, a->descriptor(),
+                b->local_data(), ia, ja, b->descriptor(), info);
+            result.t.push_back(MPI_Wtime() - t0);
+            if (failed(grid, "PxTRTRS", info))
+                return false;
+            b->mark_modified();
+            break;
+        }
+    case GELS:
+        {
+            char trans = 'N';
+            blas_idx_t lwork = query_lwork("pdgels", *a, *b, [&]() {
+                blas_idx_t query = -1;
+                double     size;
+                pdgels_(trans, m, n, nrhs,
+                    a->local_data(), ia, ja, a->descriptor(),
+                    b->local_data(), ia, ja, b->descriptor(), &size, query, info);
+                return size;
+            });
+            workspace_t<double> work(lwork);
+            trace_scope_t scope("pdgels");
+            double t0 = MPI_Wtime();
+            pdgels_(trans, m, n, nrhs,
+                a->local_data(), ia, ja, a->descriptor(),
+                b->local_data(), ia, ja, b->descriptor(), work.data(), lwork, info);
+            result.t.push_back(MPI_Wtime() - t0);
+            if (failed(grid, "PxGELS", info))
+                return false;
+            b->mark_modified();
+            break;
+        }
+    case TSQR:
+        {
+            std::vector<double> x;
+            double t0 = MPI_Wtime();
+            info = tsqr_solve(*a, *b, x);
+            result.t.push_back(MPI_Wtime() - t0);
+            if (failed(grid, "TSQR", info))
+                return false;
+
+            // Distribute the replicated solution so that it is verified
+            // the same way as the other modes
+            if (verify)
+            {
+                auto xd = std::make_shared<block_cyclic_mat_t>(grid, n, nrhs, b->row_block_size(), b->col_block_size());
+                scatter(x, *xd);
+                result.metrics.push_back(std::make_pair(std::string("Error"), normal_residual(*a0, *b0, *xd)));
+            }
+            return true;
+        }
+    }
+
+    if (verify)
+    {
+        double err = normal_residual(*a0, *b0, block_cyclic_view_t(*b, 1, 1, n, nrhs));
+        result.metrics.push_back(std::make_pair(std::string("Error"), err));
+    }
+    return true;
+}
+
+// Solves an overdetermined least squares problem with PxGEQRF + PxORMQR +
+// PxTRTRS (mode=qr), PxGELS (mode=gels) or TSQR (mode=tsqr)
+class lls_benchmark_t : public benchmark_routine_t
+{
+public:
+    lls_benchmark_t() : m_mode(QR)
+    {
+    }
+
+    // TSQR ignores the grid and block sizes, so it is tuned apart from the
+    // ScaLAPACK modes
+    std::string name()      const { return m_mode == TSQR ? "tsqr" : "geqrf"; }
+    std::string title()     const { return "LEAST SQUARES"; }
+    std::string sizes()     const { return "m n nrhs"; }
+    std::string arguments() const { return "m n nrhs mode"; }
+
+    std::vector<std::string> phases() const
+    {
+        std::vector<std::string> names;
+        if (m_mode == QR)
+        {
+            names.push_back("PxGEQRF");
+            names.push_back("PxORMQR");
+            names.push_back("PxTRTRS");
+        }
+        else
+        {
+            names.push_back(m_mode == GELS ? "PxGELS" : "TSQR");
+        }
+        return names;
+    }
+
+    benchmark_case_t defaults() const
+    {
+        benchmark_case_t c = {131072, 200, 200, 1, 0, 0, 0, 0};
+        return c;
+    }
+
+    bool set_option(const std::string& key, const std::string& value)
+    {
+        if (key == "mode" && value == "qr")
+            m_mode = QR;
+        else if (key == "mode" && value == "gels")
+            m_mode = GELS;
+        else if (key == "mode" && value == "tsqr")
+            m_mode = TSQR;
+        else
+            return false;
+        return true;
+    }
+
+    // PxGELS does the same work as the three phases of the QR mode, and
+    // TSQR runs on a P x 1 grid
+    perf_count_t model(const benchmark_case_t& c) const
+    {
+        blas_idx_t nprows = m_mode == TSQR ? c.nprows * c.npcols : c.nprows;
+        blas_idx_t npcols = m_mode == TSQR ? 1 : c.npcols;
+        return geqrf_count(c.m, c.n, nprows, npcols) + ormqr_count(c.m, c.n, c.nrhs, nprows, npcols)
+            + trtrs_count(c.n, c.nrhs, nprows, npcols);
+    }
+
+    bool run(std::shared_ptr<blacs_grid_t> grid, const benchmark_case_t& c, bool verify, benchmark_result_t& result)
+    {
+        if (c.m < c.n)
+        {
+            if (grid->iam() == 0)
+            {
+                printf("The problem must be overdetermined, but M = %d < N = %d\n", c.m, c.n); fflush(stdout);
+            }
+            return false;
+        }
+
+        // TSQR needs every process in a single process column. The grid is
+        // created once, outside the timed phases.
+        if (m_mode == TSQR)
+        {
+            if (!m_tsqr_grid)
+                m_tsqr_grid = std::make_shared<blacs_grid_t>(grid->nprocs(), 1);
+            grid = m_tsqr_grid;
+        }
+        return lls_solve(grid, c.m, c.n, c.nrhs, m_mode, verify, result);
+    }
+
+private:
+    lls_mode_t                    m_mode;
+    std::shared_ptr<blacs_grid_t> m_tsqr_grid;
+};
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  // Arguments are M, N, NRHS and the mode, which selects PxGEQRF + PxORMQR
+  // + PxTRTRS (qr, DEFAULT), PxGELS (gels) or TSQR on a P x 1 grid (tsqr),
+  // and the options of run_benchmark. The routine holds the TSQR grid,
+  // which must be freed before MPI_Finalize.
+  int status;
+  {
+    lls_benchmark_t routine;
+    status = run_benchmark(argc, argv, routine);
+  }
+
+  MPI_Finalize();
+  return status;
+}